@@ -0,0 +1,341 @@
+#pragma once
+
+#include "utils.hh"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <iterator>
+#include <span>
+#include <utility>
+#include <vector>
+
+// Compressed set of u32 ids after Roaring (Chambi et al., SPE '16). Ids are
+// split by their high 16 bits into containers; a container holds its low 16
+// bits as a sorted array while it has at most ArrayMax of them, and as a
+// 65536-bit bitset beyond that. Set operations work container by container,
+// so sparse and dense regions each take the cheap path.
+class RoaringBitmap {
+public:
+    RoaringBitmap() = default;
+
+    auto add(u32 v) -> void {
+        const auto key = static_cast<u16>(v >> 16);
+        const auto low = static_cast<u16>(v);
+
+        // Ids mostly arrive in increasing order; check the last container first.
+        if (keys_.empty() || keys_.back() < key) {
+            keys_.push_back(key);
+            containers_.emplace_back();
+            return containers_.back().add(low);
+        }
+        if (keys_.back() == key) return containers_.back().add(low);
+
+        const auto it = std::ranges::lower_bound(keys_, key);
+        const auto i  = static_cast<size_t>(it - keys_.begin());
+        if (it == keys_.end() || *it != key) {
+            keys_.insert(it, key);
+            containers_.insert(containers_.begin() + static_cast<std::ptrdiff_t>(i), Container {});
+        }
+        containers_[i].add(low);
+    }
+
+    [[nodiscard]] auto contains(u32 v) const -> bool {
+        const auto it = std::ranges::lower_bound(keys_, static_cast<u16>(v >> 16));
+        if (it == keys_.end() || *it != static_cast<u16>(v >> 16)) return false;
+        return containers_[static_cast<size_t>(it - keys_.begin())].contains(static_cast<u16>(v));
+    }
+
+    [[nodiscard]] auto cardinality() const -> u64 {
+        u64 total = 0;
+        for (const Container& c : containers_) total += c.card;
+        return total;
+    }
+
+    [[nodiscard]] auto empty() const -> bool { return keys_.empty(); }
+
+    // Calls f(id) for every id in increasing order.
+    template <typename F>
+    auto for_each(F&& f) const -> void {
+        for (size_t i = 0; i < keys_.size(); ++i) {
+            const u32 high = u32{keys_[i]} << 16;
+            const Container& c = containers_[i];
+
+            if (!c.is_bitset()) {
+                for (const u16 low : c.array) f(high | low);
+                continue;
+            }
+            for (u32 w = 0; w < BitsetWords; ++w) {
+                for (u64 word = c.bits[w]; word != 0; word &= word - 1) {
+                    f(high | (w * 64 + static_cast<u32>(std::countr_zero(word))));
+                }
+            }
+        }
+    }
+
+    // The ids for which pred(id) holds. Builds each container in one pass
+    // rather than adding the kept ids one at a time.
+    template <typename F>
+    [[nodiscard]] auto filter(F&& pred) const -> RoaringBitmap {
+        RoaringBitmap out;
+        for (size_t i = 0; i < keys_.size(); ++i) {
+            const u32 high = u32{keys_[i]} << 16;
+            const Container& c = containers_[i];
+
+            Container kept;
+            if (!c.is_bitset()) {
+                std::vector<u16> array;
+                for (const u16 low : c.array) {
+                    if (pred(high | low)) array.push_back(low);
+                }
+                kept = Container::from_array(std::move(array));
+            } else {
+                kept.bits.assign(BitsetWords, 0);
+                for (u32 w = 0; w < BitsetWords; ++w) {
+                    u64 bits = 0;
+                    for (u64 word = c.bits[w]; word != 0; word &= word - 1) {
+                        const u32 bit = static_cast<u32>(std::countr_zero(word));
+                        bits |= u64 { pred(high | (w * 64 + bit)) } << bit;
+                    }
+                    kept.bits[w] = bits;
+                }
+                kept.normalize();
+            }
+
+            if (kept.card == 0) continue;
+            out.keys_.push_back(keys_[i]);
+            out.containers_.push_back(std::move(kept));
+        }
+        return out;
+    }
+
+    [[nodiscard]] auto to_vector() const -> std::vector<u32> {
+        std::vector<u32> out;
+        out.reserve(cardinality());
+        for_each([&](u32 v) { out.push_back(v); });
+        return out;
+    }
+
+    [[nodiscard]] auto size_bytes() const -> size_t {
+        size_t total = keys_.size() * sizeof(u16);
+        for (const Container& c : containers_) {
+            total += c.is_bitset() ? BitsetWords * sizeof(u64) : c.array.size() * sizeof(u16);
+        }
+        return total;
+    }
+
+    friend auto operator&(const RoaringBitmap& a, const RoaringBitmap& b) -> RoaringBitmap {
+        return merge<false, false>(a, b, &Container::intersect);
+    }
+
+    friend auto operator|(const RoaringBitmap& a, const RoaringBitmap& b) -> RoaringBitmap {
+        return merge<true, true>(a, b, &Container::unite);
+    }
+
+    // Ids in a but not in b.
+    friend auto operator-(const RoaringBitmap& a, const RoaringBitmap& b) -> RoaringBitmap {
+        return merge<true, false>(a, b, &Container::subtract);
+    }
+
+    // Union of many bitmaps in one pass: each container is ORed into a bitset
+    // accumulator for its key, instead of rebuilding the result per input.
+    [[nodiscard]] static auto unite_all(std::span<const RoaringBitmap* const> parts) -> RoaringBitmap {
+        // Accumulator index per key, 0 if none yet.
+        std::vector<u32> slot(1 << 16, 0);
+        std::vector<Container> acc;
+
+        for (const RoaringBitmap* p : parts) {
+            for (size_t i = 0; i < p->keys_.size(); ++i) {
+                u32& k = slot[p->keys_[i]];
+                if (k == 0) {
+                    acc.push_back({ .array = {}, .bits = std::vector<u64>(BitsetWords), .card = 0 });
+                    k = static_cast<u32>(acc.size());
+                }
+
+                u64* bits = acc[k - 1].bits.data();
+                const Container& c = p->containers_[i];
+                if (c.is_bitset()) {
+                    for (u32 w = 0; w < BitsetWords; ++w) bits[w] |= c.bits[w];
+                } else {
+                    for (const u16 low : c.array) bits[low / 64] |= u64{1} << (low % 64);
+                }
+            }
+        }
+
+        RoaringBitmap out;
+        for (u32 key = 0; key < slot.size(); ++key) {
+            if (slot[key] == 0) continue;
+            Container& c = acc[slot[key] - 1];
+            c.normalize();
+            out.keys_.push_back(static_cast<u16>(key));
+            out.containers_.push_back(std::move(c));
+        }
+        return out;
+    }
+
+    auto operator&=(const RoaringBitmap& o) -> RoaringBitmap& { return *this = *this & o; }
+    auto operator|=(const RoaringBitmap& o) -> RoaringBitmap& { return *this = *this | o; }
+    auto operator-=(const RoaringBitmap& o) -> RoaringBitmap& { return *this = *this - o; }
+
+private:
+    constexpr static size_t ArrayMax    = 4096;
+    constexpr static u32    BitsetWords = (1 << 16) / 64;
+
+    struct Container {
+        std::vector<u16> array;   // sorted low bits, unless a bitset
+        std::vector<u64> bits;    // BitsetWords words once a bitset
+        u32              card = 0;
+
+        [[nodiscard]] auto is_bitset() const -> bool { return !bits.empty(); }
+
+        [[nodiscard]] auto contains(u16 low) const -> bool {
+            if (is_bitset()) return (bits[low / 64] >> (low % 64)) & 1;
+            return std::ranges::binary_search(array, low);
+        }
+
+        auto add(u16 low) -> void {
+            if (is_bitset()) {
+                const u64 bit = u64{1} << (low % 64);
+                card += (bits[low / 64] & bit) == 0;
+                bits[low / 64] |= bit;
+                return;
+            }
+
+            if (array.empty() || array.back() < low) {
+                array.push_back(low);
+            } else {
+                const auto it = std::ranges::lower_bound(array, low);
+                if (*it == low) return;
+                array.insert(it, low);
+            }
+            ++card;
+            if (array.size() > ArrayMax) to_bitset();
+        }
+
+        auto to_bitset() -> void {
+            bits.assign(BitsetWords, 0);
+            for (const u16 low : array) bits[low / 64] |= u64{1} << (low % 64);
+            array.clear();
+            array.shrink_to_fit();
+        }
+
+        // Recounts a bitset and turns it back into an array if small enough.
+        auto normalize() -> void {
+            card = 0;
+            for (const u64 w : bits) card += static_cast<u32>(std::popcount(w));
+            if (card > ArrayMax) return;
+
+            array.reserve(card);
+            for (u32 w = 0; w < BitsetWords; ++w) {
+                for (u64 word = bits[w]; word != 0; word &= word - 1) {
+                    array.push_back(static_cast<u16>(w * 64 + static_cast<u32>(std::countr_zero(word))));
+                }
+            }
+            bits.clear();
+            bits.shrink_to_fit();
+        }
+
+        [[nodiscard]] static auto from_array(std::vector<u16> array) -> Container {
+            const auto card = static_cast<u32>(array.size());
+            return { .array = std::move(array), .bits = {}, .card = card };
+        }
+
+        [[nodiscard]] static auto intersect(const Container& a, const Container& b) -> Container {
+            if (a.is_bitset() && b.is_bitset()) {
+                Container out { .array = {}, .bits = a.bits, .card = 0 };
+                for (u32 w = 0; w < BitsetWords; ++w) out.bits[w] &= b.bits[w];
+                out.normalize();
+                return out;
+            }
+            if (a.is_bitset() || b.is_bitset()) {
+                const Container& arr = a.is_bitset() ? b : a;
+                const Container& set = a.is_bitset() ? a : b;
+                std::vector<u16> out;
+                for (const u16 low : arr.array) {
+                    if (set.contains(low)) out.push_back(low);
+                }
+                return from_array(std::move(out));
+            }
+
+            std::vector<u16> out;
+            std::ranges::set_intersection(a.array, b.array, std::back_inserter(out));
+            return from_array(std::move(out));
+        }
+
+        [[nodiscard]] static auto unite(const Container& a, const Container& b) -> Container {
+            if (!a.is_bitset() && !b.is_bitset() && a.card + b.card <= ArrayMax) {
+                std::vector<u16> out;
+                out.reserve(a.card + b.card);
+                std::ranges::set_union(a.array, b.array, std::back_inserter(out));
+                return from_array(std::move(out));
+            }
+
+            Container out = a.is_bitset() ? a : b;
+            if (!out.is_bitset()) out.to_bitset();
+
+            const Container& other = a.is_bitset() ? b : a;
+            if (other.is_bitset()) {
+                for (u32 w = 0; w < BitsetWords; ++w) out.bits[w] |= other.bits[w];
+            } else {
+                for (const u16 low : other.array) out.bits[low / 64] |= u64{1} << (low % 64);
+            }
+            out.normalize();
+            return out;
+        }
+
+        [[nodiscard]] static auto subtract(const Container& a, const Container& b) -> Container {
+            if (!a.is_bitset()) {
+                std::vector<u16> out;
+                for (const u16 low : a.array) {
+                    if (!b.contains(low)) out.push_back(low);
+                }
+                return from_array(std::move(out));
+            }
+
+            Container out = a;
+            if (b.is_bitset()) {
+                for (u32 w = 0; w < BitsetWords; ++w) out.bits[w] &= ~b.bits[w];
+            } else {
+                for (const u16 low : b.array) out.bits[low / 64] &= ~(u64{1} << (low % 64));
+            }
+            out.normalize();
+            return out;
+        }
+    };
+
+    // Walks both key lists in order. Containers only in a (or only in b) are
+    // copied when KeepA (KeepB); matching ones are combined with `op`.
+    template <bool KeepA, bool KeepB>
+    static auto merge(const RoaringBitmap& a, const RoaringBitmap& b,
+                      Container (*op)(const Container&, const Container&)) -> RoaringBitmap
+    {
+        RoaringBitmap out;
+        auto put = [&](u16 key, Container c) {
+            if (c.card == 0) return;
+            out.keys_.push_back(key);
+            out.containers_.push_back(std::move(c));
+        };
+
+        size_t i = 0;
+        size_t j = 0;
+        while (i < a.keys_.size() && j < b.keys_.size()) {
+            if (a.keys_[i] < b.keys_[j]) {
+                if constexpr (KeepA) put(a.keys_[i], a.containers_[i]);
+                ++i;
+            } else if (b.keys_[j] < a.keys_[i]) {
+                if constexpr (KeepB) put(b.keys_[j], b.containers_[j]);
+                ++j;
+            } else {
+                put(a.keys_[i], op(a.containers_[i], b.containers_[j]));
+                ++i;
+                ++j;
+            }
+        }
+        if constexpr (KeepA) for (; i < a.keys_.size(); ++i) put(a.keys_[i], a.containers_[i]);
+        if constexpr (KeepB) for (; j < b.keys_.size(); ++j) put(b.keys_[j], b.containers_[j]);
+        return out;
+    }
+
+    std::vector<u16>       keys_;
+    std::vector<Container> containers_;
+};
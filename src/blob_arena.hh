@@ -0,0 +1,151 @@
+#pragma once
+
+#include "huge_page_allocator.hh"
+#include "utils.hh"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+// Where a variable-length payload lives in a BlobArena. This is what a BYTES
+// field stores in its row; the payload itself stays in the arena.
+struct BlobRef {
+    u64 offset = 0;
+    u64 size   = 0;
+
+    constexpr friend bool operator==(BlobRef, BlobRef) = default;
+};
+
+// Append-only store for variable-length payloads. Payloads are copied into a
+// chain of 2MB huge-page regions and addressed by a logical offset: region k
+// covers [k * RegionSize, (k + 1) * RegionSize). A payload never straddles
+// two regions, so a read is one contiguous span into the arena, and nothing
+// is ever moved or freed before the arena itself. Payloads larger than a
+// region get a heap block spanning as many region slots as they need.
+//
+// append() takes a mutex, as every shard and series of a type writes to the
+// same arena. get() is lock-free: region slots are found through a list of
+// doubling segments that never move, as in SymbolTable.
+class BlobArena {
+public:
+    using Region = HugePageAlloc<1, Huge2MB>;
+
+    constexpr static size_t RegionSize = Huge2MB;
+
+    BlobArena() = default;
+
+    BlobArena(const BlobArena&) = delete;
+    auto operator=(const BlobArena&) -> BlobArena& = delete;
+
+    ~BlobArena() {
+        for (auto& seg : segments_) delete[] seg.load(std::memory_order_relaxed);
+    }
+
+    // Copies `payload` in. on_append(ref) runs under the lock, so it sees refs
+    // in offset order; the WAL relies on that to replay to the same offsets.
+    template <typename F>
+    auto append(std::span<const std::byte> payload, F&& on_append) -> BlobRef {
+        const size_t n = payload.size();
+
+        std::scoped_lock lock { mu_ };
+        const u64 end = size_.load(std::memory_order_relaxed);
+        if (n == 0) {
+            const BlobRef ref { .offset = end, .size = 0 };
+            on_append(ref);
+            return ref;
+        }
+
+        if (n > RegionSize) {
+            // Round up to whole slots so the next payload starts a fresh region.
+            const size_t slots = (n + RegionSize - 1) / RegionSize;
+            auto& block = large_.emplace_back(std::make_unique_for_overwrite<std::byte[]>(slots * RegionSize));
+            std::memcpy(block.get(), payload.data(), n);
+
+            const BlobRef ref { .offset = slot_count_ * RegionSize, .size = n };
+            for (size_t i = 0; i < slots; ++i) push_slot(block.get() + i * RegionSize);
+            open_ = false;
+            on_append(ref);
+            size_.store(slot_count_ * RegionSize, std::memory_order_release);
+            return ref;
+        }
+
+        void* p = open_ ? regions_.back()->allocate(n, 1) : nullptr;
+        if (p == nullptr) {
+            // The rest of the current region is skipped.
+            auto& region = regions_.emplace_back(std::make_unique<Region>());
+            push_slot(static_cast<std::byte*>(region->allocate(0, 1)));
+            p     = region->allocate(n, 1);
+            open_ = true;
+        }
+
+        std::memcpy(p, payload.data(), n);
+        const BlobRef ref {
+            .offset = (slot_count_ - 1) * RegionSize + static_cast<size_t>(static_cast<std::byte*>(p) - last_base_),
+            .size   = n,
+        };
+        on_append(ref);
+        size_.store(ref.offset + n, std::memory_order_release);
+        return ref;
+    }
+
+    auto append(std::span<const std::byte> payload) -> BlobRef {
+        return append(payload, [](BlobRef) {});
+    }
+
+    // The payload of `ref`, in place; valid as long as the arena.
+    [[nodiscard]] auto get(BlobRef ref) const -> std::span<const std::byte> {
+        if (ref.size == 0) return {};
+        assert(ref.offset + ref.size <= size());
+        const auto [seg, offset] = locate(ref.offset / RegionSize);
+        return { segments_[seg].load(std::memory_order_acquire)[offset] + ref.offset % RegionSize, ref.size };
+    }
+
+    // Logical bytes appended, including skipped region tails.
+    [[nodiscard]] auto size() const -> u64 { return size_.load(std::memory_order_acquire); }
+
+    [[nodiscard]] auto reserved() const -> size_t {
+        std::scoped_lock lock { mu_ };
+        return slot_count_ * RegionSize;
+    }
+
+private:
+    constexpr static u32 SegmentBits = 6;   // segment s holds 64 << s region slots
+
+    // Segment and offset of a region slot: segment s starts at slot (64 << s) - 64.
+    [[nodiscard]] static auto locate(u64 slot) -> std::pair<u32, u64> {
+        const u64 biased = slot + (u64{1} << SegmentBits);
+        const u32 seg    = static_cast<u32>(std::bit_width(biased)) - 1 - SegmentBits;
+        return { seg, biased - (u64{1} << (seg + SegmentBits)) };
+    }
+
+    // Publishes the base of the next region slot; called under mu_.
+    auto push_slot(std::byte* base) -> void {
+        const auto [seg, offset] = locate(slot_count_);
+        std::byte** s = segments_[seg].load(std::memory_order_relaxed);
+        if (s == nullptr) {
+            s = new std::byte*[size_t{1} << (seg + SegmentBits)];
+            segments_[seg].store(s, std::memory_order_release);
+        }
+        s[offset]  = base;
+        last_base_ = base;
+        ++slot_count_;
+    }
+
+    std::array<std::atomic<std::byte**>, 38> segments_ {};   // every slot a u64 offset can address
+    std::atomic<u64>                         size_ { 0 };
+
+    // Writer side, under mu_.
+    mutable std::mutex                        mu_;
+    std::vector<std::unique_ptr<Region>>      regions_;
+    std::vector<std::unique_ptr<std::byte[]>> large_;
+    std::byte*                                last_base_  = nullptr;   // start of the last region slot
+    size_t                                    slot_count_ = 0;
+    bool                                      open_       = false;     // regions_.back() is the last slot
+};
@@ -0,0 +1,328 @@
+#pragma once
+
+#include "utils.hh"
+
+#include <bit>
+#include <cassert>
+#include <concepts>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+// Gorilla-style encodings for sealed column chunks (Pelkonen et al., VLDB '15):
+// delta-of-delta for timestamps, XOR against the previous value for floats and
+// frame-of-reference bit packing for integers. All three are decoded in one
+// forward pass over the bit stream.
+namespace gorilla {
+
+enum class Codec : u8 {
+    DeltaOfDelta,
+    Xor,
+    BitPack,
+};
+
+struct Encoded {
+    Codec            codec = Codec::BitPack;
+    u32              rows  = 0;
+    std::vector<u64> words;
+
+    [[nodiscard]] auto size_bytes() const -> size_t { return words.size() * sizeof(u64); }
+};
+
+// MSB-first bit stream over 64-bit words. Call finish() before reading the
+// output; the last partial word is only written then.
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<u64>& out) : out_(out) {}
+
+    BitWriter(const BitWriter&) = delete;
+    BitWriter& operator=(const BitWriter&) = delete;
+
+    auto write(u64 value, u32 bits) -> void {
+        assert(bits <= 64);
+        if (bits == 0) return;
+        if (bits < 64) value &= (u64{1} << bits) - 1;
+
+        const u32 free = 64 - used_;
+        if (bits < free) {
+            acc_ |= value << (free - bits);
+            used_ += bits;
+            return;
+        }
+
+        // Fill the current word, spill the rest into the next one.
+        const u32 spill = bits - free;
+        acc_ |= spill < 64 ? value >> spill : 0;
+        out_.push_back(acc_);
+        acc_  = spill > 0 ? value << (64 - spill) : 0;
+        used_ = spill;
+    }
+
+    auto write_bit(bool bit) -> void { write(bit ? 1 : 0, 1); }
+
+    // Writes the last partial word plus one zero word of padding for BitReader.
+    auto finish() -> void {
+        if (used_ > 0) {
+            out_.push_back(acc_);
+            acc_  = 0;
+            used_ = 0;
+        }
+        out_.push_back(0);
+    }
+
+private:
+    std::vector<u64>& out_;
+    u64               acc_  = 0;
+    u32               used_ = 0;
+};
+
+// Expects the trailing padding word written by finish(), so that peek() can
+// always load the two words a field may straddle without a bounds check.
+class BitReader {
+public:
+    explicit BitReader(std::span<const u64> words) : words_(words) {}
+
+    [[nodiscard]] auto peek(u32 bits) const -> u64 {
+        assert(bits >= 1 && bits <= 64);
+
+        const size_t word = pos_ / 64;
+        const u32    off  = static_cast<u32>(pos_ % 64);
+
+        const u64 hi = words_[word] << off;
+        const u64 lo = (words_[word + 1] >> 1) >> (63 - off);
+        return (hi | lo) >> (64 - bits);
+    }
+
+    auto skip(u32 bits) -> void { pos_ += bits; }
+
+    auto read(u32 bits) -> u64 {
+        if (bits == 0) return 0;
+        const u64 v = peek(bits);
+        pos_ += bits;
+        return v;
+    }
+
+    auto read_bit() -> bool { return read(1) != 0; }
+
+private:
+    std::span<const u64> words_;
+    size_t               pos_ = 0;
+};
+
+template <typename T>
+constexpr auto sign_extend(u64 v, u32 bits) -> T {
+    const u64 m = u64{1} << (bits - 1);
+    return static_cast<T>((v ^ m) - m);
+}
+
+// Timestamps: raw first value and first delta, then each delta-of-delta in the
+// smallest of four buckets. A fixed sampling interval costs one bit per row.
+inline auto encode_timestamps(std::span<const i64> v) -> Encoded {
+    Encoded e { .codec = Codec::DeltaOfDelta, .rows = static_cast<u32>(v.size()) };
+    BitWriter w { e.words };
+    if (v.empty()) return e;
+
+    w.write(static_cast<u64>(v[0]), 64);
+    if (v.size() == 1) { w.finish(); return e; }
+
+    i64 prev_delta = v[1] - v[0];
+    w.write(static_cast<u64>(prev_delta), 64);
+
+    for (size_t i = 2; i < v.size(); ++i) {
+        const i64 delta = v[i] - v[i - 1];
+        const i64 dod   = delta - prev_delta;
+        prev_delta = delta;
+
+        if (dod == 0) {
+            w.write(0b0, 1);
+        } else if (dod >= -64 && dod <= 63) {
+            w.write(0b10, 2);
+            w.write(static_cast<u64>(dod), 7);
+        } else if (dod >= -256 && dod <= 255) {
+            w.write(0b110, 3);
+            w.write(static_cast<u64>(dod), 9);
+        } else if (dod >= -2048 && dod <= 2047) {
+            w.write(0b1110, 4);
+            w.write(static_cast<u64>(dod), 12);
+        } else {
+            w.write(0b1111, 4);
+            w.write(static_cast<u64>(dod), 64);
+        }
+    }
+
+    w.finish();
+    return e;
+}
+
+inline auto decode_timestamps(const Encoded& e, std::span<i64> out) -> void {
+    assert(e.codec == Codec::DeltaOfDelta && out.size() >= e.rows);
+    if (e.rows == 0) return;
+
+    BitReader r { e.words };
+    out[0] = static_cast<i64>(r.read(64));
+    if (e.rows == 1) return;
+
+    i64 delta = static_cast<i64>(r.read(64));
+    out[1] = out[0] + delta;
+
+    // Control prefixes 0, 10, 110, 1110, 1111 indexed by the next four bits.
+    constexpr u8 prefix_len[16] = { 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 4, 4 };
+    constexpr u8 value_bits[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 7, 7, 7, 7, 9, 9, 12, 64 };
+
+    i64 prev = out[1];
+    for (u32 i = 2; i < e.rows; ++i) {
+        const u32 ctl = static_cast<u32>(r.peek(4));
+        r.skip(prefix_len[ctl]);
+
+        // Jittery intervals make the bucket unpredictable, so the short
+        // buckets (including the empty one) share one branch-free path.
+        if (const u32 bits = value_bits[ctl]; bits == 64) [[unlikely]] {
+            delta += static_cast<i64>(r.read(64));
+        } else {
+            const u64 raw  = r.peek(16) >> (16 - bits);
+            const u64 sign = (u64{1} << bits) >> 1;
+            r.skip(bits);
+            delta += static_cast<i64>((raw ^ sign) - sign);
+        }
+
+        prev  += delta;
+        out[i] = prev;
+    }
+}
+
+// Floats: XOR with the previous value. Identical values cost one bit; others
+// store only the meaningful bits, reusing the previous leading/trailing-zero
+// window when the new value fits inside it.
+template <std::floating_point T>
+auto encode_xor(std::span<const T> v) -> Encoded {
+    using U = std::conditional_t<sizeof(T) == 8, u64, u32>;
+    constexpr u32 width      = sizeof(U) * 8;
+    constexpr u32 field_bits = std::bit_width(width - 1);
+
+    Encoded e { .codec = Codec::Xor, .rows = static_cast<u32>(v.size()) };
+    BitWriter w { e.words };
+    if (v.empty()) return e;
+
+    U prev = std::bit_cast<U>(v[0]);
+    w.write(prev, width);
+
+    u32 prev_lead  = width + 1;
+    u32 prev_trail = 0;
+
+    for (size_t i = 1; i < v.size(); ++i) {
+        const U cur = std::bit_cast<U>(v[i]);
+        const U x   = cur ^ prev;
+        prev = cur;
+
+        if (x == 0) {
+            w.write(0b0, 1);
+            continue;
+        }
+
+        const u32 lead  = static_cast<u32>(std::countl_zero(x));
+        const u32 trail = static_cast<u32>(std::countr_zero(x));
+
+        if (prev_lead <= width && lead >= prev_lead && trail >= prev_trail) {
+            w.write(0b10, 2);
+            w.write(x >> prev_trail, width - prev_lead - prev_trail);
+        } else {
+            const u32 len = width - lead - trail;
+            w.write(0b11, 2);
+            w.write(lead, field_bits);
+            w.write(len - 1, field_bits);
+            w.write(x >> trail, len);
+            prev_lead  = lead;
+            prev_trail = trail;
+        }
+    }
+
+    w.finish();
+    return e;
+}
+
+template <std::floating_point T>
+auto decode_xor(const Encoded& e, std::span<T> out) -> void {
+    using U = std::conditional_t<sizeof(T) == 8, u64, u32>;
+    constexpr u32 width      = sizeof(U) * 8;
+    constexpr u32 field_bits = std::bit_width(width - 1);
+
+    assert(e.codec == Codec::Xor && out.size() >= e.rows);
+    if (e.rows == 0) return;
+
+    BitReader r { e.words };
+    U prev = static_cast<U>(r.read(width));
+    out[0] = std::bit_cast<T>(prev);
+
+    u32 lead  = 0;
+    u32 trail = 0;
+
+    for (u32 i = 1; i < e.rows; ++i) {
+        const u32  ctl     = static_cast<u32>(r.peek(2));
+        const bool changed = ctl >= 0b10;
+        r.skip(changed ? 2 : 1);
+
+        if (ctl == 0b11) {
+            const u32 fields = static_cast<u32>(r.read(2 * field_bits));
+            lead  = fields >> field_bits;
+            trail = width - lead - ((fields & ((1u << field_bits) - 1)) + 1);
+        }
+
+        // An unchanged value reads zero bits; keep that off a branch too.
+        const u32 len  = changed ? width - lead - trail : 0;
+        prev ^= len == 0 ? U{0} : static_cast<U>(r.peek(len)) << trail;
+        r.skip(len);
+        out[i] = std::bit_cast<T>(prev);
+    }
+}
+
+// Integers: subtract the chunk minimum and pack every value in the bit width
+// of the largest remainder.
+template <typename T>
+    requires std::integral<T> || std::same_as<T, bool>
+auto encode_bitpack(std::span<const T> v) -> Encoded {
+    Encoded e { .codec = Codec::BitPack, .rows = static_cast<u32>(v.size()) };
+    BitWriter w { e.words };
+    if (v.empty()) return e;
+
+    // Sign- or zero-extend to 64 bits; differences are then exact modulo 2^64.
+    auto widen = [](T x) -> u64 {
+        if constexpr (std::is_signed_v<T>) return static_cast<u64>(static_cast<i64>(x));
+        else                               return static_cast<u64>(x);
+    };
+
+    T lo = v[0], hi = v[0];
+    for (T x : v) {
+        lo = std::min(lo, x);
+        hi = std::max(hi, x);
+    }
+
+    const u64 base = widen(lo);
+    const u32 bits = static_cast<u32>(std::bit_width(widen(hi) - base));
+
+    w.write(base, 64);
+    w.write(bits, 7);
+    for (T x : v) {
+        w.write(widen(x) - base, bits);
+    }
+
+    w.finish();
+    return e;
+}
+
+template <typename T>
+    requires std::integral<T> || std::same_as<T, bool>
+auto decode_bitpack(const Encoded& e, std::span<T> out) -> void {
+    assert(e.codec == Codec::BitPack && out.size() >= e.rows);
+    if (e.rows == 0) return;
+
+    BitReader r { e.words };
+    const u64 base = r.read(64);
+    const u32 bits = static_cast<u32>(r.read(7));
+
+    for (u32 i = 0; i < e.rows; ++i) {
+        out[i] = static_cast<T>(base + r.read(bits));
+    }
+}
+
+} // namespace gorilla
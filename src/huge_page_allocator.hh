@@ -1,7 +1,11 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <new>
+#include <utility>
+#include <vector>
 
 #ifdef __linux__
     #include <sys/mman.h>
@@ -95,7 +99,11 @@ private:
         huge = false;
         auto* p = ::mmap(nullptr, cap_, PROT_READ | PROT_WRITE,
                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-        return (p == MAP_FAILED) ? nullptr : p;
+        if (p == MAP_FAILED) return nullptr;
+
+        // No reserved hugetlb pages, ask for transparent huge pages instead.
+        ::madvise(p, cap_, MADV_HUGEPAGE);
+        return p;
 
 #elif defined(__APPLE__)
         huge = false;
@@ -127,3 +135,83 @@ private:
     std::byte* cur_   {nullptr};
     bool huge_pages   {false};
 };
+
+// A growable chain of HugePageAlloc regions. Allocation bumps through the
+// newest region and maps (and prefaults) another one when it runs out, so
+// capacity is no longer fixed by NumPages. Memory is returned when the arena
+// is destroyed.
+template <std::size_t RegionPages = 1, std::size_t PageSize = Huge2MB>
+class HugePageArena {
+public:
+    using Region = HugePageAlloc<RegionPages, PageSize>;
+
+    constexpr static std::size_t region_size = RegionPages * PageSize;
+
+    HugePageArena() = default;
+
+    HugePageArena(const HugePageArena&) = delete;
+    HugePageArena& operator=(const HugePageArena&) = delete;
+    HugePageArena(HugePageArena&&) = delete;
+    HugePageArena& operator=(HugePageArena&&) = delete;
+
+    [[nodiscard]] auto allocate(std::size_t size, std::size_t alignment = 64) -> void* {
+        if (size > region_size) [[unlikely]] {
+            throw std::bad_alloc{};
+        }
+
+        for (auto& [block_size, blocks] : free_) {
+            if (block_size != size || blocks.empty()) continue;
+            if (reinterpret_cast<std::uintptr_t>(blocks.back()) % alignment != 0) break;
+
+            void* p = blocks.back();
+            blocks.pop_back();
+            return p;
+        }
+
+        if (!regions_.empty()) {
+            if (auto* p = regions_.back()->allocate(size, alignment)) [[likely]] {
+                return p;
+            }
+        }
+
+        auto& region = regions_.emplace_back(std::make_unique<Region>());
+        region->prefault();
+        return region->allocate(size, alignment);
+    }
+
+    // Returns a block to the arena; the next allocate() of the same size
+    // reuses it. Regions themselves are only unmapped with the arena.
+    auto release(void* p, std::size_t size) -> void {
+        for (auto& [block_size, blocks] : free_) {
+            if (block_size == size) {
+                blocks.push_back(p);
+                return;
+            }
+        }
+        free_.push_back({ size, { p } });
+    }
+
+    [[nodiscard]] auto free_bytes() const noexcept -> std::size_t {
+        std::size_t total = 0;
+        for (const auto& [block_size, blocks] : free_) total += block_size * blocks.size();
+        return total;
+    }
+
+    [[nodiscard]] auto region_count() const noexcept -> std::size_t {
+        return regions_.size();
+    }
+
+    [[nodiscard]] auto reserved() const noexcept -> std::size_t {
+        return regions_.size() * region_size;
+    }
+
+    [[nodiscard]] auto using_huge_pages() const noexcept -> bool {
+        return !regions_.empty() && regions_.front()->using_huge_pages();
+    }
+
+private:
+    std::vector<std::unique_ptr<Region>> regions_;
+
+    // Released blocks by size; callers use a handful of sizes, so a flat list.
+    std::vector<std::pair<std::size_t, std::vector<void*>>> free_;
+};
@@ -0,0 +1,833 @@
+#pragma once
+
+#include "utils.hh"
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #include <immintrin.h>
+    #define TSDB_KERNELS_X86 1
+    #define TSDB_TARGET_AVX2   __attribute__((target("avx2")))
+    #define TSDB_TARGET_AVX512 __attribute__((target("avx2,avx512f,avx512dq")))
+#endif
+
+// Reduction and comparison kernels over raw column chunks. Each kernel has a
+// scalar version and, on x86, AVX2 and AVX-512 versions compiled with
+// per-function target attributes, so one binary picks the widest ISA the CPU
+// supports at runtime. Every ISA gives the same result for floats: min and
+// max skip NaNs (all-NaN input gives the neutral value), sums propagate them.
+namespace kernels {
+
+enum class Isa : u8 {
+    Scalar,
+    Avx2,
+    Avx512,
+};
+
+[[nodiscard]] inline auto detected_isa() -> Isa {
+#ifdef TSDB_KERNELS_X86
+    static const Isa isa = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) return Isa::Avx512;
+        if (__builtin_cpu_supports("avx2")) return Isa::Avx2;
+        return Isa::Scalar;
+    }();
+    return isa;
+#else
+    return Isa::Scalar;
+#endif
+}
+
+// Never hands out an ISA the CPU cannot run, so callers may ask for any.
+[[nodiscard]] inline auto clamp_isa(Isa requested) -> Isa {
+    return std::min(requested, detected_isa());
+}
+
+// Sums are widened so that f32 and narrow integers do not overflow or lose
+// precision over a 64K-row chunk.
+template <typename T>
+using SumType = std::conditional_t<std::is_floating_point_v<T>, f64,
+                std::conditional_t<std::is_signed_v<T>, i64, u64>>;
+
+template <typename T>
+struct Summary {
+    SumType<T> sum   = 0;
+    T          min   = std::numeric_limits<T>::max();
+    T          max   = std::numeric_limits<T>::lowest();
+    u64        count = 0;
+
+    auto merge(const Summary& o) -> void {
+        sum   += o.sum;
+        min    = std::min(min, o.min);
+        max    = std::max(max, o.max);
+        count += o.count;
+    }
+};
+
+// Comparison of a filter predicate: element `op` value.
+enum class CmpOp : u8 {
+    Eq,
+    Ne,
+    Lt,
+    Le,
+    Gt,
+    Ge,
+};
+
+template <CmpOp op, typename T>
+[[nodiscard]] constexpr auto holds(T a, T b) -> bool {
+    if constexpr (op == CmpOp::Eq) return a == b;
+    if constexpr (op == CmpOp::Ne) return a != b;
+    if constexpr (op == CmpOp::Lt) return a < b;
+    if constexpr (op == CmpOp::Le) return a <= b;
+    if constexpr (op == CmpOp::Gt) return a > b;
+    if constexpr (op == CmpOp::Ge) return a >= b;
+}
+
+// Calls f.template operator()<op>(), so loops over a runtime op are
+// compiled once per op and branch on it only once.
+template <typename F>
+constexpr auto visit_op(CmpOp op, F&& f) -> decltype(auto) {
+    switch (op) {
+        case CmpOp::Eq: return f.template operator()<CmpOp::Eq>();
+        case CmpOp::Ne: return f.template operator()<CmpOp::Ne>();
+        case CmpOp::Lt: return f.template operator()<CmpOp::Lt>();
+        case CmpOp::Le: return f.template operator()<CmpOp::Le>();
+        case CmpOp::Gt: return f.template operator()<CmpOp::Gt>();
+        case CmpOp::Ge: return f.template operator()<CmpOp::Ge>();
+    }
+    std::unreachable();
+}
+
+namespace scalar {
+
+template <typename T>
+[[nodiscard]] auto sum(const T* p, size_t n) -> SumType<T> {
+    SumType<T> acc = 0;
+    for (size_t i = 0; i < n; ++i) acc += p[i];
+    return acc;
+}
+
+template <typename T>
+[[nodiscard]] auto min(const T* p, size_t n) -> T {
+    T acc = std::numeric_limits<T>::max();
+    for (size_t i = 0; i < n; ++i) acc = std::min(acc, p[i]);
+    return acc;
+}
+
+template <typename T>
+[[nodiscard]] auto max(const T* p, size_t n) -> T {
+    T acc = std::numeric_limits<T>::lowest();
+    for (size_t i = 0; i < n; ++i) acc = std::max(acc, p[i]);
+    return acc;
+}
+
+// summarize() of the n elements from p whose validity bit is set, where bit
+// first_bit + i of `valid` covers p[i]. Nulls are folded in through selects,
+// which compile to conditional moves, not branches.
+template <typename T>
+[[nodiscard]] auto summarize_masked(const T* p, const u64* valid, size_t first_bit, size_t n) -> Summary<T> {
+    Summary<T> s;
+    for (size_t i = 0; i < n; ++i) {
+        const size_t bit = first_bit + i;
+        const bool   set = (valid[bit / 64] >> (bit % 64)) & 1;
+        s.sum   += set ? static_cast<SumType<T>>(p[i]) : SumType<T>{0};
+        s.min    = set ? std::min(s.min, p[i]) : s.min;
+        s.max    = set ? std::max(s.max, p[i]) : s.max;
+        s.count += set;
+    }
+    return s;
+}
+
+// Sets bit i of out[i / 64] where p[i] `op` value holds, for n elements;
+// bits of the last word past n are cleared.
+template <CmpOp op, typename T>
+auto compare(const T* p, size_t n, T value, u64* out) -> void {
+    for (size_t i = 0; i < n; i += 64) {
+        const size_t m = std::min<size_t>(64, n - i);
+        u64 word = 0;
+        for (size_t j = 0; j < m; ++j) word |= u64{holds<op>(p[i + j], value)} << j;
+        out[i / 64] = word;
+    }
+}
+
+} // namespace scalar
+
+#ifdef TSDB_KERNELS_X86
+
+// Per-ISA lane operations. `V` is the native vector for min/max; `W` is the
+// accumulator for sums, loaded `wide_lanes` source elements at a time and
+// widened to SumType<T> where the source is narrower.
+template <typename T> struct Avx2;
+template <typename T> struct Avx512;
+
+template <typename T>
+concept Avx2Vectorized = requires { Avx2<T>::lanes; };
+
+template <typename T>
+concept Avx512Vectorized = requires { Avx512<T>::lanes; };
+
+// All-ones lanes where the matching low bit of `bits` is set: 4 x 64-bit and
+// 8 x 32-bit. AVX-512 takes the bits as a mask register directly.
+TSDB_TARGET_AVX2 inline auto avx2_mask64(u32 bits) -> __m256i {
+    const __m256i sel = _mm256_setr_epi64x(1, 2, 4, 8);
+    return _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_set1_epi64x(bits), sel), sel);
+}
+
+TSDB_TARGET_AVX2 inline auto avx2_mask32(u32 bits) -> __m256i {
+    const __m256i sel = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    return _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(static_cast<i32>(bits)), sel), sel);
+}
+
+// _CMP_* predicate of `op` for the float compares: ordered, except Ne,
+// so a NaN compares like it does with the C++ operators. Variables, not
+// functions, so they stay immediates in unoptimised builds.
+template <CmpOp op>
+constexpr int float_predicate = op == CmpOp::Eq ? _CMP_EQ_OQ
+                              : op == CmpOp::Ne ? _CMP_NEQ_UQ
+                              : op == CmpOp::Lt ? _CMP_LT_OQ
+                              : op == CmpOp::Le ? _CMP_LE_OQ
+                              : op == CmpOp::Gt ? _CMP_GT_OQ
+                              :                   _CMP_GE_OQ;
+
+// _MM_CMPINT_* predicate of `op` for the AVX-512 integer compares.
+template <CmpOp op>
+constexpr int int_predicate = op == CmpOp::Eq ? _MM_CMPINT_EQ
+                            : op == CmpOp::Ne ? _MM_CMPINT_NE
+                            : op == CmpOp::Lt ? _MM_CMPINT_LT
+                            : op == CmpOp::Le ? _MM_CMPINT_LE
+                            : op == CmpOp::Gt ? _MM_CMPINT_NLE
+                            :                   _MM_CMPINT_NLT;
+
+// AVX2 has only a > b and a == b for integers; the other ops swap the
+// operands or flip the lane bits.
+template <typename L, CmpOp op>
+TSDB_TARGET_AVX2 inline auto avx2_int_compare(typename L::V a, typename L::V b) -> u32 {
+    constexpr u32 all = (1u << L::lanes) - 1;
+    if constexpr (op == CmpOp::Eq) return L::eq(a, b);
+    if constexpr (op == CmpOp::Ne) return L::eq(a, b) ^ all;
+    if constexpr (op == CmpOp::Lt) return L::gt(b, a);
+    if constexpr (op == CmpOp::Le) return L::gt(a, b) ^ all;
+    if constexpr (op == CmpOp::Gt) return L::gt(a, b);
+    if constexpr (op == CmpOp::Ge) return L::gt(b, a) ^ all;
+}
+
+template <>
+struct Avx2<f64> {
+    using V = __m256d;
+    using W = __m256d;
+    constexpr static size_t lanes = 4, wide_lanes = 4;
+
+    TSDB_TARGET_AVX2 static auto load(const f64* p) -> V { return _mm256_loadu_pd(p); }
+    TSDB_TARGET_AVX2 static auto splat(f64 v) -> V { return _mm256_set1_pd(v); }
+    TSDB_TARGET_AVX2 static auto min(V a, V b) -> V { return _mm256_min_pd(a, b); }
+    TSDB_TARGET_AVX2 static auto max(V a, V b) -> V { return _mm256_max_pd(a, b); }
+    TSDB_TARGET_AVX2 static auto wide_zero() -> W { return _mm256_setzero_pd(); }
+    TSDB_TARGET_AVX2 static auto wide_add(W acc, const f64* p) -> W { return _mm256_add_pd(acc, load(p)); }
+    TSDB_TARGET_AVX2 static auto select(u32 bits, V v, V other) -> V {
+        return _mm256_blendv_pd(other, v, _mm256_castsi256_pd(avx2_mask64(bits)));
+    }
+    TSDB_TARGET_AVX2 static auto wide_add_masked(W acc, const f64* p, u32 bits) -> W {
+        return _mm256_add_pd(acc, _mm256_and_pd(load(p), _mm256_castsi256_pd(avx2_mask64(bits))));
+    }
+    template <CmpOp op>
+    TSDB_TARGET_AVX2 static auto compare(V a, V b) -> u32 {
+        return static_cast<u32>(_mm256_movemask_pd(_mm256_cmp_pd(a, b, float_predicate<op>)));
+    }
+};
+
+template <>
+struct Avx2<f32> {
+    using V = __m256;
+    using W = __m256d;
+    constexpr static size_t lanes = 8, wide_lanes = 4;
+
+    TSDB_TARGET_AVX2 static auto load(const f32* p) -> V { return _mm256_loadu_ps(p); }
+    TSDB_TARGET_AVX2 static auto splat(f32 v) -> V { return _mm256_set1_ps(v); }
+    TSDB_TARGET_AVX2 static auto min(V a, V b) -> V { return _mm256_min_ps(a, b); }
+    TSDB_TARGET_AVX2 static auto max(V a, V b) -> V { return _mm256_max_ps(a, b); }
+    TSDB_TARGET_AVX2 static auto wide_zero() -> W { return _mm256_setzero_pd(); }
+    TSDB_TARGET_AVX2 static auto wide_add(W acc, const f32* p) -> W {
+        return _mm256_add_pd(acc, _mm256_cvtps_pd(_mm_loadu_ps(p)));
+    }
+    TSDB_TARGET_AVX2 static auto select(u32 bits, V v, V other) -> V {
+        return _mm256_blendv_ps(other, v, _mm256_castsi256_ps(avx2_mask32(bits)));
+    }
+    TSDB_TARGET_AVX2 static auto wide_add_masked(W acc, const f32* p, u32 bits) -> W {
+        return _mm256_add_pd(acc, _mm256_and_pd(_mm256_cvtps_pd(_mm_loadu_ps(p)), _mm256_castsi256_pd(avx2_mask64(bits))));
+    }
+    template <CmpOp op>
+    TSDB_TARGET_AVX2 static auto compare(V a, V b) -> u32 {
+        return static_cast<u32>(_mm256_movemask_ps(_mm256_cmp_ps(a, b, float_predicate<op>)));
+    }
+};
+
+template <>
+struct Avx2<i64> {
+    using V = __m256i;
+    using W = __m256i;
+    constexpr static size_t lanes = 4, wide_lanes = 4;
+
+    TSDB_TARGET_AVX2 static auto load(const i64* p) -> V { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    TSDB_TARGET_AVX2 static auto splat(i64 v) -> V { return _mm256_set1_epi64x(v); }
+    // AVX2 has no 64-bit min/max; select through a compare mask.
+    TSDB_TARGET_AVX2 static auto min(V a, V b) -> V { return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b)); }
+    TSDB_TARGET_AVX2 static auto max(V a, V b) -> V { return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b)); }
+    TSDB_TARGET_AVX2 static auto wide_zero() -> W { return _mm256_setzero_si256(); }
+    TSDB_TARGET_AVX2 static auto wide_add(W acc, const i64* p) -> W { return _mm256_add_epi64(acc, load(p)); }
+    TSDB_TARGET_AVX2 static auto select(u32 bits, V v, V other) -> V { return _mm256_blendv_epi8(other, v, avx2_mask64(bits)); }
+    TSDB_TARGET_AVX2 static auto wide_add_masked(W acc, const i64* p, u32 bits) -> W {
+        return _mm256_add_epi64(acc, _mm256_and_si256(load(p), avx2_mask64(bits)));
+    }
+    TSDB_TARGET_AVX2 static auto gt(V a, V b) -> u32 { return static_cast<u32>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(a, b)))); }
+    TSDB_TARGET_AVX2 static auto eq(V a, V b) -> u32 { return static_cast<u32>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(a, b)))); }
+    template <CmpOp op>
+    TSDB_TARGET_AVX2 static auto compare(V a, V b) -> u32 { return avx2_int_compare<Avx2, op>(a, b); }
+};
+
+template <>
+struct Avx2<i32> {
+    using V = __m256i;
+    using W = __m256i;
+    constexpr static size_t lanes = 8, wide_lanes = 4;
+
+    TSDB_TARGET_AVX2 static auto load(const i32* p) -> V { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    TSDB_TARGET_AVX2 static auto splat(i32 v) -> V { return _mm256_set1_epi32(v); }
+    TSDB_TARGET_AVX2 static auto min(V a, V b) -> V { return _mm256_min_epi32(a, b); }
+    TSDB_TARGET_AVX2 static auto max(V a, V b) -> V { return _mm256_max_epi32(a, b); }
+    TSDB_TARGET_AVX2 static auto wide_zero() -> W { return _mm256_setzero_si256(); }
+    TSDB_TARGET_AVX2 static auto wide_add(W acc, const i32* p) -> W {
+        return _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+    }
+    TSDB_TARGET_AVX2 static auto select(u32 bits, V v, V other) -> V { return _mm256_blendv_epi8(other, v, avx2_mask32(bits)); }
+    TSDB_TARGET_AVX2 static auto wide_add_masked(W acc, const i32* p, u32 bits) -> W {
+        const __m256i v = _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        return _mm256_add_epi64(acc, _mm256_and_si256(v, avx2_mask64(bits)));
+    }
+    TSDB_TARGET_AVX2 static auto gt(V a, V b) -> u32 { return static_cast<u32>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(a, b)))); }
+    TSDB_TARGET_AVX2 static auto eq(V a, V b) -> u32 { return static_cast<u32>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)))); }
+    template <CmpOp op>
+    TSDB_TARGET_AVX2 static auto compare(V a, V b) -> u32 { return avx2_int_compare<Avx2, op>(a, b); }
+};
+
+template <>
+struct Avx2<u32> {
+    using V = __m256i;
+    using W = __m256i;
+    constexpr static size_t lanes = 8, wide_lanes = 4;
+
+    TSDB_TARGET_AVX2 static auto load(const u32* p) -> V { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    TSDB_TARGET_AVX2 static auto splat(u32 v) -> V { return _mm256_set1_epi32(static_cast<i32>(v)); }
+    TSDB_TARGET_AVX2 static auto min(V a, V b) -> V { return _mm256_min_epu32(a, b); }
+    TSDB_TARGET_AVX2 static auto max(V a, V b) -> V { return _mm256_max_epu32(a, b); }
+    TSDB_TARGET_AVX2 static auto wide_zero() -> W { return _mm256_setzero_si256(); }
+    TSDB_TARGET_AVX2 static auto wide_add(W acc, const u32* p) -> W {
+        return _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+    }
+    TSDB_TARGET_AVX2 static auto select(u32 bits, V v, V other) -> V { return _mm256_blendv_epi8(other, v, avx2_mask32(bits)); }
+    TSDB_TARGET_AVX2 static auto wide_add_masked(W acc, const u32* p, u32 bits) -> W {
+        const __m256i v = _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        return _mm256_add_epi64(acc, _mm256_and_si256(v, avx2_mask64(bits)));
+    }
+    // Unsigned order is signed order with the sign bits flipped.
+    TSDB_TARGET_AVX2 static auto gt(V a, V b) -> u32 {
+        const __m256i sign = _mm256_set1_epi32(std::numeric_limits<i32>::min());
+        const __m256i gt   = _mm256_cmpgt_epi32(_mm256_xor_si256(a, sign), _mm256_xor_si256(b, sign));
+        return static_cast<u32>(_mm256_movemask_ps(_mm256_castsi256_ps(gt)));
+    }
+    TSDB_TARGET_AVX2 static auto eq(V a, V b) -> u32 { return static_cast<u32>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)))); }
+    template <CmpOp op>
+    TSDB_TARGET_AVX2 static auto compare(V a, V b) -> u32 { return avx2_int_compare<Avx2, op>(a, b); }
+};
+
+template <>
+struct Avx512<f64> {
+    using V = __m512d;
+    using W = __m512d;
+    constexpr static size_t lanes = 8, wide_lanes = 8;
+
+    TSDB_TARGET_AVX512 static auto load(const f64* p) -> V { return _mm512_loadu_pd(p); }
+    TSDB_TARGET_AVX512 static auto splat(f64 v) -> V { return _mm512_set1_pd(v); }
+    TSDB_TARGET_AVX512 static auto min(V a, V b) -> V { return _mm512_min_pd(a, b); }
+    TSDB_TARGET_AVX512 static auto max(V a, V b) -> V { return _mm512_max_pd(a, b); }
+    TSDB_TARGET_AVX512 static auto wide_zero() -> W { return _mm512_setzero_pd(); }
+    TSDB_TARGET_AVX512 static auto wide_add(W acc, const f64* p) -> W { return _mm512_add_pd(acc, load(p)); }
+    TSDB_TARGET_AVX512 static auto select(u32 bits, V v, V other) -> V {
+        return _mm512_mask_blend_pd(static_cast<__mmask8>(bits), other, v);
+    }
+    TSDB_TARGET_AVX512 static auto wide_add_masked(W acc, const f64* p, u32 bits) -> W {
+        return _mm512_mask_add_pd(acc, static_cast<__mmask8>(bits), acc, load(p));
+    }
+    template <CmpOp op>
+    TSDB_TARGET_AVX512 static auto compare(V a, V b) -> u32 { return _mm512_cmp_pd_mask(a, b, float_predicate<op>); }
+};
+
+template <>
+struct Avx512<f32> {
+    using V = __m512;
+    using W = __m512d;
+    constexpr static size_t lanes = 16, wide_lanes = 8;
+
+    TSDB_TARGET_AVX512 static auto load(const f32* p) -> V { return _mm512_loadu_ps(p); }
+    TSDB_TARGET_AVX512 static auto splat(f32 v) -> V { return _mm512_set1_ps(v); }
+    TSDB_TARGET_AVX512 static auto min(V a, V b) -> V { return _mm512_min_ps(a, b); }
+    TSDB_TARGET_AVX512 static auto max(V a, V b) -> V { return _mm512_max_ps(a, b); }
+    TSDB_TARGET_AVX512 static auto wide_zero() -> W { return _mm512_setzero_pd(); }
+    TSDB_TARGET_AVX512 static auto wide_add(W acc, const f32* p) -> W {
+        return _mm512_add_pd(acc, _mm512_cvtps_pd(_mm256_loadu_ps(p)));
+    }
+    TSDB_TARGET_AVX512 static auto select(u32 bits, V v, V other) -> V {
+        return _mm512_mask_blend_ps(static_cast<__mmask16>(bits), other, v);
+    }
+    TSDB_TARGET_AVX512 static auto wide_add_masked(W acc, const f32* p, u32 bits) -> W {
+        return _mm512_mask_add_pd(acc, static_cast<__mmask8>(bits), acc, _mm512_cvtps_pd(_mm256_loadu_ps(p)));
+    }
+    template <CmpOp op>
+    TSDB_TARGET_AVX512 static auto compare(V a, V b) -> u32 { return _mm512_cmp_ps_mask(a, b, float_predicate<op>); }
+};
+
+template <>
+struct Avx512<i64> {
+    using V = __m512i;
+    using W = __m512i;
+    constexpr static size_t lanes = 8, wide_lanes = 8;
+
+    TSDB_TARGET_AVX512 static auto load(const i64* p) -> V { return _mm512_loadu_si512(p); }
+    TSDB_TARGET_AVX512 static auto splat(i64 v) -> V { return _mm512_set1_epi64(v); }
+    TSDB_TARGET_AVX512 static auto min(V a, V b) -> V { return _mm512_min_epi64(a, b); }
+    TSDB_TARGET_AVX512 static auto max(V a, V b) -> V { return _mm512_max_epi64(a, b); }
+    TSDB_TARGET_AVX512 static auto wide_zero() -> W { return _mm512_setzero_si512(); }
+    TSDB_TARGET_AVX512 static auto wide_add(W acc, const i64* p) -> W { return _mm512_add_epi64(acc, load(p)); }
+    TSDB_TARGET_AVX512 static auto select(u32 bits, V v, V other) -> V {
+        return _mm512_mask_blend_epi64(static_cast<__mmask8>(bits), other, v);
+    }
+    TSDB_TARGET_AVX512 static auto wide_add_masked(W acc, const i64* p, u32 bits) -> W {
+        return _mm512_mask_add_epi64(acc, static_cast<__mmask8>(bits), acc, load(p));
+    }
+    template <CmpOp op>
+    TSDB_TARGET_AVX512 static auto compare(V a, V b) -> u32 { return _mm512_cmp_epi64_mask(a, b, int_predicate<op>); }
+};
+
+template <>
+struct Avx512<i32> {
+    using V = __m512i;
+    using W = __m512i;
+    constexpr static size_t lanes = 16, wide_lanes = 8;
+
+    TSDB_TARGET_AVX512 static auto load(const i32* p) -> V { return _mm512_loadu_si512(p); }
+    TSDB_TARGET_AVX512 static auto splat(i32 v) -> V { return _mm512_set1_epi32(v); }
+    TSDB_TARGET_AVX512 static auto min(V a, V b) -> V { return _mm512_min_epi32(a, b); }
+    TSDB_TARGET_AVX512 static auto max(V a, V b) -> V { return _mm512_max_epi32(a, b); }
+    TSDB_TARGET_AVX512 static auto wide_zero() -> W { return _mm512_setzero_si512(); }
+    TSDB_TARGET_AVX512 static auto wide_add(W acc, const i32* p) -> W {
+        return _mm512_add_epi64(acc, _mm512_cvtepi32_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))));
+    }
+    TSDB_TARGET_AVX512 static auto select(u32 bits, V v, V other) -> V {
+        return _mm512_mask_blend_epi32(static_cast<__mmask16>(bits), other, v);
+    }
+    TSDB_TARGET_AVX512 static auto wide_add_masked(W acc, const i32* p, u32 bits) -> W {
+        const __m512i v = _mm512_cvtepi32_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+        return _mm512_mask_add_epi64(acc, static_cast<__mmask8>(bits), acc, v);
+    }
+    template <CmpOp op>
+    TSDB_TARGET_AVX512 static auto compare(V a, V b) -> u32 { return _mm512_cmp_epi32_mask(a, b, int_predicate<op>); }
+};
+
+template <>
+struct Avx512<u32> {
+    using V = __m512i;
+    using W = __m512i;
+    constexpr static size_t lanes = 16, wide_lanes = 8;
+
+    TSDB_TARGET_AVX512 static auto load(const u32* p) -> V { return _mm512_loadu_si512(p); }
+    TSDB_TARGET_AVX512 static auto splat(u32 v) -> V { return _mm512_set1_epi32(static_cast<i32>(v)); }
+    TSDB_TARGET_AVX512 static auto min(V a, V b) -> V { return _mm512_min_epu32(a, b); }
+    TSDB_TARGET_AVX512 static auto max(V a, V b) -> V { return _mm512_max_epu32(a, b); }
+    TSDB_TARGET_AVX512 static auto wide_zero() -> W { return _mm512_setzero_si512(); }
+    TSDB_TARGET_AVX512 static auto wide_add(W acc, const u32* p) -> W {
+        return _mm512_add_epi64(acc, _mm512_cvtepu32_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))));
+    }
+    TSDB_TARGET_AVX512 static auto select(u32 bits, V v, V other) -> V {
+        return _mm512_mask_blend_epi32(static_cast<__mmask16>(bits), other, v);
+    }
+    TSDB_TARGET_AVX512 static auto wide_add_masked(W acc, const u32* p, u32 bits) -> W {
+        const __m512i v = _mm512_cvtepu32_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+        return _mm512_mask_add_epi64(acc, static_cast<__mmask8>(bits), acc, v);
+    }
+    template <CmpOp op>
+    TSDB_TARGET_AVX512 static auto compare(V a, V b) -> u32 { return _mm512_cmp_epu32_mask(a, b, int_predicate<op>); }
+};
+
+// The loops below are the same for both ISAs; they are spelled out twice
+// because the target attribute has to sit on the function that contains the
+// intrinsics. Four independent accumulators hide the add/min latency.
+namespace avx2 {
+
+// min/max of accumulator `acc` and `v`. The float instructions return their
+// second operand when either is NaN, so passing `acc` second skips NaNs in
+// `v`, as std::min(acc, v) does in the scalar loops.
+template <typename L, bool IsMin>
+TSDB_TARGET_AVX2 inline auto pick(typename L::V acc, typename L::V v) -> typename L::V {
+    if constexpr (IsMin) return L::min(v, acc);
+    else                 return L::max(v, acc);
+}
+
+template <Avx2Vectorized T>
+TSDB_TARGET_AVX2 auto sum(const T* p, size_t n) -> SumType<T> {
+    using L = Avx2<T>;
+    constexpr size_t step = 4 * L::wide_lanes;
+
+    typename L::W a0 = L::wide_zero(), a1 = a0, a2 = a0, a3 = a0;
+    size_t i = 0;
+    for (; i + step <= n; i += step) {
+        a0 = L::wide_add(a0, p + i);
+        a1 = L::wide_add(a1, p + i + L::wide_lanes);
+        a2 = L::wide_add(a2, p + i + 2 * L::wide_lanes);
+        a3 = L::wide_add(a3, p + i + 3 * L::wide_lanes);
+    }
+
+    alignas(32) SumType<T> lanes[4][4];
+    std::memcpy(lanes[0], &a0, 32);
+    std::memcpy(lanes[1], &a1, 32);
+    std::memcpy(lanes[2], &a2, 32);
+    std::memcpy(lanes[3], &a3, 32);
+
+    SumType<T> acc = 0;
+    for (auto& row : lanes) for (auto v : row) acc += v;
+    return acc + scalar::sum(p + i, n - i);
+}
+
+template <Avx2Vectorized T, bool IsMin>
+TSDB_TARGET_AVX2 auto extremum(const T* p, size_t n) -> T {
+    using L = Avx2<T>;
+    constexpr size_t step = 4 * L::lanes;
+    constexpr T init = IsMin ? std::numeric_limits<T>::max() : std::numeric_limits<T>::lowest();
+
+    typename L::V a0 = L::splat(init), a1 = a0, a2 = a0, a3 = a0;
+    size_t i = 0;
+    for (; i + step <= n; i += step) {
+        a0 = pick<L, IsMin>(a0, L::load(p + i));
+        a1 = pick<L, IsMin>(a1, L::load(p + i + L::lanes));
+        a2 = pick<L, IsMin>(a2, L::load(p + i + 2 * L::lanes));
+        a3 = pick<L, IsMin>(a3, L::load(p + i + 3 * L::lanes));
+    }
+    a0 = pick<L, IsMin>(pick<L, IsMin>(a0, a1), pick<L, IsMin>(a2, a3));
+
+    alignas(32) T lanes[L::lanes];
+    std::memcpy(lanes, &a0, sizeof(lanes));
+
+    T acc = IsMin ? scalar::min(p + i, n - i) : scalar::max(p + i, n - i);
+    for (T v : lanes) acc = IsMin ? std::min(acc, v) : std::max(acc, v);
+    return acc;
+}
+
+
+// summarize() of the elements whose validity bit is set, over whole 64-row
+// words: bit i of valid[i / 64] covers p[i] and n is a multiple of 64. Each
+// word is cut into per-vector lane masks; null lanes are blended to the
+// neutral value of min and max and masked out of the sum, so no row branches.
+template <Avx2Vectorized T>
+TSDB_TARGET_AVX2 auto summarize_masked(const T* p, const u64* valid, size_t n) -> Summary<T> {
+    using L = Avx2<T>;
+    constexpr u64 lane_bits = (u64{1} << L::lanes) - 1;
+    constexpr u64 wide_bits = (u64{1} << L::wide_lanes) - 1;
+
+    const typename L::V top    = L::splat(std::numeric_limits<T>::max());
+    const typename L::V bottom = L::splat(std::numeric_limits<T>::lowest());
+
+    typename L::W acc = L::wide_zero();
+    typename L::V lo  = top;
+    typename L::V hi  = bottom;
+    u64 count = 0;
+
+    for (size_t i = 0; i < n; i += 64) {
+        const u64 word = valid[i / 64];
+        count += static_cast<u64>(std::popcount(word));
+
+        for (size_t j = 0; j < 64; j += L::lanes) {
+            const auto bits = static_cast<u32>((word >> j) & lane_bits);
+            const auto v    = L::load(p + i + j);
+            lo = pick<L, true>(lo, L::select(bits, v, top));
+            hi = pick<L, false>(hi, L::select(bits, v, bottom));
+        }
+        for (size_t j = 0; j < 64; j += L::wide_lanes) {
+            acc = L::wide_add_masked(acc, p + i + j, static_cast<u32>((word >> j) & wide_bits));
+        }
+    }
+
+    alignas(32) SumType<T> sums[L::wide_lanes];
+    alignas(32) T          mins[L::lanes];
+    alignas(32) T          maxs[L::lanes];
+    std::memcpy(sums, &acc, sizeof(sums));
+    std::memcpy(mins, &lo, sizeof(mins));
+    std::memcpy(maxs, &hi, sizeof(maxs));
+
+    Summary<T> s;
+    for (auto v : sums) s.sum += v;
+    for (T v : mins) s.min = std::min(s.min, v);
+    for (T v : maxs) s.max = std::max(s.max, v);
+    s.count = count;
+    return s;
+}
+
+// compare() over whole 64-element words: n is a multiple of 64. Each word
+// is put together from the lane bits of lanes-wide compares.
+template <Avx2Vectorized T, CmpOp op>
+TSDB_TARGET_AVX2 auto compare(const T* p, size_t n, T value, u64* out) -> void {
+    using L = Avx2<T>;
+    const typename L::V v = L::splat(value);
+
+    for (size_t i = 0; i < n; i += 64) {
+        u64 word = 0;
+        for (size_t j = 0; j < 64; j += L::lanes) {
+            word |= u64{L::template compare<op>(L::load(p + i + j), v)} << j;
+        }
+        out[i / 64] = word;
+    }
+}
+
+} // namespace avx2
+
+namespace avx512 {
+
+// Same operand order as avx2::pick, so NaNs are skipped here too.
+template <typename L, bool IsMin>
+TSDB_TARGET_AVX512 inline auto pick(typename L::V acc, typename L::V v) -> typename L::V {
+    if constexpr (IsMin) return L::min(v, acc);
+    else                 return L::max(v, acc);
+}
+
+template <Avx512Vectorized T>
+TSDB_TARGET_AVX512 auto sum(const T* p, size_t n) -> SumType<T> {
+    using L = Avx512<T>;
+    constexpr size_t step = 4 * L::wide_lanes;
+
+    typename L::W a0 = L::wide_zero(), a1 = a0, a2 = a0, a3 = a0;
+    size_t i = 0;
+    for (; i + step <= n; i += step) {
+        a0 = L::wide_add(a0, p + i);
+        a1 = L::wide_add(a1, p + i + L::wide_lanes);
+        a2 = L::wide_add(a2, p + i + 2 * L::wide_lanes);
+        a3 = L::wide_add(a3, p + i + 3 * L::wide_lanes);
+    }
+
+    alignas(64) SumType<T> lanes[4][8];
+    std::memcpy(lanes[0], &a0, 64);
+    std::memcpy(lanes[1], &a1, 64);
+    std::memcpy(lanes[2], &a2, 64);
+    std::memcpy(lanes[3], &a3, 64);
+
+    SumType<T> acc = 0;
+    for (auto& row : lanes) for (auto v : row) acc += v;
+    return acc + scalar::sum(p + i, n - i);
+}
+
+template <Avx512Vectorized T, bool IsMin>
+TSDB_TARGET_AVX512 auto extremum(const T* p, size_t n) -> T {
+    using L = Avx512<T>;
+    constexpr size_t step = 4 * L::lanes;
+    constexpr T init = IsMin ? std::numeric_limits<T>::max() : std::numeric_limits<T>::lowest();
+
+    typename L::V a0 = L::splat(init), a1 = a0, a2 = a0, a3 = a0;
+    size_t i = 0;
+    for (; i + step <= n; i += step) {
+        a0 = pick<L, IsMin>(a0, L::load(p + i));
+        a1 = pick<L, IsMin>(a1, L::load(p + i + L::lanes));
+        a2 = pick<L, IsMin>(a2, L::load(p + i + 2 * L::lanes));
+        a3 = pick<L, IsMin>(a3, L::load(p + i + 3 * L::lanes));
+    }
+    a0 = pick<L, IsMin>(pick<L, IsMin>(a0, a1), pick<L, IsMin>(a2, a3));
+
+    alignas(64) T lanes[L::lanes];
+    std::memcpy(lanes, &a0, sizeof(lanes));
+
+    T acc = IsMin ? scalar::min(p + i, n - i) : scalar::max(p + i, n - i);
+    for (T v : lanes) acc = IsMin ? std::min(acc, v) : std::max(acc, v);
+    return acc;
+}
+
+
+// summarize() of the elements whose validity bit is set, over whole 64-row
+// words: bit i of valid[i / 64] covers p[i] and n is a multiple of 64. Each
+// word is cut into per-vector lane masks; null lanes are blended to the
+// neutral value of min and max and masked out of the sum, so no row branches.
+template <Avx512Vectorized T>
+TSDB_TARGET_AVX512 auto summarize_masked(const T* p, const u64* valid, size_t n) -> Summary<T> {
+    using L = Avx512<T>;
+    constexpr u64 lane_bits = (u64{1} << L::lanes) - 1;
+    constexpr u64 wide_bits = (u64{1} << L::wide_lanes) - 1;
+
+    const typename L::V top    = L::splat(std::numeric_limits<T>::max());
+    const typename L::V bottom = L::splat(std::numeric_limits<T>::lowest());
+
+    typename L::W acc = L::wide_zero();
+    typename L::V lo  = top;
+    typename L::V hi  = bottom;
+    u64 count = 0;
+
+    for (size_t i = 0; i < n; i += 64) {
+        const u64 word = valid[i / 64];
+        count += static_cast<u64>(std::popcount(word));
+
+        for (size_t j = 0; j < 64; j += L::lanes) {
+            const auto bits = static_cast<u32>((word >> j) & lane_bits);
+            const auto v    = L::load(p + i + j);
+            lo = pick<L, true>(lo, L::select(bits, v, top));
+            hi = pick<L, false>(hi, L::select(bits, v, bottom));
+        }
+        for (size_t j = 0; j < 64; j += L::wide_lanes) {
+            acc = L::wide_add_masked(acc, p + i + j, static_cast<u32>((word >> j) & wide_bits));
+        }
+    }
+
+    alignas(64) SumType<T> sums[L::wide_lanes];
+    alignas(64) T          mins[L::lanes];
+    alignas(64) T          maxs[L::lanes];
+    std::memcpy(sums, &acc, sizeof(sums));
+    std::memcpy(mins, &lo, sizeof(mins));
+    std::memcpy(maxs, &hi, sizeof(maxs));
+
+    Summary<T> s;
+    for (auto v : sums) s.sum += v;
+    for (T v : mins) s.min = std::min(s.min, v);
+    for (T v : maxs) s.max = std::max(s.max, v);
+    s.count = count;
+    return s;
+}
+
+// compare() over whole 64-element words: n is a multiple of 64. Each word
+// is put together from the lane bits of lanes-wide compares.
+template <Avx512Vectorized T, CmpOp op>
+TSDB_TARGET_AVX512 auto compare(const T* p, size_t n, T value, u64* out) -> void {
+    using L = Avx512<T>;
+    const typename L::V v = L::splat(value);
+
+    for (size_t i = 0; i < n; i += 64) {
+        u64 word = 0;
+        for (size_t j = 0; j < 64; j += L::lanes) {
+            word |= u64{L::template compare<op>(L::load(p + i + j), v)} << j;
+        }
+        out[i / 64] = word;
+    }
+}
+
+} // namespace avx512
+
+#endif // TSDB_KERNELS_X86
+
+template <typename T>
+[[nodiscard]] auto sum(std::span<const T> v, Isa isa = detected_isa()) -> SumType<T> {
+#ifdef TSDB_KERNELS_X86
+    switch (clamp_isa(isa)) {
+        case Isa::Avx512: if constexpr (Avx512Vectorized<T>) return avx512::sum(v.data(), v.size()); [[fallthrough]];
+        case Isa::Avx2:   if constexpr (Avx2Vectorized<T>)   return avx2::sum(v.data(), v.size());   [[fallthrough]];
+        case Isa::Scalar: break;
+    }
+#endif
+    (void)isa;
+    return scalar::sum(v.data(), v.size());
+}
+
+template <typename T>
+[[nodiscard]] auto min(std::span<const T> v, Isa isa = detected_isa()) -> T {
+#ifdef TSDB_KERNELS_X86
+    switch (clamp_isa(isa)) {
+        case Isa::Avx512: if constexpr (Avx512Vectorized<T>) return avx512::extremum<T, true>(v.data(), v.size()); [[fallthrough]];
+        case Isa::Avx2:   if constexpr (Avx2Vectorized<T>)   return avx2::extremum<T, true>(v.data(), v.size());   [[fallthrough]];
+        case Isa::Scalar: break;
+    }
+#endif
+    (void)isa;
+    return scalar::min(v.data(), v.size());
+}
+
+template <typename T>
+[[nodiscard]] auto max(std::span<const T> v, Isa isa = detected_isa()) -> T {
+#ifdef TSDB_KERNELS_X86
+    switch (clamp_isa(isa)) {
+        case Isa::Avx512: if constexpr (Avx512Vectorized<T>) return avx512::extremum<T, false>(v.data(), v.size()); [[fallthrough]];
+        case Isa::Avx2:   if constexpr (Avx2Vectorized<T>)   return avx2::extremum<T, false>(v.data(), v.size());   [[fallthrough]];
+        case Isa::Scalar: break;
+    }
+#endif
+    (void)isa;
+    return scalar::max(v.data(), v.size());
+}
+
+// All reductions over one chunk. Each pass re-reads the chunk, which is small
+// enough to still be in L2 for the second and third pass.
+template <typename T>
+[[nodiscard]] auto summarize(std::span<const T> v, Isa isa = detected_isa()) -> Summary<T> {
+    if (v.empty()) return {};
+
+    return Summary<T> {
+        .sum   = sum(v, isa),
+        .min   = min(v, isa),
+        .max   = max(v, isa),
+        .count = v.size(),
+    };
+}
+
+// summarize() of the elements of v whose validity bit is set, where bit
+// first_bit + i of `valid` covers v[i]. Rows up to the next word boundary and
+// after the last whole word go through the scalar selects; whole words go
+// through the SIMD masks.
+template <typename T>
+[[nodiscard]] auto summarize_masked(std::span<const T> v, const u64* valid, size_t first_bit,
+                                    Isa isa = detected_isa()) -> Summary<T>
+{
+    const size_t head = std::min(v.size(), (64 - first_bit % 64) % 64);
+    const size_t body = (v.size() - head) / 64 * 64;
+
+    Summary<T> s = scalar::summarize_masked(v.data(), valid, first_bit, head);
+    const T*   p = v.data() + head;
+    const u64* w = valid + (first_bit + head) / 64;
+
+    Summary<T> mid;
+    bool       done = false;
+#ifdef TSDB_KERNELS_X86
+    switch (clamp_isa(isa)) {
+        case Isa::Avx512: if constexpr (Avx512Vectorized<T>) { mid = avx512::summarize_masked(p, w, body); done = true; break; } [[fallthrough]];
+        case Isa::Avx2:   if constexpr (Avx2Vectorized<T>)   { mid = avx2::summarize_masked(p, w, body);   done = true; break; } [[fallthrough]];
+        case Isa::Scalar: break;
+    }
+#endif
+    (void)isa;
+    if (!done) mid = scalar::summarize_masked(p, w, 0, body);
+
+    s.merge(mid);
+    s.merge(scalar::summarize_masked(p + body, valid, first_bit + head + body, v.size() - head - body));
+    return s;
+}
+
+// Selection bits of `v[i] op value`: bit i of out[i / 64] is set where it
+// holds, and bits of the last word past v.size() are cleared. Whole words go
+// through the SIMD compares, the rest through the scalar one.
+template <typename T>
+auto compare(std::span<const T> v, CmpOp op, T value, u64* out, Isa isa = detected_isa()) -> void {
+    const size_t body = v.size() / 64 * 64;
+
+    visit_op(op, [&]<CmpOp Op>() {
+        bool done = false;
+#ifdef TSDB_KERNELS_X86
+        switch (clamp_isa(isa)) {
+            case Isa::Avx512: if constexpr (Avx512Vectorized<T>) { avx512::compare<T, Op>(v.data(), body, value, out); done = true; break; } [[fallthrough]];
+            case Isa::Avx2:   if constexpr (Avx2Vectorized<T>)   { avx2::compare<T, Op>(v.data(), body, value, out);   done = true; break; } [[fallthrough]];
+            case Isa::Scalar: break;
+        }
+#endif
+        (void)isa;
+        if (!done) scalar::compare<Op>(v.data(), body, value, out);
+        scalar::compare<Op>(v.data() + body, v.size() - body, value, out + body / 64);
+    });
+}
+
+} // namespace kernels
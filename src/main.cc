@@ -2,8 +2,14 @@
 
 #include "tsdb.hh"
 
+#include <chrono>
+#include <cmath>
+#include <filesystem>
 #include <format>
-#include <print>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <thread>
 
 struct Vec3 {
     i64 timestamp_ns;
@@ -11,6 +17,7 @@ struct Vec3 {
     f64 y;
     f64 z;
 };
+TSDB_REFLECT(Vec3, x, y, z)
 
 template <>
 struct std::formatter<Vec3> {
@@ -27,121 +34,1105 @@ struct std::formatter<Vec3> {
     }
 };
 
-auto main() -> i32 {
-    TSDB db {1};
+static auto register_vec3(TSDB& db) -> TypeHandle {
+    return db.register_struct(
+        "Vec3", {
+            {"x", TSDB::F64},
+            {"y", TSDB::F64},
+            {"z", TSDB::F64},
+        });
+}
+
+static auto make_vec3s(size_t count, i64 first_ts = 0) -> std::vector<Vec3> {
+    std::vector<Vec3> rows(count);
+    for (size_t i = 0; i < count; ++i) {
+        const auto v = static_cast<f64>(i);
+        rows[i] = Vec3 { .timestamp_ns = first_ts + static_cast<i64>(i), .x = v, .y = v * 2, .z = v * 3 };
+    }
+    return rows;
+}
+
+// Each iteration fills a fresh table with the same number of rows so the
+// per-row cost is comparable across batch sizes.
+constexpr static size_t RowsPerIteration = 64 << 10;
+
+static void BM_RegisterStruct(benchmark::State& state) {
+    for (auto _ : state) {
+        TSDB db{1};
+        auto handle = register_vec3(db);
+        benchmark::DoNotOptimize(handle);
+    }
+}
+BENCHMARK(BM_RegisterStruct);
+
+static void BM_Insert_Single(benchmark::State& state) {
+    const auto rows = make_vec3s(RowsPerIteration);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        TSDB db{1};
+        auto vec3_handle = register_vec3(db);
+        state.ResumeTiming();
+
+        for (const auto& row : rows) {
+            db.insert(row, vec3_handle);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * RowsPerIteration);
+}
+BENCHMARK(BM_Insert_Single);
+
+// BM_Insert_Single through the reflected layout: per-field copies unrolled
+// with constant offsets.
+static void BM_Insert_Typed(benchmark::State& state) {
+    const auto rows = make_vec3s(RowsPerIteration);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        TSDB db{1};
+        auto vec3s = db.register_type<Vec3>().unwrap();
+        state.ResumeTiming();
+
+        for (const auto& row : rows) {
+            vec3s.insert_row(row);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * RowsPerIteration);
+}
+BENCHMARK(BM_Insert_Typed);
+
+// Sequential whole-row reads via the runtime field loop or the typed table.
+static void BM_Read_Rows(benchmark::State& state, bool typed) {
+    TSDB db{1};
+    auto vec3s = db.register_type<Vec3>().unwrap();
+    vec3s.insert_batch(make_vec3s(RowsPerIteration));
+    const Table& table = *db.table(vec3s.type());
+    Table::Cursor cur;
+
+    for (auto _ : state) {
+        f64 sum = 0;
+        for (size_t r = 0; r < RowsPerIteration; ++r) {
+            Vec3 v;
+            if (typed) v = vec3s.read_row(r, cur);
+            else       table.read_row(r, reinterpret_cast<std::byte*>(&v), cur);
+            sum += v.x + v.z;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * RowsPerIteration);
+}
+BENCHMARK_CAPTURE(BM_Read_Rows, runtime, false);
+BENCHMARK_CAPTURE(BM_Read_Rows, typed, true);
+
+static void BM_Insert_Batch(benchmark::State& state) {
+    const auto batch = static_cast<size_t>(state.range(0));
+    const auto rows  = make_vec3s(RowsPerIteration);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        TSDB db{1};
+        auto vec3_handle = register_vec3(db);
+        state.ResumeTiming();
+
+        for (size_t i = 0; i < rows.size(); i += batch) {
+            db.insert_batch(std::span(rows).subspan(i, std::min(batch, rows.size() - i)), vec3_handle);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * RowsPerIteration);
+}
+BENCHMARK(BM_Insert_Batch)->RangeMultiplier(8)->Range(1, RowsPerIteration);
+
+static void BM_Query_First(benchmark::State& state) {
+    TSDB db{1};
+    auto vec3_handle = register_vec3(db);
+    db.insert_batch(std::span<const Vec3>(make_vec3s(state.range(0))), vec3_handle);
+
+    for (auto _ : state) {
+        auto result = db.query_first<Vec3>(vec3_handle);
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_Query_First)->Range(8, 8<<10);
+
+// O(1) regardless of table size: served from the table's latest-row copy.
+static void BM_Query_Last(benchmark::State& state) {
+    TSDB db{1};
+    auto vec3_handle = register_vec3(db);
+    db.insert_batch(std::span<const Vec3>(make_vec3s(state.range(0))), vec3_handle);
+
+    for (auto _ : state) {
+        auto result = db.query_last<Vec3>(vec3_handle);
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_Query_Last)->Range(8, 8<<10);
+
+static void BM_FullWorkflow(benchmark::State& state) {
+    for (auto _ : state) {
+        TSDB db{1};
+        auto vec3_handle = register_vec3(db);
+
+        db.insert(Vec3{ .timestamp_ns = 1, .x = 1.0, .y = 2.0, .z = 3.0 }, vec3_handle);
+        auto result = db.query_first<Vec3>(vec3_handle);
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK(BM_FullWorkflow);
+
+constexpr static size_t ScanRows = 4 << 20;
+
+static auto make_scan_db(TableOptions options = {}) -> std::pair<std::unique_ptr<TSDB>, TypeHandle> {
+    auto db = std::make_unique<TSDB>(1, options);
+    auto vec3_handle = register_vec3(*db);
+
+    for (size_t i = 0; i < ScanRows; i += RowsPerIteration) {
+        const auto rows = make_vec3s(RowsPerIteration, static_cast<i64>(i));
+        db->insert_batch(std::span(rows), vec3_handle);
+    }
+    return { std::move(db), vec3_handle };
+}
+
+static void BM_Scan_Sequential(benchmark::State& state, TableMemory memory) {
+    auto [db, vec3_handle] = make_scan_db({ .memory = memory });
+    const Column& x = db->table(vec3_handle)->column(1);
+    Column::Cursor cur;
+
+    for (auto _ : state) {
+        f64 sum = 0;
+        for (size_t c = 0; c < x.chunk_count(); ++c) {
+            const auto chunk = x.chunk(c, cur);
+            const auto* v = reinterpret_cast<const f64*>(chunk.data());
+            for (size_t i = 0; i < chunk.size() / sizeof(f64); ++i) {
+                sum += v[i];
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetBytesProcessed(state.iterations() * ScanRows * sizeof(f64));
+    state.counters["huge_pages"] = db->table(vec3_handle)->arena() != nullptr
+        && db->table(vec3_handle)->arena()->using_huge_pages();
+}
+BENCHMARK_CAPTURE(BM_Scan_Sequential, heap, TableMemory::Heap);
+BENCHMARK_CAPTURE(BM_Scan_Sequential, huge_pages, TableMemory::HugePages);
+
+// Random row reconstruction touches every column at unrelated addresses,
+// which is where TLB reach matters most.
+static void BM_Scan_RandomRows(benchmark::State& state, TableMemory memory) {
+    auto [db, vec3_handle] = make_scan_db({ .memory = memory });
+    const Table& table = *db->table(vec3_handle);
+
+    std::mt19937_64 rng{42};
+    std::uniform_int_distribution<size_t> dist{0, ScanRows - 1};
+    std::vector<size_t> rows(1 << 16);
+    for (auto& r : rows) r = dist(rng);
+    Table::Cursor cur;
+
+    for (auto _ : state) {
+        f64 sum = 0;
+        for (size_t r : rows) {
+            Vec3 v;
+            table.read_row(r, reinterpret_cast<std::byte*>(&v), cur);
+            sum += v.x;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * rows.size());
+    state.SetBytesProcessed(state.iterations() * rows.size() * sizeof(Vec3));
+}
+BENCHMARK_CAPTURE(BM_Scan_RandomRows, heap, TableMemory::Heap);
+BENCHMARK_CAPTURE(BM_Scan_RandomRows, huge_pages, TableMemory::HugePages);
+
+// Sums x over a window of `range(0)` rows in the middle of a 4M row table.
+static void BM_Query_Range(benchmark::State& state) {
+    auto [db, vec3_handle] = make_scan_db();
+    const auto window = state.range(0);
+    constexpr i64 start = ScanRows / 2;
+
+    for (auto _ : state) {
+        f64 sum = 0;
+        for (const Vec3& v : db->query_range<Vec3>(vec3_handle, start, start + window)) {
+            sum += v.x;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * window);
+}
+BENCHMARK(BM_Query_Range)->Range(1, 8<<10);
+
+// Same windows as BM_Query_Range, but reading x straight from column storage.
+static void BM_Column_Range(benchmark::State& state) {
+    auto [db, vec3_handle] = make_scan_db();
+    const auto window = state.range(0);
+    constexpr i64 start = ScanRows / 2;
+
+    const auto x = db->field<f64>(vec3_handle, "x").unwrap();
+
+    for (auto _ : state) {
+        f64 sum = 0;
+        for (std::span<const f64> chunk : db->column(x, start, start + window).chunks()) {
+            for (f64 v : chunk) sum += v;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * window);
+}
+BENCHMARK(BM_Column_Range)->Range(1, 8<<10);
+
+// Kernel throughput over one column chunk; range(0) is the kernels::Isa.
+template <typename T, typename Kernel>
+static void run_kernel(benchmark::State& state, Kernel kernel) {
+    const auto isa = static_cast<kernels::Isa>(state.range(0));
+    if (kernels::clamp_isa(isa) != isa) {
+        state.SkipWithError("ISA not supported on this CPU");
+        return;
+    }
+
+    std::vector<T> data(ChunkRows);
+    std::mt19937_64 rng{7};
+    for (auto& v : data) v = static_cast<T>(rng() % 1000);
+
+    for (auto _ : state) {
+        auto r = kernel(std::span<const T>(data), isa);
+        benchmark::DoNotOptimize(r);
+    }
+
+    state.SetBytesProcessed(state.iterations() * data.size() * sizeof(T));
+}
+
+template <typename T>
+static void BM_Kernel_Sum(benchmark::State& state) {
+    run_kernel<T>(state, [](auto v, auto isa) { return kernels::sum(v, isa); });
+}
+
+template <typename T>
+static void BM_Kernel_Min(benchmark::State& state) {
+    run_kernel<T>(state, [](auto v, auto isa) { return kernels::min(v, isa); });
+}
+
+template <typename T>
+static void BM_Kernel_Max(benchmark::State& state) {
+    run_kernel<T>(state, [](auto v, auto isa) { return kernels::max(v, isa); });
+}
+
+#define KERNEL_BENCHMARKS(T)                                       \
+    BENCHMARK_TEMPLATE(BM_Kernel_Sum, T)->DenseRange(0, 2);        \
+    BENCHMARK_TEMPLATE(BM_Kernel_Min, T)->DenseRange(0, 2);        \
+    BENCHMARK_TEMPLATE(BM_Kernel_Max, T)->DenseRange(0, 2)
+
+KERNEL_BENCHMARKS(f64);
+KERNEL_BENCHMARKS(f32);
+KERNEL_BENCHMARKS(i64);
+KERNEL_BENCHMARKS(i32);
+KERNEL_BENCHMARKS(u32);
+
+// End to end: field lookup by name, TypeKind dispatch and all reductions.
+static void BM_Aggregate_Range(benchmark::State& state) {
+    auto [db, vec3_handle] = make_scan_db();
+    const auto window = state.range(0);
+    constexpr i64 start = 0;
+
+    for (auto _ : state) {
+        auto r = db->aggregate(vec3_handle, "x", start, start + window);
+        benchmark::DoNotOptimize(r);
+    }
+
+    state.SetBytesProcessed(state.iterations() * window * sizeof(f64));
+}
+BENCHMARK(BM_Aggregate_Range)->Range(1 << 10, ScanRows);
+
+// Downsampling the whole scan table; the argument is the bucket width in ns
+// (one row per ns), so it sets how many buckets the rows are split across.
+static void BM_Aggregate_Buckets(benchmark::State& state) {
+    auto [db, vec3_handle] = make_scan_db();
+    const auto x         = db->field<f64>(vec3_handle, "x").unwrap();
+    const auto bucket_ns = static_cast<i64>(state.range(0));
+
+    for (auto _ : state) {
+        auto r = db->aggregate(x, 0, static_cast<i64>(ScanRows), bucket_ns,
+                               { AggOp::Min, AggOp::Max, AggOp::Avg, AggOp::Count });
+        benchmark::DoNotOptimize(r);
+    }
+
+    state.SetItemsProcessed(state.iterations() * ScanRows);
+}
+BENCHMARK(BM_Aggregate_Buckets)->RangeMultiplier(16)->Range(64, 1 << 20);
+
+// Batched insert cost with 0, 1 or 3 rollups maintained on the same type.
+static void BM_Insert_Rollup(benchmark::State& state) {
+    const auto rows    = make_vec3s(RowsPerIteration);
+    const auto rollups = state.range(0);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        TSDB db{1};
+        auto vec3_handle = register_vec3(db);
+        constexpr const char* fields[] = { "x", "y", "z" };
+        for (i64 i = 0; i < rollups; ++i) {
+            (void)db.register_rollup(vec3_handle, fields[i], 1000);
+        }
+        state.ResumeTiming();
+
+        for (size_t i = 0; i < RowsPerIteration; i += 1024) {
+            db.insert_batch(std::span(rows).subspan(i, 1024), vec3_handle);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * RowsPerIteration);
+}
+BENCHMARK(BM_Insert_Rollup)->Arg(0)->Arg(1)->Arg(3);
+
+// Min/max/mean over the whole scan table, from the raw column or from a
+// 4096ns rollup of it.
+static void BM_Rollup_Query(benchmark::State& state, bool use_rollup) {
+    auto db = std::make_unique<TSDB>(1);
+    auto vec3_handle   = register_vec3(*db);
+    auto rollup_handle = db->register_rollup(vec3_handle, "x", 4096).unwrap();
+
+    for (size_t i = 0; i < ScanRows; i += RowsPerIteration) {
+        const auto rows = make_vec3s(RowsPerIteration, static_cast<i64>(i));
+        db->insert_batch(std::span(rows), vec3_handle);
+    }
+
+    for (auto _ : state) {
+        if (use_rollup) {
+            auto mins = db->aggregate(rollup_handle, "min", 0, ScanRows);
+            auto maxs = db->aggregate(rollup_handle, "max", 0, ScanRows);
+            auto sums = db->aggregate(rollup_handle, "sum", 0, ScanRows);
+            auto cnts = db->aggregate(rollup_handle, "count", 0, ScanRows);
+            benchmark::DoNotOptimize(mins);
+            benchmark::DoNotOptimize(maxs);
+            benchmark::DoNotOptimize(sums.unwrap().sum / cnts.unwrap().sum);
+        } else {
+            auto r = db->aggregate(vec3_handle, "x", 0, ScanRows);
+            benchmark::DoNotOptimize(r.unwrap().mean());
+        }
+    }
+}
+BENCHMARK_CAPTURE(BM_Rollup_Query, raw, false);
+BENCHMARK_CAPTURE(BM_Rollup_Query, rollup, true);
+
+// Steady-state ingest into one table kept by a TTL of four chunks (0 = keep
+// everything). Expiry drops a whole chunk at a time, so resident memory stays
+// flat while the unbounded table grows with every iteration.
+static void BM_Insert_Retention(benchmark::State& state) {
+    const i64 ttl_ns = state.range(0);
+
+    TSDB db{1};
+    auto vec3_handle = register_vec3(db);
+    if (ttl_ns > 0) db.set_retention(vec3_handle, ttl_ns);
+
+    i64 next_ts = 0;
+    for (auto _ : state) {
+        const auto rows = make_vec3s(RowsPerIteration, next_ts);
+        next_ts += RowsPerIteration;
+
+        for (size_t i = 0; i < RowsPerIteration; i += 1024) {
+            db.insert_batch(std::span(rows).subspan(i, 1024), vec3_handle);
+        }
+    }
+
+    state.counters["resident_mb"] = static_cast<f64>(db.table(vec3_handle)->memory_bytes()) / (1 << 20);
+    state.SetItemsProcessed(state.iterations() * RowsPerIteration);
+}
+BENCHMARK(BM_Insert_Retention)->Arg(0)->Arg(4 * ChunkRows)->Iterations(64);
+
+// Batches of 1024 rows through a 4096ns lateness window. With jitter > 0 each
+// row's timestamp lags by up to that many ns, so most batches are merged into
+// the staging buffer instead of appended to it.
+static void BM_Insert_OutOfOrder(benchmark::State& state) {
+    const auto jitter = static_cast<u64>(state.range(0));
+
+    auto rows = make_vec3s(RowsPerIteration);
+    if (jitter > 0) {
+        std::mt19937_64 rng { 42 };
+        for (Vec3& v : rows) v.timestamp_ns = std::max<i64>(0, v.timestamp_ns - static_cast<i64>(rng() % jitter));
+    }
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        TSDB db{1};
+        auto vec3_handle = register_vec3(db);
+        db.set_lateness(vec3_handle, 4096);
+        state.ResumeTiming();
+
+        for (size_t i = 0; i < RowsPerIteration; i += 1024) {
+            db.insert_batch(std::span<const Vec3>(rows).subspan(i, 1024), vec3_handle);
+        }
+        db.flush_staged(vec3_handle);
+    }
+
+    state.SetItemsProcessed(state.iterations() * RowsPerIteration);
+}
+BENCHMARK(BM_Insert_OutOfOrder)->Arg(0)->Arg(64)->Arg(4096);
+
+// x repeats 0..64K-1 in every chunk, so a narrow band of x values lives in
+// one ZoneRows block per chunk and the zone maps skip the other fifteen.
+static void BM_Query_Where(benchmark::State& state) {
+    auto [db, vec3_handle] = make_scan_db();
+    const auto x = db->field<f64>(vec3_handle, "x").unwrap();
+
+    size_t matched = 0;
+    for (auto _ : state) {
+        auto rows = db->query_where<Vec3>(x, 1000.0, 1010.0, 0, ScanRows);
+        matched = rows.size();
+        benchmark::DoNotOptimize(rows);
+    }
+
+    state.counters["matched"] = static_cast<f64>(matched);
+    state.SetItemsProcessed(state.iterations() * ScanRows);
+}
+BENCHMARK(BM_Query_Where);
+
+// The same predicate without zone maps: every row of the range is read.
+static void BM_Query_Where_FullScan(benchmark::State& state) {
+    auto [db, vec3_handle] = make_scan_db();
+
+    size_t matched = 0;
+    for (auto _ : state) {
+        std::vector<Vec3> rows;
+        for (const Vec3& v : db->query_range<Vec3>(vec3_handle, 0, ScanRows)) {
+            if (v.x >= 1000.0 && v.x <= 1010.0) rows.push_back(v);
+        }
+        matched = rows.size();
+        benchmark::DoNotOptimize(rows);
+    }
+
+    state.counters["matched"] = static_cast<f64>(matched);
+    state.SetItemsProcessed(state.iterations() * ScanRows);
+}
+BENCHMARK(BM_Query_Where_FullScan);
+
+// BM_Query_Where's band as a Filter: both compares run over x a block at a
+// time, and read_row assembles only the rows that pass.
+static void BM_Filter_Select(benchmark::State& state) {
+    auto [db, vec3_handle] = make_scan_db();
+    const auto x    = db->field<f64>(vec3_handle, "x").unwrap();
+    const auto band = where(x, CmpOp::Ge, 1000.0) && where(x, CmpOp::Le, 1010.0);
+
+    size_t matched = 0;
+    for (auto _ : state) {
+        auto rows = db->select<Vec3>(band, 0, ScanRows);
+        matched = rows.size();
+        benchmark::DoNotOptimize(rows);
+    }
+
+    state.counters["matched"] = static_cast<f64>(matched);
+    state.SetItemsProcessed(state.iterations() * ScanRows);
+}
+BENCHMARK(BM_Filter_Select);
+
+// 1000 sensors sampled round-robin, 1000 points each. One sensor's points in
+// a time window, either from its own series table or filtered out of a
+// single table holding every sensor.
+struct Reading {
+    i64 timestamp_ns;
+    u64 sensor;
+    f64 value;
+};
+
+constexpr static size_t Sensors           = 1000;
+constexpr static size_t ReadingsPerSensor = 1000;
+
+static void BM_Series_Range(benchmark::State& state, bool per_series) {
+    TSDB db{1};
+    auto reading = db.register_struct("Reading", { {"sensor", TSDB::U64}, {"value", TSDB::F64} });
+
+    std::vector<SeriesHandle> series;
+    for (size_t s = 0; s < Sensors; ++s) {
+        series.push_back(db.series(reading, { {"sensor_id", std::to_string(s)} }));
+    }
+
+    for (size_t i = 0; i < ReadingsPerSensor; ++i) {
+        for (size_t s = 0; s < Sensors; ++s) {
+            const Reading r { .timestamp_ns = static_cast<i64>(i * Sensors + s), .sensor = s, .value = 1.0 };
+            if (per_series) db.insert(r, series[s]);
+            else            db.insert(r, reading);
+        }
+    }
 
-    auto vec3_handle = db.register_struct(
-    "Vec3", {
-    	{"x", TSDB::F64},
-    	{"y", TSDB::F64},
-    	{"z", TSDB::F64},
+    constexpr u64 sensor = 42;
+    constexpr i64 start  = Sensors * ReadingsPerSensor / 2;
+    constexpr i64 end    = start + 100 * Sensors;
+
+    size_t matched = 0;
+    for (auto _ : state) {
+        f64 sum = 0;
+        matched = 0;
+        if (per_series) {
+            for (const Reading& r : db.query_range<Reading>(series[sensor], start, end)) {
+                sum += r.value;
+                ++matched;
+            }
+        } else {
+            for (const Reading& r : db.query_range<Reading>(reading, start, end)) {
+                if (r.sensor != sensor) continue;
+                sum += r.value;
+                ++matched;
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.counters["matched"] = static_cast<f64>(matched);
+}
+BENCHMARK_CAPTURE(BM_Series_Range, shared_table, false);
+BENCHMARK_CAPTURE(BM_Series_Range, per_series, true);
+
+// Series selection over 1M series: 10 regions, 100K hosts (half web-*, half
+// db-*) with 10 series each, queried as region="us-east" AND host=~"web.*".
+static void BM_Tag_Select(benchmark::State& state) {
+    constexpr u32 SeriesCount = 1 << 20;
+    constexpr u32 Hosts       = 100'000;
+
+    TagIndex index;
+    for (u32 id = 0; id < SeriesCount; ++id) {
+        const u32 host = id % Hosts;
+        index.add(id, {
+            { "host",   std::format("{}-{}", host % 2 == 0 ? "web" : "db", host) },
+            { "region", (id / Hosts) % 10 == 0 ? std::string("us-east") : std::format("r{}", (id / Hosts) % 10) },
+        });
+    }
+
+    const TagMatcher matchers[] = {
+        { "region", TagMatcher::Op::Eq,    "us-east" },
+        { "host",   TagMatcher::Op::Regex, state.range(0) == 0 ? "web.*" : "web-1[0-9]+6" },
+    };
+
+    u64 matched = 0;
+    for (auto _ : state) {
+        const auto ids = index.select(matchers);
+        matched = ids.cardinality();
+        benchmark::DoNotOptimize(matched);
+    }
+
+    state.counters["matched"] = static_cast<f64>(matched);
+}
+BENCHMARK(BM_Tag_Select)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+// HTTP-log-like rows with SYMBOL host and status fields: 100 hosts and four
+// status codes, interned once and stored as u32 ids.
+struct Request {
+    i64 timestamp_ns;
+    u32 host;
+    u32 status;
+    f64 latency;
+};
+
+static auto make_requests(TSDB& db) -> TypeHandle {
+    auto type = db.register_struct("Request", {
+        {"host",    TSDB::SYMBOL},
+        {"status",  TSDB::SYMBOL},
+        {"latency", TSDB::F64},
     });
 
-    db.insert(Vec3 { .timestamp_ns = 100, .x = 1, .y = 1, .z = 1}, vec3_handle);
-
-    auto new_vec = db.query_first<Vec3>(vec3_handle);
-    std::println("{}", new_vec);
-
-    return 0;
-}
-
-
-// static void BM_RegisterStruct(benchmark::State& state) {
-//     for (auto _ : state) {
-//         TSDB db{1};
-//         auto handle = db.register_struct(
-//             "Vec3", {
-//                 {"x", TSDB::F64},
-//                 {"y", TSDB::F64},
-//                 {"z", TSDB::F64},
-//             });
-//         benchmark::DoNotOptimize(handle);
-//     }
-// }
-// BENCHMARK(BM_RegisterStruct);
-
-// static void BM_Insert_Single(benchmark::State& state) {
-//     TSDB db{1};
-//     auto vec3_handle = db.register_struct(
-//         "Vec3", {
-//             {"x", TSDB::F64},
-//             {"y", TSDB::F64},
-//             {"z", TSDB::F64},
-//         });
-    
-//     for (auto _ : state) {
-//         db.insert(Vec3{1.0, 2.0, 3.0}, vec3_handle);
-//     }
-    
-//     state.SetItemsProcessed(state.iterations());
-// }
-// BENCHMARK(BM_Insert_Single);
-
-// static void BM_Insert_Bulk(benchmark::State& state) {
-//     TSDB db{1};
-//     auto vec3_handle = db.register_struct(
-//         "Vec3", {
-//             {"x", TSDB::F64},
-//             {"y", TSDB::F64},
-//             {"z", TSDB::F64},
-//         });
-    
-//     const auto count = state.range(0);
-    
-//     for (auto _ : state) {
-//         for (int i = 0; i < count; ++i) {
-//             db.insert(Vec3 {
-//                 static_cast<double>(i),
-//                 static_cast<double>(i * 2),
-//                 static_cast<double>(i * 3)
-//             }, vec3_handle);
-//         }
-//     }
-    
-//     state.SetItemsProcessed(state.iterations() * count);
-// }
-// BENCHMARK(BM_Insert_Bulk)->Range(8, 8<<10);
-
-// static void BM_Query_First(benchmark::State& state) {
-//     TSDB db{1};
-//     auto vec3_handle = db.register_struct(
-//         "Vec3", {
-//             {"x", TSDB::F64},
-//             {"y", TSDB::F64},
-//             {"z", TSDB::F64},
-//         });
-    
-//     const auto count = state.range(0);
-//     for (int i = 0; i < count; ++i) {
-//         db.insert(Vec3 {
-//             static_cast<double>(i),
-//             static_cast<double>(i),
-//             static_cast<double>(i)
-//         }, vec3_handle);
-//     }
-    
-//     for (auto _ : state) {
-//         auto result = db.query_first<Vec3>(vec3_handle);
-//         benchmark::DoNotOptimize(result);
-//     }
-// }
-// BENCHMARK(BM_Query_First)->Range(8, 8<<10);
-
-// static void BM_FullWorkflow(benchmark::State& state) {
-//     for (auto _ : state) {
-//         TSDB db{1};
-//         auto vec3_handle = db.register_struct(
-//             "Vec3", {
-//                 {"x", TSDB::F64},
-//                 {"y", TSDB::F64},
-//                 {"z", TSDB::F64},
-//             });
-        
-//         db.insert(Vec3{1.0, 2.0, 3.0}, vec3_handle);
-//         auto result = db.query_first<Vec3>(vec3_handle);
-//         benchmark::DoNotOptimize(result);
-//     }
-// }
-// BENCHMARK(BM_FullWorkflow);
-
-// BENCHMARK_MAIN();
+    constexpr std::string_view codes[] = { "200", "301", "404", "500" };
+
+    std::vector<Request> rows(RowsPerIteration);
+    for (size_t i = 0; i < rows.size(); ++i) {
+        rows[i] = {
+            .timestamp_ns = static_cast<i64>(i),
+            .host         = db.symbol(type, std::format("host-{}", i % 100)),
+            .status       = db.symbol(type, codes[i % 7 % 4]),
+            .latency      = static_cast<f64>(i % 1000) * 0.1,
+        };
+    }
+    db.insert_batch(std::span<const Request>(rows), type);
+    return type;
+}
+
+// Dictionary lookups from concurrent readers while nothing is interned; the
+// read path takes no lock, so this should scale with threads.
+static void BM_Symbol_Find(benchmark::State& state) {
+    static std::unique_ptr<TSDB> db;
+    static TypeHandle            type { 0 };
+
+    if (state.thread_index() == 0) {
+        db   = std::make_unique<TSDB>(1);
+        type = make_requests(*db);
+    }
+
+    std::vector<std::string> names;
+    for (u32 i = 0; i < 100; ++i) names.push_back(std::format("host-{}", i));
+
+    u64 found = 0;
+    for (auto _ : state) {
+        for (const auto& n : names) found += db->find_symbol(type, n).unwrap();
+    }
+    benchmark::DoNotOptimize(found);
+    state.SetItemsProcessed(state.iterations() * static_cast<i64>(names.size()));
+
+    if (state.thread_index() == 0) db.reset();
+}
+BENCHMARK(BM_Symbol_Find)->ThreadRange(1, 8)->UseRealTime();
+
+// Mean latency per status code: an equality filter on one symbol and a
+// group-by over it, both comparing ids.
+static void BM_Symbol_GroupBy(benchmark::State& state) {
+    TSDB db{1};
+    const auto type    = make_requests(db);
+    const auto status  = db.field<u32>(type, "status").unwrap();
+    const auto latency = db.field<f64>(type, "latency").unwrap();
+
+    f64 mean = 0;
+    for (auto _ : state) {
+        const auto groups = db.aggregate_by(status, latency, 0, std::numeric_limits<i64>::max());
+        const auto& g     = groups[db.find_symbol(type, "500").unwrap()];
+        mean = g.sum / static_cast<f64>(g.count);
+        benchmark::DoNotOptimize(mean);
+    }
+
+    state.counters["mean_500"] = mean;
+    state.SetItemsProcessed(state.iterations() * RowsPerIteration);
+}
+BENCHMARK(BM_Symbol_GroupBy);
+
+// Variable-length annotations of 16-512 bytes in a BYTES field. Reads walk the
+// ref column and touch each payload in place in the arena.
+struct Annotation {
+    i64     timestamp_ns;
+    BlobRef body;
+};
+TSDB_REFLECT(Annotation, body)
+
+static void BM_Bytes_Read(benchmark::State& state) {
+    TSDB db{1};
+    auto table = db.register_type<Annotation>().unwrap();
+
+    std::mt19937_64 rng{5};
+    std::vector<std::byte> payload(512);
+    for (size_t i = 0; i < RowsPerIteration; ++i) {
+        const size_t n = 16 + rng() % (payload.size() - 16);
+        std::ranges::fill(payload, static_cast<std::byte>(i));
+        table.insert_row({ static_cast<i64>(i), db.append_bytes(table.type(), std::span(payload).first(n)) });
+    }
+
+    const auto body = db.column<BlobRef>(table.type(), "body").unwrap();
+
+    u64 checksum = 0;
+    for (auto _ : state) {
+        for (std::span<const BlobRef> chunk : body.chunks()) {
+            for (const BlobRef ref : chunk) {
+                const auto bytes = db.read_bytes(table.type(), ref);
+                checksum += bytes.size() + static_cast<u64>(bytes.back());
+            }
+        }
+        benchmark::DoNotOptimize(checksum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * RowsPerIteration);
+}
+BENCHMARK(BM_Bytes_Read);
+
+// Aggregates over a field with a null in every ~10th row: the nullable column
+// is reduced with the validity bitmap as a lane mask, the dense one as is.
+struct Gauge {
+    i64           timestamp_ns;
+    Nullable<f64> value;
+};
+TSDB_REFLECT(Gauge, value)
+
+static void BM_Aggregate_Nullable(benchmark::State& state, bool nullable) {
+    TSDB db{1};
+    const TypeHandle type = nullable ? db.register_type<Gauge>().unwrap().type()
+                                     : db.register_struct("Dense", { {"value", TSDB::F64} });
+
+    std::mt19937_64 rng{13};
+    std::vector<Gauge> rows(ScanRows);
+    for (size_t i = 0; i < ScanRows; ++i) {
+        const f64 v = static_cast<f64>(rng() % 1000);
+        rows[i] = { static_cast<i64>(i), rng() % 10 == 0 ? Nullable<f64>{None} : Nullable<f64>{v} };
+    }
+    if (nullable) {
+        db.insert_batch(std::span<const Gauge>(rows), type);
+    } else {
+        struct Dense { i64 timestamp_ns; f64 value; };
+        std::vector<Dense> dense(ScanRows);
+        for (size_t i = 0; i < ScanRows; ++i) dense[i] = { rows[i].timestamp_ns, rows[i].value.value };
+        db.insert_batch(std::span<const Dense>(dense), type);
+    }
+
+    const auto value = db.field<f64>(type, "value").unwrap();
+    for (auto _ : state) {
+        auto r = db.aggregate(value, 0, static_cast<i64>(ScanRows));
+        benchmark::DoNotOptimize(r);
+    }
+
+    state.SetBytesProcessed(state.iterations() * ScanRows * sizeof(f64));
+}
+BENCHMARK_CAPTURE(BM_Aggregate_Nullable, dense, false);
+BENCHMARK_CAPTURE(BM_Aggregate_Nullable, nullable, true);
+
+// Adding a field to a populated table. Existing rows are neither copied nor
+// written, so the time should barely move with their number; `bytes` is the
+// memory the new columns took.
+static void BM_Add_Field(benchmark::State& state) {
+    TSDB db{1};
+    const TypeHandle type = db.register_struct("Evolving", { {"value", TSDB::F64} });
+
+    struct Row { i64 timestamp_ns; f64 value; };
+    std::vector<Row> rows(static_cast<size_t>(state.range(0)));
+    for (size_t i = 0; i < rows.size(); ++i) rows[i] = { static_cast<i64>(i), static_cast<f64>(i) };
+    db.insert_batch(std::span<const Row>(rows), type);
+
+    const size_t before = db.table(type)->memory_bytes();
+    size_t n = 0;
+    for (auto _ : state) {
+        auto v = db.add_field(type, "f" + std::to_string(n++), db.nullable(TSDB::F64));
+        benchmark::DoNotOptimize(v);
+    }
+
+    state.counters["bytes"] = static_cast<f64>(db.table(type)->memory_bytes() - before);
+}
+BENCHMARK(BM_Add_Field)->Arg(1 << 16)->Arg(1 << 20)->Arg(1 << 24)->Iterations(64)->Unit(benchmark::kMicrosecond);
+
+// Latency of slow requests that hit a few hosts or failed, over random
+// columns no zone map can prune. `engine` runs the filter's SIMD compares and
+// hands the selection bitmasks to the masked kernels; the baseline tests the
+// three fields of each row with branches, like a row-at-a-time scan.
+struct Event {
+    i64 timestamp_ns;
+    u32 host;
+    i32 status;
+    f64 latency;
+};
+TSDB_REFLECT(Event, host, status, latency)
+
+static void BM_Filter_Aggregate(benchmark::State& state, bool engine) {
+    TSDB db{1};
+    const TypeHandle type = db.register_type<Event>().unwrap().type();
+
+    std::mt19937_64 rng{17};
+    std::vector<Event> rows(ScanRows);
+    for (size_t i = 0; i < ScanRows; ++i) {
+        rows[i] = {
+            .timestamp_ns = static_cast<i64>(i),
+            .host         = static_cast<u32>(rng() % 64),
+            .status       = rng() % 16 == 0 ? 500 : 200,
+            .latency      = static_cast<f64>(rng() % 1000) * 0.1,
+        };
+    }
+    db.insert_batch(std::span<const Event>(rows), type);
+
+    const auto host    = db.field<u32>(type, "host").unwrap();
+    const auto status  = db.field<i32>(type, "status").unwrap();
+    const auto latency = db.field<f64>(type, "latency").unwrap();
+    const auto slow    = where(latency, CmpOp::Gt, 90.0) && (where(host, CmpOp::Lt, 8) || where(status, CmpOp::Eq, 500));
+
+    u64 matched = 0;
+    for (auto _ : state) {
+        kernels::Summary<f64> s;
+        if (engine) {
+            s = db.aggregate(latency, slow, 0, static_cast<i64>(ScanRows));
+        } else {
+            const Table& t = *db.table(type);
+            Column::Cursor h_cur, st_cur, l_cur;
+            for (size_t c = 0; c < t.column(0).chunk_count(); ++c) {
+                const auto h  = t.column(host.column()).chunk_as<u32>(c, h_cur);
+                const auto st = t.column(status.column()).chunk_as<i32>(c, st_cur);
+                const auto l  = t.column(latency.column()).chunk_as<f64>(c, l_cur);
+                for (size_t i = 0; i < l.size(); ++i) {
+                    if (!(l[i] > 90.0 && (h[i] < 8 || st[i] == 500))) continue;
+                    s.sum += l[i];
+                    s.min  = std::min(s.min, l[i]);
+                    s.max  = std::max(s.max, l[i]);
+                    s.count++;
+                }
+            }
+        }
+        matched = s.count;
+        benchmark::DoNotOptimize(s);
+    }
+
+    state.counters["matched"] = static_cast<f64>(matched);
+    state.SetItemsProcessed(state.iterations() * ScanRows);
+}
+BENCHMARK_CAPTURE(BM_Filter_Aggregate, row_at_a_time, false);
+BENCHMARK_CAPTURE(BM_Filter_Aggregate, engine, true);
+
+// Sensor-like series: 1ms sampling with a little jitter, slowly drifting
+// values quantized to 0.01 and a small integer status code.
+static auto make_sensor_column(size_t n) -> std::tuple<std::vector<i64>, std::vector<f64>, std::vector<i32>> {
+    std::vector<i64> ts(n);
+    std::vector<f64> vals(n);
+    std::vector<i32> codes(n);
+
+    std::mt19937_64 rng{11};
+    i64 t = 1'700'000'000'000'000'000;
+    f64 v = 20.0;
+    for (size_t i = 0; i < n; ++i) {
+        t += 1'000'000 + static_cast<i64>(rng() % 3 == 0 ? rng() % 1000 : 0);
+        v += static_cast<f64>(static_cast<i64>(rng() % 5) - 2) * 0.01;
+        ts[i]    = t;
+        vals[i]  = std::round(v * 100) / 100;
+        codes[i] = static_cast<i32>(rng() % 8 == 0 ? 500 : 200);
+    }
+    return { std::move(ts), std::move(vals), std::move(codes) };
+}
+
+template <typename T, typename Encode, typename Decode>
+static void run_codec(benchmark::State& state, const std::vector<T>& raw, Encode encode, Decode decode) {
+    const gorilla::Encoded e = encode(std::span<const T>(raw));
+    std::vector<T> out(raw.size());
+
+    for (auto _ : state) {
+        decode(e, std::span<T>(out));
+        benchmark::DoNotOptimize(out.data());
+    }
+
+    if (out != raw) state.SkipWithError("round trip mismatch");
+
+    state.SetBytesProcessed(state.iterations() * raw.size() * sizeof(T));
+    state.counters["ratio"] = static_cast<f64>(raw.size() * sizeof(T)) / static_cast<f64>(e.size_bytes());
+}
+
+static void BM_Decode_Timestamps(benchmark::State& state) {
+    const auto [ts, vals, codes] = make_sensor_column(ChunkRows);
+    run_codec<i64>(state, ts, gorilla::encode_timestamps, gorilla::decode_timestamps);
+}
+BENCHMARK(BM_Decode_Timestamps);
+
+static void BM_Decode_Xor(benchmark::State& state) {
+    const auto [ts, vals, codes] = make_sensor_column(ChunkRows);
+    run_codec<f64>(state, vals,
+                   [](auto v) { return gorilla::encode_xor(v); },
+                   [](auto& e, auto out) { gorilla::decode_xor(e, out); });
+}
+BENCHMARK(BM_Decode_Xor);
+
+static void BM_Decode_BitPack(benchmark::State& state) {
+    const auto [ts, vals, codes] = make_sensor_column(ChunkRows);
+    run_codec<i32>(state, codes,
+                   [](auto v) { return gorilla::encode_bitpack(v); },
+                   [](auto& e, auto out) { gorilla::decode_bitpack(e, out); });
+}
+BENCHMARK(BM_Decode_BitPack);
+
+// Full-table aggregate with raw vs sealed-and-encoded chunks; `ratio` is the
+// table's raw size over its in-memory size.
+static void BM_Aggregate_Compressed(benchmark::State& state, bool compress) {
+    TSDB db{1, { .compress_sealed = compress }};
+    auto handle = db.register_struct("Sensor", { {"value", TSDB::F64}, {"code", TSDB::I32} });
+
+    struct Sensor { i64 timestamp_ns; f64 value; i32 code; };
+    const auto [ts, vals, codes] = make_sensor_column(ScanRows);
+    std::vector<Sensor> rows(ScanRows);
+    for (size_t i = 0; i < ScanRows; ++i) rows[i] = { ts[i], vals[i], codes[i] };
+    db.insert_batch(std::span<const Sensor>(rows), handle);
+
+    for (auto _ : state) {
+        auto r = db.aggregate(handle, "value", ts.front(), ts.back() + 1);
+        benchmark::DoNotOptimize(r);
+    }
+
+    const size_t raw_bytes = ScanRows * (sizeof(i64) + sizeof(f64) + sizeof(i32));
+    state.SetBytesProcessed(state.iterations() * ScanRows * sizeof(f64));
+    state.counters["ratio"] = static_cast<f64>(raw_bytes) / static_cast<f64>(db.table(handle)->memory_bytes());
+}
+BENCHMARK_CAPTURE(BM_Aggregate_Compressed, raw, false);
+BENCHMARK_CAPTURE(BM_Aggregate_Compressed, compressed, true);
+
+// Reopening maps each segment and reads its header and zones; the column data
+// is not touched, so the cost should follow the segment count, not the rows.
+static void BM_Segment_Open(benchmark::State& state) {
+    const auto segments         = static_cast<size_t>(state.range(0));
+    const auto rows_per_segment = static_cast<size_t>(state.range(1)) * ChunkRows;
+    const auto dir              = std::filesystem::temp_directory_path();
+
+    std::vector<std::string> paths;
+    {
+        TSDB db{1};
+        auto vec3_handle = register_vec3(db);
+        for (size_t s = 0; s < segments; ++s) {
+            const auto rows = make_vec3s(rows_per_segment, static_cast<i64>(s * rows_per_segment));
+            db.insert_batch(std::span(rows), vec3_handle);
+            paths.push_back((dir / std::format("rstd_bench_{}.seg", s)).string());
+            (void)db.flush_segment(vec3_handle, paths.back()).expect("flush_segment");
+        }
+    }
+
+    for (auto _ : state) {
+        TSDB db{1};
+        auto vec3_handle = register_vec3(db);
+        for (const auto& path : paths) {
+            (void)db.open_segment(path).expect("open_segment");
+        }
+        benchmark::DoNotOptimize(db.table(vec3_handle)->row_count());
+    }
+
+    state.counters["rows"] = static_cast<f64>(segments * rows_per_segment);
+    for (const auto& path : paths) std::filesystem::remove(path);
+}
+BENCHMARK(BM_Segment_Open)->ArgsProduct({ { 1, 8, 64 }, { 1, 64 } });
+
+// Insert throughput with every row batch logged first; the argument is the
+// batch size, so PerBatch pays one fsync per insert_batch call.
+static void BM_Insert_Wal(benchmark::State& state, wal::Fsync fsync) {
+    const auto batch = static_cast<size_t>(state.range(0));
+    const auto rows  = make_vec3s(RowsPerIteration);
+    const auto path  = (std::filesystem::temp_directory_path() / "rstd_bench.wal").string();
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::filesystem::remove(path);
+        auto db = std::make_unique<TSDB>(1);
+        auto vec3_handle = register_vec3(*db);
+        (void)db->open_wal(path, { .fsync = fsync }).expect("open_wal");
+        state.ResumeTiming();
+
+        for (size_t i = 0; i < RowsPerIteration; i += batch) {
+            db->insert_batch(std::span(rows).subspan(i, batch), vec3_handle);
+        }
+
+        // Closing the log writes out what None and Interval still buffer.
+        db.reset();
+    }
+
+    std::filesystem::remove(path);
+    state.SetItemsProcessed(state.iterations() * RowsPerIteration);
+}
+BENCHMARK_CAPTURE(BM_Insert_Wal, per_batch, wal::Fsync::PerBatch)->Arg(1 << 10)->Arg(RowsPerIteration)->UseRealTime();
+BENCHMARK_CAPTURE(BM_Insert_Wal, interval, wal::Fsync::Interval)->Arg(1)->Arg(1 << 10)->Arg(RowsPerIteration)->UseRealTime();
+BENCHMARK_CAPTURE(BM_Insert_Wal, none, wal::Fsync::None)->Arg(1)->Arg(1 << 10)->Arg(RowsPerIteration)->UseRealTime();
+
+// Concurrent single-row appends under PerBatch: writers that arrive while an
+// fsync is in flight share the next one, so syncs per append drop as threads
+// are added.
+static void BM_Wal_GroupCommit(benchmark::State& state) {
+    static std::unique_ptr<wal::Log> log;
+    const auto path = (std::filesystem::temp_directory_path() / "rstd_bench_group.wal").string();
+
+    if (state.thread_index() == 0) {
+        std::filesystem::remove(path);
+        log = wal::Log::open(path, 0, { .fsync = wal::Fsync::PerBatch }).expect("wal open");
+    }
+
+    const Vec3 row {};
+    for (auto _ : state) {
+        log->append(0, reinterpret_cast<const std::byte*>(&row), sizeof(row), 1, sizeof(row));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        state.counters["syncs_per_append"] = static_cast<f64>(log->fsync_count())
+            / static_cast<f64>(state.iterations() * static_cast<u64>(state.threads()));
+        log.reset();
+        std::filesystem::remove(path);
+    }
+}
+BENCHMARK(BM_Wal_GroupCommit)->ThreadRange(1, 16)->UseRealTime();
+
+// Writer threads each appending 1K-row batches. Sharded gives every thread
+// its own shard; Locked serialises all of them on one table for comparison.
+// Iterations are fixed per thread so 64 writers stay within memory.
+constexpr static size_t IngestBatch      = 1 << 10;
+constexpr static size_t IngestIterations = 512;
+
+static void BM_Ingest_Sharded(benchmark::State& state) {
+    static std::unique_ptr<TSDB> db;
+    static TypeHandle            vec3_handle { 0 };
+
+    if (state.thread_index() == 0) {
+        db          = std::make_unique<TSDB>(1);
+        vec3_handle = register_vec3(*db);
+    }
+
+    auto rows = make_vec3s(IngestBatch);
+    i64  ts   = 0;
+
+    // Only inside the loop is thread 0's setup guaranteed to be visible.
+    std::optional<TSDB::Writer> writer;
+    for (auto _ : state) {
+        if (!writer) writer.emplace(db->writer());
+        for (auto& r : rows) r.timestamp_ns = ts++;
+        writer->insert_batch(std::span<const Vec3>(rows), vec3_handle);
+    }
+
+    state.SetItemsProcessed(state.iterations() * IngestBatch);
+    if (state.thread_index() == 0) db.reset();
+}
+BENCHMARK(BM_Ingest_Sharded)->ThreadRange(1, 64)->Iterations(IngestIterations)->UseRealTime();
+
+static void BM_Ingest_Locked(benchmark::State& state) {
+    static std::unique_ptr<TSDB> db;
+    static TypeHandle            vec3_handle { 0 };
+    static std::mutex            mu;
+
+    if (state.thread_index() == 0) {
+        db          = std::make_unique<TSDB>(1);
+        vec3_handle = register_vec3(*db);
+    }
+
+    auto rows = make_vec3s(IngestBatch);
+    i64  ts   = 0;
+
+    for (auto _ : state) {
+        for (auto& r : rows) r.timestamp_ns = ts++;
+        std::lock_guard lock { mu };
+        db->insert_batch(std::span<const Vec3>(rows), vec3_handle);
+    }
+
+    state.SetItemsProcessed(state.iterations() * IngestBatch);
+    if (state.thread_index() == 0) db.reset();
+}
+BENCHMARK(BM_Ingest_Locked)->ThreadRange(1, 64)->Iterations(IngestIterations)->UseRealTime();
+
+// Producers enqueue rows into the per-type ring; every 64th row is timed
+// until the drain thread has applied it, giving enqueue-to-visible latency.
+static void BM_Ingest_Queue(benchmark::State& state) {
+    using Clock = std::chrono::steady_clock;
+
+    static std::unique_ptr<TSDB> db;
+    static Option<TSDB::Ingest>  queue;
+
+    if (state.thread_index() == 0) {
+        db    = std::make_unique<TSDB>(1);
+        queue = Some(db->start_ingest(register_vec3(*db)));
+    }
+
+    std::vector<f64> latencies_us;
+    Vec3 row {};
+    u64  n = 0;
+
+    for (auto _ : state) {
+        row.timestamp_ns = static_cast<i64>(n);
+
+        const auto start  = Clock::now();
+        auto       ticket = queue.unwrap().enqueue(row);
+        while (ticket.is_none()) {
+            std::this_thread::yield();
+            ticket = queue.unwrap().enqueue(row);
+        }
+
+        if (n++ % 64 == 0) {
+            while (queue.unwrap().applied() <= ticket.unwrap()) std::this_thread::yield();
+            latencies_us.push_back(std::chrono::duration<f64, std::micro>(Clock::now() - start).count());
+        }
+    }
+
+    std::ranges::sort(latencies_us);
+    auto percentile = [&](f64 p) {
+        if (latencies_us.empty()) return 0.0;
+        return latencies_us[static_cast<size_t>(p * static_cast<f64>(latencies_us.size() - 1))];
+    };
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["p50_us"]  = benchmark::Counter(percentile(0.50), benchmark::Counter::kAvgThreads);
+    state.counters["p99_us"]  = benchmark::Counter(percentile(0.99), benchmark::Counter::kAvgThreads);
+    state.counters["p999_us"] = benchmark::Counter(percentile(0.999), benchmark::Counter::kAvgThreads);
+
+    if (state.thread_index() == 0) {
+        queue = None;
+        db.reset();
+    }
+}
+BENCHMARK(BM_Ingest_Queue)->ThreadRange(1, 8)->Iterations(1 << 18)->UseRealTime();
+
+BENCHMARK_MAIN();
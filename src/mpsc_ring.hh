@@ -0,0 +1,107 @@
+#pragma once
+
+#include "option.hh"
+#include "utils.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+
+// Bounded multi-producer single-consumer ring of fixed-size records, after
+// Vyukov's bounded queue. Every slot carries a sequence number: a producer
+// claims a position with one CAS on the tail, copies its record in and
+// publishes it by bumping the slot's sequence; the consumer takes runs of
+// published slots and hands them back the same way. No locks, and producers
+// never wait on each other except to retry a lost CAS.
+class MpscRing {
+public:
+    MpscRing(size_t record_size, size_t capacity)
+        : record_size_(record_size),
+          stride_((Header + record_size + Header - 1) / Header * Header),
+          capacity_(std::bit_ceil(std::max<size_t>(capacity, 2))),
+          mask_(capacity_ - 1),
+          slots_(static_cast<std::byte*>(::operator new[](capacity_ * stride_, std::align_val_t{64})))
+    {
+        for (u64 i = 0; i < capacity_; ++i) {
+            std::memcpy(slot(i), &i, sizeof(i));
+        }
+    }
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    ~MpscRing() { ::operator delete[](slots_, std::align_val_t{64}); }
+
+    // Copies in one record. Returns its position in the total order of
+    // records, or None if the ring is full.
+    auto try_push(const std::byte* record) -> Option<u64> {
+        u64 pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            const u64 seq  = sequence(pos).load(std::memory_order_acquire);
+            const i64 diff = static_cast<i64>(seq - pos);
+
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return None;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+
+        std::memcpy(slot(pos) + Header, record, record_size_);
+        sequence(pos).store(pos + 1, std::memory_order_release);
+        return Some(pos);
+    }
+
+    // Consumer only. Calls f(records, count, stride) for each run of up to
+    // `max` published records that is contiguous in memory, then frees the
+    // slots. Returns the number of records taken.
+    template <typename F>
+    auto drain(size_t max, F&& f) -> size_t {
+        size_t taken = 0;
+        while (taken < max) {
+            const u64    pos = head_;
+            const size_t run = std::min<size_t>(max - taken, capacity_ - (pos & mask_));
+
+            size_t n = 0;
+            while (n < run && sequence(pos + n).load(std::memory_order_acquire) == pos + n + 1) ++n;
+            if (n == 0) break;
+
+            f(static_cast<const std::byte*>(slot(pos) + Header), n, stride_);
+
+            for (size_t i = 0; i < n; ++i) {
+                sequence(pos + i).store(pos + i + capacity_, std::memory_order_release);
+            }
+            head_ += n;
+            taken += n;
+        }
+        return taken;
+    }
+
+    [[nodiscard]] auto record_size() const -> size_t { return record_size_; }
+    [[nodiscard]] auto capacity() const -> size_t { return capacity_; }
+
+private:
+    // Sequence number in front of each record; keeps records 8-byte aligned.
+    constexpr static size_t Header = sizeof(u64);
+
+    [[nodiscard]] auto slot(u64 pos) const -> std::byte* { return slots_ + (pos & mask_) * stride_; }
+
+    [[nodiscard]] auto sequence(u64 pos) const -> std::atomic_ref<u64> {
+        return std::atomic_ref<u64> { *reinterpret_cast<u64*>(slot(pos)) };
+    }
+
+    size_t     record_size_;
+    size_t     stride_;
+    size_t     capacity_;
+    size_t     mask_;
+    std::byte* slots_;
+
+    alignas(64) std::atomic<u64> tail_ { 0 };
+    alignas(64) u64              head_ = 0;
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "utils.hh"
+
+#include <concepts>
+#include <cstddef>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+// Compile-time field lists for row structs. Declare one at namespace scope
+// after the struct, naming every member after the leading timestamp:
+//
+//   struct Vec3 { i64 timestamp_ns; f64 x, y, z; };
+//   TSDB_REFLECT(Vec3, x, y, z)
+//
+// This specialises reflect::Fields<Vec3> with the struct's name and a tuple
+// of member pointers and offsets, timestamp_ns first.
+namespace reflect {
+
+template <typename V, typename T>
+struct Field {
+    using type = V;
+
+    std::string_view name;
+    V T::*           member;
+    size_t           offset;
+};
+
+template <typename T>
+struct Fields;
+
+template <typename T>
+concept Reflected = requires {
+    { Fields<T>::name } -> std::convertible_to<std::string_view>;
+    Fields<T>::fields;
+};
+
+template <Reflected T>
+constexpr size_t field_count = std::tuple_size_v<std::remove_cvref_t<decltype(Fields<T>::fields)>>;
+
+template <Reflected T, size_t I>
+using field_type = typename std::tuple_element_t<I, std::remove_cvref_t<decltype(Fields<T>::fields)>>::type;
+
+// Calls f(field) for every field of T in declaration order.
+template <Reflected T, typename F>
+constexpr auto for_each_field(F&& f) -> void {
+    std::apply([&](const auto&... field) { (f(field), ...); }, Fields<T>::fields);
+}
+
+} // namespace reflect
+
+// Rescans the argument list enough times for TSDB_REFLECT_FOR_EACH to walk
+// up to 256 fields.
+#define TSDB_REFLECT_EXPAND(...)  TSDB_REFLECT_EXPAND3(TSDB_REFLECT_EXPAND3(TSDB_REFLECT_EXPAND3(TSDB_REFLECT_EXPAND3(__VA_ARGS__))))
+#define TSDB_REFLECT_EXPAND3(...) TSDB_REFLECT_EXPAND2(TSDB_REFLECT_EXPAND2(TSDB_REFLECT_EXPAND2(TSDB_REFLECT_EXPAND2(__VA_ARGS__))))
+#define TSDB_REFLECT_EXPAND2(...) TSDB_REFLECT_EXPAND1(TSDB_REFLECT_EXPAND1(TSDB_REFLECT_EXPAND1(TSDB_REFLECT_EXPAND1(__VA_ARGS__))))
+#define TSDB_REFLECT_EXPAND1(...) __VA_ARGS__
+
+#define TSDB_REFLECT_PARENS ()
+#define TSDB_REFLECT_FOR_EACH(macro, T, ...) \
+    __VA_OPT__(TSDB_REFLECT_EXPAND(TSDB_REFLECT_FOR_EACH_STEP(macro, T, __VA_ARGS__)))
+#define TSDB_REFLECT_FOR_EACH_STEP(macro, T, m, ...) \
+    macro(T, m) __VA_OPT__(TSDB_REFLECT_FOR_EACH_AGAIN TSDB_REFLECT_PARENS (macro, T, __VA_ARGS__))
+#define TSDB_REFLECT_FOR_EACH_AGAIN() TSDB_REFLECT_FOR_EACH_STEP
+
+#define TSDB_REFLECT_FIELD(T, m) \
+    , ::reflect::Field<decltype(T::m), T> { #m, &T::m, offsetof(T, m) }
+
+#define TSDB_REFLECT(T, ...)                                                                        \
+    template <>                                                                                     \
+    struct reflect::Fields<T> {                                                                     \
+        static_assert(std::is_trivially_copyable_v<T> && std::is_standard_layout_v<T>);            \
+        static_assert(std::is_same_v<decltype(T::timestamp_ns), i64> && offsetof(T, timestamp_ns) == 0, \
+                      #T " must start with i64 timestamp_ns");                                      \
+                                                                                                    \
+        constexpr static std::string_view name = #T;                                                \
+        constexpr static std::tuple fields {                                                        \
+            ::reflect::Field<i64, T> { "timestamp_ns", &T::timestamp_ns, 0 }                        \
+            TSDB_REFLECT_FOR_EACH(TSDB_REFLECT_FIELD, T, __VA_ARGS__)                               \
+        };                                                                                          \
+    };
@@ -0,0 +1,372 @@
+#pragma once
+
+#include "result.hh"
+#include "utils.hh"
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+enum class SegmentError : u8 {
+    Open,
+    Write,
+    Sync,
+    Map,
+    Truncated,
+    BadMagic,
+    Version,
+    UnknownType,
+    Layout,
+    Order,
+    Unsupported,    // the type has BYTES fields
+};
+
+// Immutable on-disk segment holding whole column chunks of one table.
+//
+//   Header | FieldDesc[field_count] | names | zones... | validity... | column data...
+//
+// Every column's data starts page aligned and is the raw chunk bytes back to
+// back, so a mapped segment is read in place exactly like in-memory chunks.
+// Zone maps are stored per column, ZoneRows entries per chunk, and nullable
+// columns add their validity bitmap, one bit per row.
+namespace segment {
+
+constexpr static char   Magic[8]  = { 'R', 'S', 'T', 'D', 'S', 'E', 'G', '1' };
+constexpr static u32    Version   = 3;
+constexpr static size_t PageAlign = 4096;
+
+struct Zone {
+    u64 min = 0;
+    u64 max = 0;
+};
+
+struct Header {
+    char magic[8];
+    u32  version;
+    u32  field_count;
+    u64  chunk_rows;
+    u64  chunk_count;
+    u64  zone_rows;     // rows per zone map entry; divides chunk_rows
+    u32  type_size;
+    u32  type_name_len;
+    u64  type_name_offset;
+    i64  first_ts;
+    i64  last_ts;
+};
+
+struct FieldDesc {
+    u64 name_offset;
+    u32 name_len;
+    u32 elem_size;
+    u32 struct_offset;
+    u8  kind;
+    u8  nullable;
+    u8  pad[2];
+    u64 zones_offset;   // 0 if the column has no zone map
+    u64 zone_count;     // chunk_count * chunk_rows / zone_rows if it has one
+    u64 valid_offset;   // 0 unless nullable; chunk_count * chunk_rows / 64 words
+    u64 data_offset;
+};
+
+static_assert(std::is_trivially_copyable_v<Header> && std::is_trivially_copyable_v<FieldDesc>);
+
+struct ColumnSource {
+    std::string_view     name;
+    u8                   kind;
+    u32                  elem_size;
+    u32                  struct_offset;
+    std::span<const Zone> zones;
+    std::span<const u64>  valid;   // empty unless nullable
+};
+
+// Returns chunk `chunk` of column `field`; called once per chunk, in order,
+// and the span only needs to stay valid until the next call.
+using ChunkSource = std::function<std::span<const std::byte>(size_t field, size_t chunk)>;
+
+namespace detail {
+
+inline auto align_to(u64 v, u64 a) -> u64 { return (v + a - 1) / a * a; }
+
+// a * b, or None if it does not fit in 64 bits.
+inline auto mul(u64 a, u64 b) -> Option<u64> {
+    u64 r;
+    if (__builtin_mul_overflow(a, b, &r)) return None;
+    return Some(r);
+}
+
+inline auto write_all(int fd, const void* data, size_t size, u64 offset) -> bool {
+    const auto* p = static_cast<const std::byte*>(data);
+    while (size > 0) {
+        const ssize_t n = ::pwrite(fd, p, size, static_cast<off_t>(offset));
+        if (n <= 0) return false;
+        p      += n;
+        size   -= static_cast<size_t>(n);
+        offset += static_cast<u64>(n);
+    }
+    return true;
+}
+
+} // namespace detail
+
+// Writes the segment to `path` via a temporary file and rename, so a crash
+// never leaves a partial segment under the final name. Returns the file size.
+inline auto write(const std::string& path, std::string_view type_name, u32 type_size,
+                  u64 chunk_rows, u64 chunk_count, u64 zone_rows, i64 first_ts, i64 last_ts,
+                  std::span<const ColumnSource> columns, const ChunkSource& chunk_data)
+    -> Result<u64, SegmentError>
+{
+    Header header {};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version     = Version;
+    header.field_count = static_cast<u32>(columns.size());
+    header.chunk_rows  = chunk_rows;
+    header.chunk_count = chunk_count;
+    header.zone_rows   = zone_rows;
+    header.type_size   = type_size;
+    header.first_ts    = first_ts;
+    header.last_ts     = last_ts;
+
+    std::vector<FieldDesc> fields(columns.size());
+
+    // Names follow the field table; zones and data follow the names.
+    u64 off = sizeof(Header) + fields.size() * sizeof(FieldDesc);
+
+    header.type_name_offset = off;
+    header.type_name_len    = static_cast<u32>(type_name.size());
+    off += type_name.size();
+
+    for (size_t i = 0; i < columns.size(); ++i) {
+        fields[i].name_offset   = off;
+        fields[i].name_len      = static_cast<u32>(columns[i].name.size());
+        fields[i].elem_size     = columns[i].elem_size;
+        fields[i].struct_offset = columns[i].struct_offset;
+        fields[i].kind          = columns[i].kind;
+        fields[i].nullable      = !columns[i].valid.empty();
+        off += columns[i].name.size();
+    }
+
+    off = detail::align_to(off, alignof(Zone));
+    for (size_t i = 0; i < columns.size(); ++i) {
+        fields[i].zone_count   = columns[i].zones.size();
+        fields[i].zones_offset = columns[i].zones.empty() ? 0 : off;
+        off += columns[i].zones.size_bytes();
+    }
+
+    for (size_t i = 0; i < columns.size(); ++i) {
+        fields[i].valid_offset = columns[i].valid.empty() ? 0 : off;
+        off += columns[i].valid.size_bytes();
+    }
+
+    for (size_t i = 0; i < columns.size(); ++i) {
+        off = detail::align_to(off, PageAlign);
+        fields[i].data_offset = off;
+        off += chunk_count * chunk_rows * columns[i].elem_size;
+    }
+    const u64 file_size = off;
+
+    // Everything before the first column is small; assemble it in memory.
+    std::vector<std::byte> meta(columns.empty() ? sizeof(Header) : fields[0].data_offset);
+    auto put = [&](u64 at, const void* p, size_t n) { std::memcpy(meta.data() + at, p, n); };
+
+    put(0, &header, sizeof(header));
+    put(sizeof(Header), fields.data(), fields.size() * sizeof(FieldDesc));
+    put(header.type_name_offset, type_name.data(), type_name.size());
+    for (size_t i = 0; i < columns.size(); ++i) {
+        put(fields[i].name_offset, columns[i].name.data(), columns[i].name.size());
+        if (!columns[i].zones.empty()) {
+            put(fields[i].zones_offset, columns[i].zones.data(), columns[i].zones.size_bytes());
+        }
+        if (!columns[i].valid.empty()) {
+            put(fields[i].valid_offset, columns[i].valid.data(), columns[i].valid.size_bytes());
+        }
+    }
+
+    const std::string tmp = path + ".tmp";
+    const int fd = ::open(tmp.c_str(), O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC, 0644);
+    if (fd < 0) return Err(SegmentError::Open);
+
+    auto fail = [&](SegmentError e) -> Result<u64, SegmentError> {
+        ::close(fd);
+        ::unlink(tmp.c_str());
+        return Err(e);
+    };
+
+    if (::ftruncate(fd, static_cast<off_t>(file_size)) != 0) return fail(SegmentError::Write);
+    if (!detail::write_all(fd, meta.data(), meta.size(), 0)) return fail(SegmentError::Write);
+
+    for (size_t i = 0; i < columns.size(); ++i) {
+        const u64 chunk_bytes = chunk_rows * columns[i].elem_size;
+        for (size_t c = 0; c < chunk_count; ++c) {
+            const auto bytes = chunk_data(i, c);
+            if (bytes.size() != chunk_bytes) return fail(SegmentError::Write);
+            if (!detail::write_all(fd, bytes.data(), bytes.size(), fields[i].data_offset + c * chunk_bytes)) {
+                return fail(SegmentError::Write);
+            }
+        }
+    }
+
+    if (::fsync(fd) != 0) return fail(SegmentError::Sync);
+    ::close(fd);
+
+    if (::rename(tmp.c_str(), path.c_str()) != 0) {
+        ::unlink(tmp.c_str());
+        return Err(SegmentError::Write);
+    }
+
+    return Ok(file_size);
+}
+
+// A read-only mapping of a whole segment file. Opening validates the header,
+// the offsets it contains and the sizes of the sections they point at, so
+// that every zones(), valid() and chunk() span lies in the file; it touches
+// nothing else.
+class Segment {
+public:
+    Segment(const Segment&) = delete;
+    Segment& operator=(const Segment&) = delete;
+
+    Segment(Segment&& o) noexcept
+        : base_(std::exchange(o.base_, nullptr)), size_(std::exchange(o.size_, 0)) {}
+
+    Segment& operator=(Segment&& o) noexcept {
+        if (this != &o) {
+            unmap();
+            base_ = std::exchange(o.base_, nullptr);
+            size_ = std::exchange(o.size_, 0);
+        }
+        return *this;
+    }
+
+    ~Segment() { unmap(); }
+
+    [[nodiscard]] static auto open(const std::string& path) -> Result<Segment, SegmentError> {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return Err(SegmentError::Open);
+
+        struct stat st {};
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            return Err(SegmentError::Open);
+        }
+
+        const auto size = static_cast<size_t>(st.st_size);
+        if (size < sizeof(Header)) {
+            ::close(fd);
+            return Err(SegmentError::Truncated);
+        }
+
+        void* p = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return Err(SegmentError::Map);
+
+        Segment seg { static_cast<const std::byte*>(p), size };
+        if (auto err = seg.validate(); err.is_some()) {
+            return Err(std::move(err).unwrap());
+        }
+        return Ok(std::move(seg));
+    }
+
+    [[nodiscard]] auto header() const -> const Header& {
+        return *reinterpret_cast<const Header*>(base_);
+    }
+
+    [[nodiscard]] auto field(size_t i) const -> const FieldDesc& {
+        return reinterpret_cast<const FieldDesc*>(base_ + sizeof(Header))[i];
+    }
+
+    [[nodiscard]] auto type_name() const -> std::string_view {
+        return string_at(header().type_name_offset, header().type_name_len);
+    }
+
+    [[nodiscard]] auto field_name(size_t i) const -> std::string_view {
+        return string_at(field(i).name_offset, field(i).name_len);
+    }
+
+    [[nodiscard]] auto zones(size_t i) const -> std::span<const Zone> {
+        const FieldDesc& f = field(i);
+        if (f.zones_offset == 0) return {};
+        return { reinterpret_cast<const Zone*>(base_ + f.zones_offset), f.zone_count };
+    }
+
+    // Validity bits of every row of a nullable column; empty otherwise.
+    [[nodiscard]] auto valid(size_t i) const -> std::span<const u64> {
+        const FieldDesc& f = field(i);
+        if (f.valid_offset == 0) return {};
+        return { reinterpret_cast<const u64*>(base_ + f.valid_offset), valid_words() };
+    }
+
+    [[nodiscard]] auto chunk(size_t i, size_t c) const -> const std::byte* {
+        const FieldDesc& f = field(i);
+        return base_ + f.data_offset + c * header().chunk_rows * f.elem_size;
+    }
+
+    [[nodiscard]] auto size_bytes() const -> size_t { return size_; }
+
+private:
+    Segment(const std::byte* base, size_t size) : base_(base), size_(size) {}
+
+    auto unmap() -> void {
+        if (base_ != nullptr) ::munmap(const_cast<std::byte*>(base_), size_);
+        base_ = nullptr;
+    }
+
+    [[nodiscard]] auto valid_words() const -> size_t {
+        return header().chunk_count * header().chunk_rows / 64;
+    }
+
+    [[nodiscard]] auto string_at(u64 offset, u32 len) const -> std::string_view {
+        return { reinterpret_cast<const char*>(base_ + offset), len };
+    }
+
+    [[nodiscard]] auto validate() const -> Option<SegmentError> {
+        const Header& h = header();
+        if (std::memcmp(h.magic, Magic, sizeof(Magic)) != 0) return Some(SegmentError::BadMagic);
+        if (h.version != Version) return Some(SegmentError::Version);
+
+        auto in_file = [&](u64 offset, Option<u64> len) {
+            return len.is_some() && offset <= size_ && len.unwrap() <= size_ - offset;
+        };
+
+        if (!in_file(sizeof(Header), detail::mul(h.field_count, sizeof(FieldDesc)))) return Some(SegmentError::Truncated);
+        if (!in_file(h.type_name_offset, Some(u64{h.type_name_len}))) return Some(SegmentError::Truncated);
+
+        // Validity words and zones split whole chunks.
+        if (h.chunk_rows == 0 || h.chunk_rows % 64 != 0) return Some(SegmentError::Layout);
+        if (h.zone_rows == 0 || h.chunk_rows % h.zone_rows != 0) return Some(SegmentError::Layout);
+        const auto rows = detail::mul(h.chunk_count, h.chunk_rows);
+        if (rows.is_none()) return Some(SegmentError::Layout);
+
+        for (size_t i = 0; i < h.field_count; ++i) {
+            const FieldDesc& f = field(i);
+            if (!in_file(f.name_offset, Some(u64{f.name_len}))) return Some(SegmentError::Truncated);
+            if (f.elem_size == 0) return Some(SegmentError::Layout);
+            if (f.zones_offset != 0) {
+                if (f.zone_count != rows.unwrap() / h.zone_rows) return Some(SegmentError::Layout);
+                if (!in_file(f.zones_offset, detail::mul(f.zone_count, sizeof(Zone)))) {
+                    return Some(SegmentError::Truncated);
+                }
+            }
+            if (f.valid_offset != 0 && !in_file(f.valid_offset, detail::mul(valid_words(), sizeof(u64)))) {
+                return Some(SegmentError::Truncated);
+            }
+            if (!in_file(f.data_offset, detail::mul(rows.unwrap(), f.elem_size))) {
+                return Some(SegmentError::Truncated);
+            }
+        }
+        return None;
+    }
+
+    const std::byte* base_ = nullptr;
+    size_t           size_ = 0;
+};
+
+} // namespace segment
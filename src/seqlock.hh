@@ -0,0 +1,64 @@
+#pragma once
+
+#include "utils.hh"
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+// A copy of one row behind a single-writer seqlock. The writer bumps the
+// sequence to odd, stores the words and bumps it back to even; a reader copies
+// the words and retries if the sequence moved meanwhile. Readers never block
+// the writer, and the row is kept in relaxed atomic words so the racing copy
+// is well defined.
+class SeqLockedRow {
+public:
+    explicit SeqLockedRow(size_t bytes)
+        : count_(bytes / sizeof(u64)), words_(std::make_unique<std::atomic<u64>[]>(count_))
+    {
+        assert(bytes % sizeof(u64) == 0);
+    }
+
+    auto store(const std::byte* src) -> void {
+        const u64 seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (size_t i = 0; i < count_; ++i) {
+            u64 w;
+            std::memcpy(&w, src + i * sizeof(u64), sizeof(u64));
+            words_[i].store(w, std::memory_order_relaxed);
+        }
+
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    [[nodiscard]] auto size() const -> size_t { return count_ * sizeof(u64); }
+
+    // Copies the row into `dst`; false if nothing was ever stored.
+    auto load(std::byte* dst) const -> bool {
+        for (;;) {
+            const u64 before = seq_.load(std::memory_order_acquire);
+            if (before & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            for (size_t i = 0; i < count_; ++i) {
+                const u64 w = words_[i].load(std::memory_order_relaxed);
+                std::memcpy(dst + i * sizeof(u64), &w, sizeof(u64));
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == before) return before != 0;
+        }
+    }
+
+private:
+    size_t                              count_;
+    std::unique_ptr<std::atomic<u64>[]> words_;
+    std::atomic<u64>                    seq_ { 0 };
+};
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "option.hh"
+#include "utils.hh"
+
+#include "absl/hash/hash.h"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+// Interns strings into dense u32 ids, handed out 0, 1, 2, ... in first-seen
+// order. find() and name() are lock-free and safe while another thread
+// interns: nothing a reader can reach is ever moved or freed. Strings live in
+// append-only blocks, ids index a list of doubling segments, and the hash
+// index is rebuilt into a new array on growth, keeping the old ones alive.
+// intern() takes a mutex only for strings not seen before.
+class SymbolTable {
+public:
+    SymbolTable() { install_index(InitialSlots); }
+
+    SymbolTable(const SymbolTable&) = delete;
+    auto operator=(const SymbolTable&) -> SymbolTable& = delete;
+
+    ~SymbolTable() {
+        for (auto& seg : segments_) delete[] seg.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] auto find(std::string_view s) const -> Option<u32> {
+        return find(s, hash(s));
+    }
+
+    // Id of `s`, adding it if new. on_new(id) runs under the lock before the
+    // id is visible to other interning threads, so it sees ids in order.
+    template <typename F>
+    auto intern(std::string_view s, F&& on_new) -> u32 {
+        const u64 h = hash(s);
+        if (auto id = find(s, h); id.is_some()) return id.unwrap();
+
+        std::scoped_lock lock { mu_ };
+        if (auto id = find(s, h); id.is_some()) return id.unwrap();
+
+        const u32 id = size_.load(std::memory_order_relaxed);
+        Entry& e = slot_of(id);
+        e.data = store(s);
+        e.size = static_cast<u32>(s.size());
+        on_new(id);
+
+        // Entry first, then the index slot and the count that publish it, so
+        // every id below size() can be found. The index grows at half full.
+        insert_slot(*index_.load(std::memory_order_relaxed), h, id);
+        size_.store(id + 1, std::memory_order_release);
+        if ((id + 1) * 2 > index_mask_ + 1) install_index((index_mask_ + 1) * 2);
+        return id;
+    }
+
+    auto intern(std::string_view s) -> u32 {
+        return intern(s, [](u32) {});
+    }
+
+    // The string of an id returned by intern().
+    [[nodiscard]] auto name(u32 id) const -> std::string_view {
+        assert(id < size());
+        const Entry& e = entry(id);
+        return { e.data, e.size };
+    }
+
+    [[nodiscard]] auto size() const -> u32 { return size_.load(std::memory_order_acquire); }
+
+private:
+    struct Entry {
+        const char* data = nullptr;
+        u32         size = 0;
+    };
+
+    // Slots hold (hash >> 32) << 32 | (id + 1); 0 is empty.
+    struct Index {
+        explicit Index(size_t n) : mask(n - 1), slots(std::make_unique<std::atomic<u64>[]>(n)) {}
+
+        size_t                              mask;
+        std::unique_ptr<std::atomic<u64>[]> slots;
+    };
+
+    constexpr static size_t InitialSlots = 64;
+    constexpr static u32    SegmentBits  = 10;   // segment s holds 1024 << s ids
+    constexpr static size_t BlockBytes   = 64 << 10;
+
+    [[nodiscard]] static auto hash(std::string_view s) -> u64 { return absl::Hash<std::string_view>{}(s); }
+
+    [[nodiscard]] auto find(std::string_view s, u64 h) const -> Option<u32> {
+        const Index& index = *index_.load(std::memory_order_acquire);
+        for (size_t i = h & index.mask;; i = (i + 1) & index.mask) {
+            const u64 v = index.slots[i].load(std::memory_order_acquire);
+            if (v == 0) return None;
+            if ((v >> 32) != (h >> 32)) continue;
+
+            // The slot was stored after the entry, which may not be counted
+            // in size() yet.
+            const Entry& e = entry(static_cast<u32>(v) - 1);
+            if (std::string_view { e.data, e.size } == s) return Some(static_cast<u32>(v) - 1);
+        }
+    }
+
+    // Segment and offset of an id: segment s starts at id (1024 << s) - 1024.
+    [[nodiscard]] static auto locate(u32 id) -> std::pair<u32, u32> {
+        const u64 biased = u64{id} + (u64{1} << SegmentBits);
+        const u32 seg    = static_cast<u32>(std::bit_width(biased)) - 1 - SegmentBits;
+        return { seg, static_cast<u32>(biased - (u64{1} << (seg + SegmentBits))) };
+    }
+
+    [[nodiscard]] auto entry(u32 id) const -> const Entry& {
+        const auto [seg, offset] = locate(id);
+        return segments_[seg].load(std::memory_order_acquire)[offset];
+    }
+
+    auto slot_of(u32 id) -> Entry& {
+        const auto [seg, offset] = locate(id);
+        Entry* s = segments_[seg].load(std::memory_order_relaxed);
+        if (s == nullptr) {
+            s = new Entry[size_t{1} << (seg + SegmentBits)];
+            segments_[seg].store(s, std::memory_order_release);
+        }
+        return s[offset];
+    }
+
+    // Copies `s` into the string blocks; strings never move once stored.
+    auto store(std::string_view s) -> const char* {
+        if (s.size() > BlockBytes - block_used_ || blocks_.empty()) {
+            blocks_.push_back(std::make_unique<char[]>(std::max(BlockBytes, s.size())));
+            block_used_ = 0;
+        }
+        char* p = blocks_.back().get() + block_used_;
+        std::memcpy(p, s.data(), s.size());
+        block_used_ += s.size();
+        return p;
+    }
+
+    static auto insert_slot(Index& index, u64 h, u32 id) -> void {
+        size_t i = h & index.mask;
+        while (index.slots[i].load(std::memory_order_relaxed) != 0) i = (i + 1) & index.mask;
+        index.slots[i].store((h >> 32) << 32 | (u64{id} + 1), std::memory_order_release);
+    }
+
+    // Builds an index of `slots` slots over every id so far and publishes it.
+    // The previous index stays allocated for readers still probing it.
+    auto install_index(size_t slots) -> void {
+        auto index = std::make_unique<Index>(slots);
+        for (u32 id = 0; id < size_.load(std::memory_order_relaxed); ++id) {
+            const Entry& e = entry(id);
+            insert_slot(*index, hash({ e.data, e.size }), id);
+        }
+
+        index_mask_ = index->mask;
+        index_.store(index.get(), std::memory_order_release);
+        indexes_.push_back(std::move(index));
+    }
+
+    std::atomic<Index*>                 index_ { nullptr };
+    std::array<std::atomic<Entry*>, 22> segments_ {};   // 2^32 ids in all
+    std::atomic<u32>                    size_ { 0 };
+
+    // Writer side, under mu_.
+    std::mutex                           mu_;
+    size_t                               index_mask_ = 0;
+    std::vector<std::unique_ptr<Index>>  indexes_;
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    size_t                               block_used_ = 0;
+};
@@ -0,0 +1,204 @@
+#pragma once
+
+#include "bitmap.hh"
+#include "utils.hh"
+
+#include "absl/container/btree_map.h"
+#include "absl/container/flat_hash_map.h"
+
+#include <algorithm>
+#include <functional>
+#include <regex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// One condition on a tag, as in `region="us-east"` or `host=~"web.*"`.
+// Regexes must match the whole value.
+struct TagMatcher {
+    enum class Op : u8 {
+        Eq,         // key=value
+        NotEq,      // key!=value
+        Regex,      // key=~value
+        NotRegex,   // key!~value
+    };
+
+    std::string key;
+    Op          op;
+    std::string value;
+};
+
+// Inverted index from tag key and value to the ids of the series carrying
+// them. Values of a key are kept sorted, so a regex with a literal prefix only
+// visits the values sharing that prefix, and each value is matched once no
+// matter how many series carry it. Each key also maps series ids back to their
+// value, so a regex applied after an equality matcher only tests the values of
+// the series that are still candidates.
+class TagIndex {
+public:
+    using Tags = std::vector<std::pair<std::string, std::string>>;
+
+    auto add(u32 id, const Tags& tags) -> void {
+        all_.add(id);
+        for (const auto& [key, value] : tags) {
+            Postings& p  = postings_[key];
+            auto      it = p.values.find(value);
+            if (it == p.values.end()) {
+                it = p.values.emplace(value, static_cast<u32>(p.ids.size())).first;
+                p.ids.emplace_back();
+                p.names.push_back(value);
+            }
+            p.ids[it->second].add(id);
+
+            if (p.value_of.size() <= id) p.value_of.resize(id + 1, 0);
+            p.value_of[id] = it->second + 1;
+        }
+    }
+
+    // Ids matching every matcher. A negative matcher also keeps the series
+    // without the key, and only negative matchers select from all series.
+    //
+    // Equality matchers go first, as they are one posting lookup each. Regexes
+    // then only look at the values of the remaining candidates rather than
+    // uniting the postings of every matching value across all series.
+    [[nodiscard]] auto select(std::span<const TagMatcher> matchers) const -> RoaringBitmap {
+        std::vector<RoaringBitmap>     include;
+        std::vector<RoaringBitmap>     exclude;
+        std::vector<const TagMatcher*> regexes;
+        for (const TagMatcher& m : matchers) {
+            switch (m.op) {
+                case TagMatcher::Op::Eq:    include.push_back(matching(m)); break;
+                case TagMatcher::Op::NotEq: exclude.push_back(matching(m)); break;
+                default:                    regexes.push_back(&m);          break;
+            }
+        }
+
+        // Without an equality matcher, the first positive regex seeds the
+        // candidates from its postings.
+        if (include.empty()) {
+            auto it = std::ranges::find(regexes, TagMatcher::Op::Regex, &TagMatcher::op);
+            if (it != regexes.end()) {
+                include.push_back(matching(**it));
+                regexes.erase(it);
+            }
+        }
+
+        // Intersect the smallest sets first; results only shrink from there.
+        std::ranges::sort(include, {}, &RoaringBitmap::cardinality);
+
+        const bool narrowed = !include.empty();
+        RoaringBitmap result = narrowed ? std::move(include.front()) : all_;
+        for (size_t i = 1; i < include.size() && !result.empty(); ++i) result &= include[i];
+        for (const RoaringBitmap& e : exclude) {
+            if (result.empty()) break;
+            result -= e;
+        }
+
+        for (const TagMatcher* m : regexes) {
+            if (result.empty()) break;
+            if (narrowed) result = filter(result, *m);
+            else          result -= matching(*m);
+        }
+        return result;
+    }
+
+    [[nodiscard]] auto all() const -> const RoaringBitmap& { return all_; }
+
+private:
+    struct Postings {
+        absl::btree_map<std::string, u32> values;     // value -> ordinal
+        std::vector<RoaringBitmap>        ids;        // by ordinal
+        std::vector<std::string>          names;      // by ordinal
+        std::vector<u32>                  value_of;   // by series id: ordinal + 1, 0 if absent
+    };
+
+    // Whole-value regex match, skipping the regex engine for `prefix.*`.
+    class Pattern {
+    public:
+        explicit Pattern(const std::string& re) {
+            const auto [prefix, rest] = literal_prefix(re);
+            prefix_     = prefix;
+            any_suffix_ = rest == ".*";
+            if (!any_suffix_) re_ = std::regex { re, std::regex::optimize };
+        }
+
+        [[nodiscard]] auto prefix() const -> const std::string& { return prefix_; }
+
+        // Assumes value already starts with prefix().
+        [[nodiscard]] auto matches_rest(const std::string& value) const -> bool {
+            return any_suffix_ || std::regex_match(value, re_);
+        }
+
+        [[nodiscard]] auto matches(const std::string& value) const -> bool {
+            return value.starts_with(prefix_) && matches_rest(value);
+        }
+
+    private:
+        std::string prefix_;
+        bool        any_suffix_ = false;
+        std::regex  re_;
+    };
+
+    // Ids whose value for m.key matches m.value, ignoring negation.
+    [[nodiscard]] auto matching(const TagMatcher& m) const -> RoaringBitmap {
+        auto key = postings_.find(m.key);
+        if (key == postings_.end()) return {};
+        const Postings& p = key->second;
+
+        if (m.op == TagMatcher::Op::Eq || m.op == TagMatcher::Op::NotEq) {
+            auto it = p.values.find(m.value);
+            return it == p.values.end() ? RoaringBitmap {} : p.ids[it->second];
+        }
+
+        const Pattern pattern { m.value };
+        const std::string& prefix = pattern.prefix();
+
+        std::vector<const RoaringBitmap*> hits;
+        for (auto it = p.values.lower_bound(prefix); it != p.values.end() && it->first.starts_with(prefix); ++it) {
+            if (pattern.matches_rest(it->first)) hits.push_back(&p.ids[it->second]);
+        }
+        return RoaringBitmap::unite_all(hits);
+    }
+
+    // The ids of `candidates` that satisfy regex matcher m, negation included.
+    // Each distinct value among the candidates is tested once.
+    [[nodiscard]] auto filter(const RoaringBitmap& candidates, const TagMatcher& m) const -> RoaringBitmap {
+        const bool negated = m.op == TagMatcher::Op::NotRegex;
+
+        auto key = postings_.find(m.key);
+        if (key == postings_.end()) return negated ? candidates : RoaringBitmap {};
+        const Postings& p = key->second;
+
+        enum : u8 { Unknown, Hit, Miss };
+        std::vector<u8> seen(p.names.size(), Unknown);
+        const Pattern pattern { m.value };
+
+        return candidates.filter([&](u32 id) {
+            const u32 v = id < p.value_of.size() ? p.value_of[id] : 0;
+            if (v == 0) return negated;
+
+            u8& s = seen[v - 1];
+            if (s == Unknown) s = pattern.matches(p.names[v - 1]) ? Hit : Miss;
+            return (s == Hit) != negated;
+        });
+    }
+
+    // Splits a regex into the literal text every match must start with and
+    // the remaining pattern. Gives up (empty prefix) on alternation.
+    [[nodiscard]] static auto literal_prefix(std::string_view re) -> std::pair<std::string, std::string_view> {
+        if (re.find('|') != std::string_view::npos) return { {}, re };
+
+        constexpr std::string_view special = ".[]()*+?{}^$\\";
+        size_t n = 0;
+        while (n < re.size() && special.find(re[n]) == std::string_view::npos) ++n;
+
+        // A quantifier makes the last literal character optional.
+        if (n > 0 && n < re.size() && (re[n] == '*' || re[n] == '?' || re[n] == '{')) --n;
+        return { std::string(re.substr(0, n)), re.substr(n) };
+    }
+
+    RoaringBitmap                              all_;
+    absl::flat_hash_map<std::string, Postings> postings_;
+};
@@ -2,13 +2,46 @@
 
 #include "absl/container/flat_hash_map.h"
 
+#include "blob_arena.hh"
+#include "gorilla.hh"
+#include "huge_page_allocator.hh"
+#include "kernels.hh"
+#include "mpsc_ring.hh"
+#include "option.hh"
+#include "reflect.hh"
+#include "result.hh"
+#include "segment.hh"
+#include "seqlock.hh"
+#include "symbol_table.hh"
+#include "tag_index.hh"
 #include "utils.hh"
+#include "wal.hh"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <chrono>
 #include <cstring>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <shared_mutex>
+#include <span>
+#include <stop_token>
+#include <thread>
 #include <utility>
 #include <vector>
 #include <string>
 #include <initializer_list>
+#include <iterator>
+#include <tuple>
+#include <limits>
+
+#include <sys/mman.h>
 
 template <std::unsigned_integral T>
 [[nodiscard]] constexpr auto align_up(T value, T alignment) noexcept -> T {
@@ -38,6 +71,59 @@ private:
     u32 v_;
 };
 
+// A field of a registered struct resolved to its column, so per-query access
+// skips the by-name lookup. T is the field's value type.
+template <typename T>
+struct FieldHandle {
+    constexpr FieldHandle(TypeHandle type, u32 column) : type_(type), column_(column) {}
+
+    [[nodiscard]] constexpr auto type() const -> TypeHandle { return type_; }
+    [[nodiscard]] constexpr auto column() const -> u32 { return column_; }
+
+private:
+    TypeHandle type_;
+    u32        column_;
+};
+
+// One series of a struct type: the rows sharing one set of tag values, kept
+// in a table of their own. Resolved once by TSDB::series, like FieldHandle.
+struct SeriesHandle {
+    constexpr SeriesHandle(TypeHandle type, u32 id) : type_(type), id_(id) {}
+
+    constexpr friend bool operator==(SeriesHandle, SeriesHandle) = default;
+
+    [[nodiscard]] constexpr auto type() const -> TypeHandle { return type_; }
+    [[nodiscard]] constexpr auto id() const -> u32 { return id_; }
+
+private:
+    TypeHandle type_;
+    u32        id_;
+};
+
+// Row member of a nullable field: the value, then whether it is present.
+// Converts to and from Option<T>, so rows are written and read as options;
+// the table keeps the presence flags as a validity bitmap next to the column.
+template <typename T>
+struct Nullable {
+    T    value {};
+    bool valid = false;
+
+    constexpr Nullable() = default;
+    constexpr Nullable(NoneTag) {}
+    constexpr Nullable(T v) : value(v), valid(true) {}
+    constexpr Nullable(const Option<T>& o) : value(o.unwrap_or_default()), valid(o.is_some()) {}
+
+    [[nodiscard]] constexpr auto get() const -> Option<T> { return valid ? Option<T>(value) : Option<T>(None); }
+
+    constexpr operator Option<T>() const { return get(); }
+};
+
+template <typename T>
+constexpr bool is_nullable = false;
+
+template <typename T>
+constexpr bool is_nullable<Nullable<T>> = true;
+
 class Schema {
 public:
     enum class TypeKind : u8 {
@@ -46,6 +132,8 @@ public:
         F32, F64,
         BOOL,
         TIMESTAMP_NS,
+        SYMBOL,         // u32 id into the type's SymbolTable
+        BYTES,          // BlobRef into the type's BlobArena
         STRUCT,
     };
 
@@ -53,6 +141,12 @@ public:
         std::string name;
         TypeHandle  type;
         u32         offset = 0;
+
+        // Offset of a field dropped from its type. It has no place in rows of
+        // the type any more, but keeps its column (and index) for older rows.
+        constexpr static u32 Dropped = ~u32{0};
+
+        [[nodiscard]] auto dropped() const -> bool { return offset == Dropped; }
     };
 
     struct TypeMeta {
@@ -61,40 +155,247 @@ public:
         u32                size      = 0;
         u32                alignment = 1;
         std::vector<Field> fields;
+        bool               nullable  = false;   // a Nullable<T> of the primitive `kind`
+        u32                version   = 0;       // of a struct, bumped by add_field/drop_field
     };
 
     Schema(size_t est_num_types) { init_schema(est_num_types); }
 
     auto register_struct(std::string name,
                          std::initializer_list<std::pair<std::string, const TypeHandle>> fields) -> TypeHandle
+    {
+        return register_struct(std::move(name), std::span(fields.begin(), fields.size()));
+    }
+
+    auto register_struct(std::string name,
+                         std::span<const std::pair<std::string, const TypeHandle>> fields) -> TypeHandle
     {
         TypeMeta type {
             .name = std::move(name),
             .kind = TypeKind::STRUCT,
         };
 
-        type.alignment = 8;
-        type.size      = 8;
         type.fields.push_back({ "timestamp_ns", { static_cast<u32>(TypeKind::TIMESTAMP_NS) }, 0 });
+        for (auto&& [field_name, handle] : fields) type.fields.push_back({ field_name, handle });
+        lay_out(type);
 
-        for (auto&& [field_name, handle] : fields) {
-            const auto& ft = meta_of(handle);
-            type.alignment  = std::max(type.alignment, ft.alignment);
-            type.size       = align_up(type.size, ft.alignment);
-            type.fields.push_back({ field_name, handle, type.size });
-            type.size += ft.size;
-        }
+        const TypeHandle result { static_cast<u32>(types_.size()) };
+        types_.push_back(std::move(type));
+        history_.emplace_back();
+        return result;
+    }
 
-        type.size = align_up(type.size, type.alignment);
+    // Appends a field to the rows of struct `h`, making a new version of it.
+    // The field gets a new column after every existing one, so field indices
+    // and handles of the older versions stay valid. None if `h` already has
+    // a field of that name.
+    auto add_field(TypeHandle h, std::string name, TypeHandle type) -> Option<u32> {
+        assert(meta_of(h).kind == TypeKind::STRUCT && meta_of(type).kind != TypeKind::STRUCT);
+        if (field_index(h, name).is_some()) return None;
+
+        TypeMeta& meta = evolve(h);
+        meta.fields.push_back({ std::move(name), type });
+        lay_out(meta);
+        return Some(static_cast<u32>(meta.fields.size() - 1));
+    }
+
+    // Removes a field from the rows of struct `h` as a new version of it. Its
+    // column keeps the values of older rows under the same index. None if
+    // there is no such field; the timestamp cannot be dropped.
+    auto drop_field(TypeHandle h, std::string_view name) -> Option<u32> {
+        return field_index(h, name)
+            .filter([](u32 i) { return i > 0; })
+            .map([&](u32 i) {
+                TypeMeta& meta = evolve(h);
+                meta.fields[i].offset = Field::Dropped;
+                lay_out(meta);
+                return i;
+            });
+    }
+
+    // Version `v` of struct `h`, as it was registered or last changed; the
+    // current one is meta_of(h).
+    [[nodiscard]] auto version(TypeHandle h, u32 v) const -> const TypeMeta& {
+        assert(v <= meta_of(h).version);
+        return v == meta_of(h).version ? meta_of(h) : history_[h.v_][v];
+    }
+
+    [[nodiscard]] auto meta_of(TypeHandle h) const -> const TypeMeta&  { return types_[h.v_]; }
+
+    // The type of a Nullable<T> field for the primitive T of `value`,
+    // registered on first use: the value followed by a presence byte.
+    auto nullable(TypeHandle value) -> TypeHandle {
+        const TypeMeta& v = meta_of(value);
+        assert(v.kind != TypeKind::STRUCT && !v.nullable);
+
+        std::string name = v.name + "?";
+        if (auto found = find(name); found.is_some()) return found.unwrap();
+
+        TypeMeta type {
+            .name      = std::move(name),
+            .kind      = v.kind,
+            .size      = align_up(v.size + 1, v.alignment),
+            .alignment = v.alignment,
+            .nullable  = true,
+        };
 
         const TypeHandle result { static_cast<u32>(types_.size()) };
         types_.push_back(std::move(type));
+        history_.emplace_back();
         return result;
     }
 
-    [[nodiscard]] auto meta_of(TypeHandle h) const -> const TypeMeta&  { return types_[h.v_]; }
+    // Bytes of a field's value in its column: a nullable field stores only
+    // the value, its presence goes to the validity bitmap.
+    [[nodiscard]] auto value_size(TypeHandle h) const -> u32 {
+        const TypeMeta& t = meta_of(h);
+        return t.nullable ? types_[std::to_underlying(t.kind)].size : t.size;
+    }
+
+    [[nodiscard]] auto contains(TypeHandle h) const -> bool { return h.v_ < types_.size(); }
+
+    [[nodiscard]] auto type_count() const -> size_t { return types_.size(); }
+
+    [[nodiscard]] auto find(std::string_view name) const -> Option<TypeHandle> {
+        for (u32 i = 0; i < types_.size(); ++i) {
+            if (types_[i].name == name) return Some(TypeHandle { i });
+        }
+        return None;
+    }
+
+    // Index of the named field in `h`, which is also the index of its column.
+    // Dropped fields are not found.
+    [[nodiscard]] auto field_index(TypeHandle h, std::string_view name) const -> Option<u32> {
+        const auto& fields = meta_of(h).fields;
+        for (u32 i = 0; i < fields.size(); ++i) {
+            if (fields[i].name == name && !fields[i].dropped()) return Some(i);
+        }
+        return None;
+    }
+
+    template <typename T>
+    [[nodiscard]] constexpr static auto holds(TypeKind kind) -> bool {
+        if constexpr (std::same_as<T, u8>)   return kind == TypeKind::U8;
+        if constexpr (std::same_as<T, u16>)  return kind == TypeKind::U16;
+        if constexpr (std::same_as<T, u32>)  return kind == TypeKind::U32 || kind == TypeKind::SYMBOL;
+        if constexpr (std::same_as<T, u64>)  return kind == TypeKind::U64;
+        if constexpr (std::same_as<T, i8>)   return kind == TypeKind::I8;
+        if constexpr (std::same_as<T, i16>)  return kind == TypeKind::I16;
+        if constexpr (std::same_as<T, i32>)  return kind == TypeKind::I32;
+        if constexpr (std::same_as<T, i64>)  return kind == TypeKind::I64 || kind == TypeKind::TIMESTAMP_NS;
+        if constexpr (std::same_as<T, f32>)  return kind == TypeKind::F32;
+        if constexpr (std::same_as<T, f64>)  return kind == TypeKind::F64;
+        if constexpr (std::same_as<T, bool>) return kind == TypeKind::BOOL;
+        if constexpr (std::same_as<T, BlobRef>) return kind == TypeKind::BYTES;
+        return false;
+    }
+
+    // handle_of() that also takes Nullable<T>, registering its type.
+    template <typename T>
+    auto handle_for() -> TypeHandle {
+        if constexpr (is_nullable<T>) return nullable(handle_of<decltype(T::value)>());
+        else                          return handle_of<T>();
+    }
+
+    // The primitive type handle storing a C++ T.
+    template <typename T>
+    [[nodiscard]] constexpr static auto handle_of() -> TypeHandle {
+        if      constexpr (std::same_as<T, u8>)   return { std::to_underlying(TypeKind::U8) };
+        else if constexpr (std::same_as<T, u16>)  return { std::to_underlying(TypeKind::U16) };
+        else if constexpr (std::same_as<T, u32>)  return { std::to_underlying(TypeKind::U32) };
+        else if constexpr (std::same_as<T, u64>)  return { std::to_underlying(TypeKind::U64) };
+        else if constexpr (std::same_as<T, i8>)   return { std::to_underlying(TypeKind::I8) };
+        else if constexpr (std::same_as<T, i16>)  return { std::to_underlying(TypeKind::I16) };
+        else if constexpr (std::same_as<T, i32>)  return { std::to_underlying(TypeKind::I32) };
+        else if constexpr (std::same_as<T, i64>)  return { std::to_underlying(TypeKind::I64) };
+        else if constexpr (std::same_as<T, f32>)  return { std::to_underlying(TypeKind::F32) };
+        else if constexpr (std::same_as<T, f64>)  return { std::to_underlying(TypeKind::F64) };
+        else if constexpr (std::same_as<T, bool>) return { std::to_underlying(TypeKind::BOOL) };
+        else if constexpr (std::same_as<T, BlobRef>) return { std::to_underlying(TypeKind::BYTES) };
+        else static_assert(sizeof(T) == 0, "not a primitive column type");
+    }
+
+    // Whether register_struct lays out the fields of T at the offsets and
+    // total size the compiler gave it.
+    template <reflect::Reflected T>
+    [[nodiscard]] consteval static auto matches_layout() -> bool {
+        u32  size      = 0;
+        u32  alignment = 1;
+        bool same      = true;
+        reflect::for_each_field<T>([&]<typename V>(const reflect::Field<V, T>& f) {
+            size      = align_up(size, u32{alignof(V)});
+            same      = same && size == f.offset;
+            size     += sizeof(V);
+            alignment = std::max(alignment, u32{alignof(V)});
+        });
+        return same && align_up(size, alignment) == sizeof(T);
+    }
+
+    // Whether rows of struct `h` are laid out as T in its current version:
+    // T's fields in order, of the same kinds and at the same offsets, with no
+    // field dropped in between.
+    template <reflect::Reflected T>
+    [[nodiscard]] auto matches(TypeHandle h) const -> bool {
+        const TypeMeta& meta = meta_of(h);
+        if (meta.size != sizeof(T) || meta.fields.size() != reflect::field_count<T>) return false;
+
+        bool   same = true;
+        size_t i    = 0;
+        reflect::for_each_field<T>([&]<typename V>(const reflect::Field<V, T>& f) {
+            const Field&    field = meta.fields[i++];
+            const TypeMeta& ft    = meta_of(field.type);
+            if constexpr (is_nullable<V>) same = same && ft.nullable && holds<decltype(V::value)>(ft.kind);
+            else                          same = same && !ft.nullable && holds<V>(ft.kind);
+            same = same && field.offset == f.offset;
+        });
+        return same;
+    }
+
+    // Calls f.template operator()<T>() with the C++ type stored by a numeric
+    // kind. Returns None for kinds that are not a single number.
+    template <typename F>
+    static auto visit_numeric(TypeKind kind, F&& f) -> Option<decltype(f.template operator()<f64>())> {
+        switch (kind) {
+            case TypeKind::U8:           return Some(f.template operator()<u8>());
+            case TypeKind::U16:          return Some(f.template operator()<u16>());
+            case TypeKind::U32:          return Some(f.template operator()<u32>());
+            case TypeKind::U64:          return Some(f.template operator()<u64>());
+            case TypeKind::I8:           return Some(f.template operator()<i8>());
+            case TypeKind::I16:          return Some(f.template operator()<i16>());
+            case TypeKind::I32:          return Some(f.template operator()<i32>());
+            case TypeKind::I64:          return Some(f.template operator()<i64>());
+            case TypeKind::F32:          return Some(f.template operator()<f32>());
+            case TypeKind::F64:          return Some(f.template operator()<f64>());
+            case TypeKind::TIMESTAMP_NS: return Some(f.template operator()<i64>());
+            default:                     return None;
+        }
+    }
 
 private:
+    // Places the live fields of a struct in order, each at its alignment.
+    auto lay_out(TypeMeta& type) const -> void {
+        type.alignment = 8;
+        type.size      = 0;
+        for (Field& f : type.fields) {
+            if (f.dropped()) continue;
+
+            const auto& ft = meta_of(f.type);
+            type.alignment = std::max(type.alignment, ft.alignment);
+            type.size      = align_up(type.size, ft.alignment);
+            f.offset       = type.size;
+            type.size     += ft.size;
+        }
+        type.size = align_up(type.size, type.alignment);
+    }
+
+    // Keeps the current version of `h` in its history and returns the next.
+    auto evolve(TypeHandle h) -> TypeMeta& {
+        TypeMeta& meta = types_[h.v_];
+        history_[h.v_].push_back(meta);
+        ++meta.version;
+        return meta;
+    }
+
     void init_schema(size_t est_num_types) {
         constexpr std::pair<std::string_view, TypeKind> prims[] = {
             {"u8",  TypeKind::U8},  {"u16", TypeKind::U16}, {"u32", TypeKind::U32}, {"u64", TypeKind::U64},
@@ -102,6 +403,8 @@ private:
             {"f32", TypeKind::F32}, {"f64", TypeKind::F64},
             {"bool", TypeKind::BOOL},
             {"timestamp_ns", TypeKind::TIMESTAMP_NS},
+            {"symbol", TypeKind::SYMBOL},
+            {"bytes", TypeKind::BYTES},
         };
 
         constexpr u32 sizes[] = {
@@ -110,6 +413,8 @@ private:
             4, 8,
             1,
             8,
+            4,
+            sizeof(BlobRef),
         };
 
         for (u32 i = 0; i < std::size(prims); ++i) {
@@ -117,164 +422,3212 @@ private:
                 .name      = std::string(prims[i].first),
                 .kind      = prims[i].second,
                 .size      = sizes[i],
-                .alignment = sizes[i],
+                .alignment = std::min(sizes[i], u32{alignof(u64)}),
             });
         }
 
         types_.reserve(types_.size() + est_num_types);
+        history_.resize(types_.size());
     }
 
     std::vector<TypeMeta> types_;
+
+    // Earlier versions of each type, oldest first; empty for most.
+    std::vector<std::vector<TypeMeta>> history_;
 };
 
-struct Column {
+// Rows per column chunk. Must be a power of two so row -> (chunk, slot) is a
+// shift and a mask.
+constexpr static size_t ChunkRows      = 64 << 10;
+constexpr static size_t ChunkAlign     = 64;
+constexpr static size_t FirstChunkRows = 1 << 10;
+
+// Where a table's column chunks live. HugePages carves them out of a per-table
+// chain of 2MB huge-page regions to cut TLB misses on large scans.
+enum class TableMemory : u8 {
+    Heap,
+    HugePages,
+};
+
+struct TableOptions {
+    TableMemory memory = TableMemory::Heap;
+
+    // Encode each chunk with the gorilla codecs once it is full. Reads of a
+    // sealed chunk decode it into the reader's Column::Cursor first.
+    bool compress_sealed = false;
+};
+
+using ChunkArena = HugePageArena<>;
+
+struct ChunkDeleter {
+    bool from_heap = true;
+
+    auto operator()(std::byte* p) const noexcept -> void {
+        if (from_heap) ::operator delete[](p, std::align_val_t{ChunkAlign});
+    }
+};
+
+using ChunkPtr = std::unique_ptr<std::byte[], ChunkDeleter>;
+
+// Rows per zone map block. Divides ChunkRows, so a block never straddles two
+// chunks.
+constexpr static size_t ZoneRows = 4096;
+
+static_assert(ChunkRows % ZoneRows == 0);
+
+constexpr static size_t ZonesPerChunk = ChunkRows / ZoneRows;
+
+// Min/max of every ZoneRows block of one numeric column, maintained as rows
+// are appended. Bounds are stored as the bit pattern of the column's own type
+// in 8-byte slots, so i64 timestamps keep full precision.
+class ZoneMap {
 public:
-    Column() = default;
-    explicit Column(size_t elem_size) : elem_size_(elem_size) {}
+    // Same layout on disk and in memory, so segments store zones verbatim.
+    using Zone = segment::Zone;
 
-    auto push(const std::byte* data) -> void {
-        const size_t old_size = data_.size();
-        data_.resize(old_size + elem_size_);
-        std::memcpy(data_.data() + old_size, data, elem_size_);
+    ZoneMap() = default;
+    explicit ZoneMap(Schema::TypeKind kind) {
+        // Symbol ids have no order, but their bounds still rule out blocks
+        // for an equality filter.
+        if (kind == Schema::TypeKind::SYMBOL) extend_ = &extend<u32>;
+        (void)Schema::visit_numeric(kind, [&]<typename T>() {
+            extend_ = &extend<T>;
+            return 0;
+        });
+    }
+
+    [[nodiscard]] auto enabled() const -> bool { return extend_ != nullptr; }
+
+    // Folds rows [first_row, first_row + count) into their blocks; `values`
+    // must be contiguous, i.e. the rows lie in a single chunk.
+    auto append(size_t first_row, const std::byte* values, size_t elem_size, size_t count) -> void {
+        if (extend_ == nullptr) return;
+
+        while (count > 0) {
+            const size_t offset = first_row % ZoneRows;
+            const size_t n      = std::min(count, ZoneRows - offset);
+
+            if (offset == 0) zones_.emplace_back();
+            extend_(zones_.back(), values, n, offset == 0);
+
+            first_row += n;
+            values    += n * elem_size;
+            count     -= n;
+        }
     }
 
-    [[nodiscard]] auto at(size_t row) const -> const std::byte* {
-        return data_.data() + row * elem_size_;
+    // append() of `count` zero values, without reading any.
+    auto append_zeros(size_t first_row, size_t count) -> void {
+        if (extend_ == nullptr) return;
+
+        alignas(u64) constexpr static std::byte zero[sizeof(u64)] {};
+        while (count > 0) {
+            const size_t offset = first_row % ZoneRows;
+            const size_t n      = std::min(count, ZoneRows - offset);
+
+            if (offset == 0) zones_.emplace_back();
+            extend_(zones_.back(), zero, 1, offset == 0);
+
+            first_row += n;
+            count     -= n;
+        }
     }
 
-    [[nodiscard]] auto row_count() const -> size_t {
-        return elem_size_ > 0 ? data_.size() / elem_size_ : 0;
+    // append() of one value whose type is known statically.
+    template <typename T>
+    auto append_value(size_t row, T v) -> void {
+        T lo = v;
+        T hi = v;
+        if (row % ZoneRows == 0) {
+            zones_.emplace_back();
+        } else {
+            const auto [old_lo, old_hi] = bounds<T>(size() - 1);
+            lo = std::min(lo, old_lo);
+            hi = std::max(hi, old_hi);
+        }
+        std::memcpy(&zones_.back().min, &lo, sizeof(T));
+        std::memcpy(&zones_.back().max, &hi, sizeof(T));
     }
 
-    [[nodiscard]] auto elem_size() const -> size_t { return elem_size_; }
+    // Appends precomputed zones, e.g. those of a mapped segment chunk.
+    auto append_zones(std::span<const Zone> zones) -> void {
+        if (extend_ == nullptr) return;
+        zones_.insert(zones_.end(), zones.begin(), zones.end());
+    }
 
-    auto reserve(size_t row_count) -> void {
-        data_.reserve(row_count * elem_size_);
+    [[nodiscard]] auto size() const -> size_t { return zones_.size() - head_; }
+
+    [[nodiscard]] auto raw() const -> std::span<const Zone> { return std::span(zones_).subspan(head_); }
+
+    // Forgets the first `n` zones; the storage is compacted once the dead
+    // prefix is half of it, so this is amortised O(n).
+    auto drop_front(size_t n) -> void {
+        if (extend_ == nullptr) return;
+        head_ += n;
+        if (head_ * 2 >= zones_.size()) {
+            zones_.erase(zones_.begin(), zones_.begin() + static_cast<std::ptrdiff_t>(head_));
+            head_ = 0;
+        }
+    }
+
+    template <typename T>
+    [[nodiscard]] auto bounds(size_t zone) const -> std::pair<T, T> {
+        static_assert(sizeof(T) <= sizeof(u64));
+        T lo, hi;
+        std::memcpy(&lo, &zones_[head_ + zone].min, sizeof(T));
+        std::memcpy(&hi, &zones_[head_ + zone].max, sizeof(T));
+        return { lo, hi };
     }
 
 private:
-    size_t elem_size_ = 0;
-    std::vector<std::byte> data_;
+    template <typename T>
+    static auto extend(Zone& z, const std::byte* values, size_t count, bool fresh) -> void {
+        const std::span<const T> v { reinterpret_cast<const T*>(values), count };
+
+        // Single rows and small batches are the common case; keep them off
+        // the kernel dispatch path.
+        T lo, hi;
+        if (count == 1) {
+            lo = hi = v[0];
+        } else if (count < 64) {
+            lo = kernels::scalar::min(v.data(), count);
+            hi = kernels::scalar::max(v.data(), count);
+        } else {
+            lo = kernels::min(v);
+            hi = kernels::max(v);
+        }
+
+        if (!fresh) {
+            T old_lo, old_hi;
+            std::memcpy(&old_lo, &z.min, sizeof(T));
+            std::memcpy(&old_hi, &z.max, sizeof(T));
+            lo = std::min(lo, old_lo);
+            hi = std::max(hi, old_hi);
+        }
+
+        std::memcpy(&z.min, &lo, sizeof(T));
+        std::memcpy(&z.max, &hi, sizeof(T));
+    }
+
+    using ExtendFn = void (*)(Zone&, const std::byte*, size_t, bool);
+
+    ExtendFn          extend_ = nullptr;
+    std::vector<Zone> zones_;
+    size_t            head_ = 0;
 };
 
-struct Table {
+// Presence bits of a nullable column, one per row, packed 64 to a word and
+// kept per chunk: the rows of chunk c are the bits of words(c). Chunk
+// boundaries are multiples of 64 rows, so a chunk's block never shares a
+// word with another. Blocks of full chunks may point at words they do not
+// own: those of a mapped segment, or a shared block of zeros for rows that
+// are all null.
+class Validity {
 public:
-    Table(std::vector<size_t> field_sizes, std::vector<size_t> field_offsets)
-        : field_offsets_(std::move(field_offsets))
-    {
-        columns_.reserve(field_sizes.size());
-        for (size_t sz : field_sizes) {
-            columns_.emplace_back(sz);
+    constexpr static size_t ChunkWords = ChunkRows / 64;
+
+    auto append(size_t row, bool valid) -> void {
+        const size_t at = row % ChunkRows;
+        if (at == 0) blocks_.emplace_back();
+
+        Block& b = blocks_.back();
+        if (b.shared != nullptr) {
+            // A partly filled block of nulls; give it words of its own.
+            b.own.assign((at + 63) / 64, 0);
+            b.shared = nullptr;
         }
+        if (at % 64 == 0) b.own.push_back(0);
+        b.own.back() |= u64{valid} << (at % 64);
     }
 
-    auto insert_row(const std::byte* src) -> void {
-        for (size_t i = 0; i < columns_.size(); ++i) {
-            columns_[i].push(src + field_offsets_[i]);
+    // Appends `count` null rows from `row` on. Whole chunks of them share
+    // one block of zeros, so this is O(1) per chunk.
+    auto append_nulls(size_t row, size_t count) -> void {
+        while (count > 0) {
+            const size_t at = row % ChunkRows;
+            const size_t n  = std::min(count, ChunkRows - at);
+            if (at == 0)                            blocks_.push_back({ .shared = Zeros.data() });
+            else if (blocks_.back().shared == nullptr) blocks_.back().own.resize((at + n + 63) / 64);
+
+            row   += n;
+            count -= n;
         }
-        ++row_count_;
     }
 
-    auto read_row(size_t row, std::byte* dst) const -> void {
-        for (size_t i = 0; i < columns_.size(); ++i) {
-            std::memcpy(dst + field_offsets_[i], columns_[i].at(row), columns_[i].elem_size());
-        }
+    // Appends the ChunkWords words of a full chunk, e.g. a mapped segment's;
+    // they must outlive the block.
+    auto append_chunk(const u64* words) -> void {
+        blocks_.push_back({ .shared = words });
     }
 
-    auto reserve(size_t row_count) -> void {
-        for (auto& col : columns_) {
-            col.reserve(row_count);
-        }
+    [[nodiscard]] auto test(size_t row) const -> bool {
+        return (words(row / ChunkRows)[row % ChunkRows / 64] >> (row % 64)) & 1;
     }
 
-    [[nodiscard]] auto row_count() const -> size_t { return row_count_; }
+    // The word holding the first row of chunk `c`.
+    [[nodiscard]] auto words(size_t c) const -> const u64* {
+        const Block& b = blocks_[head_ + c];
+        return b.shared != nullptr ? b.shared : b.own.data();
+    }
+
+    // Forgets the block of the oldest chunk, compacting like
+    // ZoneMap::drop_front.
+    auto drop_front() -> void {
+        ++head_;
+        if (head_ * 2 >= blocks_.size()) {
+            blocks_.erase(blocks_.begin(), blocks_.begin() + static_cast<std::ptrdiff_t>(head_));
+            head_ = 0;
+        }
+    }
 
 private:
-    size_t row_count_ = 0;
-    std::vector<size_t> field_offsets_;
-    std::vector<Column> columns_;
+    struct Block {
+        std::vector<u64> own;
+        const u64*       shared = nullptr;
+    };
+
+    constexpr static std::array<u64, ChunkWords> Zeros {};
+
+    std::vector<Block> blocks_;
+    size_t             head_ = 0;
 };
 
-class TSDB {
+static_assert(FirstChunkRows % 64 == 0 && ChunkRows % 64 == 0);
+
+// A column is a list of fixed-size chunks. Appends fill the tail chunk and
+// allocate a new one when it is full, so existing rows never move and pointers
+// into full (sealed) chunks stay valid for the lifetime of the column. The
+// first chunk starts at FirstChunkRows and doubles up to ChunkRows before the
+// second is added, so small columns (e.g. of one series) stay small.
+//
+// With compression on, a full chunk is instead encoded and its raw memory
+// released. Reading a compressed chunk decodes it into the reader's Cursor,
+// so spans into it only last until that cursor decodes another chunk;
+// readers with cursors of their own may read the column concurrently.
+//
+// Full chunks can also point into a mapped segment file; those are read in
+// place and never sealed or freed by the column. Chunks of default rows (see
+// fill()) point at a shared read-only zero mapping in the same way.
+//
+// A nullable column reads a presence byte right after each value (the
+// layout of Nullable<T>) and keeps it in a Validity bitmap. Null slots hold
+// zero, which zone bounds include, so they stay correct if a little loose.
+struct Column {
 public:
-    TSDB(size_t est_num_types = 1) : schema_(est_num_types) {}
+    // Decode buffer of one reader. Reads of sealed chunks decode into it, so
+    // readers with cursors of their own never share state; what is read
+    // through a cursor stays valid until it decodes another chunk or the
+    // column is written. Copies start out empty.
+    class Cursor {
+    public:
+        Cursor() = default;
+        Cursor(const Cursor&) : Cursor() {}
+        Cursor(Cursor&&) noexcept = default;
+        auto operator=(const Cursor&) -> Cursor& { key_ = 0; return *this; }
+        auto operator=(Cursor&&) noexcept -> Cursor& = default;
+        ~Cursor() = default;
 
-    ~TSDB()           = default;
-    TSDB(const TSDB&) = delete;
-    TSDB(TSDB&&)      = delete;
+    private:
+        friend struct Column;
 
-    auto register_struct(std::string name,
-                         std::initializer_list<std::pair<std::string, const TypeHandle>> fields) -> TypeHandle
-    {
-        return schema_.register_struct(name, fields);
+        ChunkPtr   buf_;
+        size_t     cap_ = 0;
+        u64        key_ = 0;   // Chunk::seal_id of the chunk in buf_, 0 if none
+    };
+
+    Column() = default;
+    explicit Column(size_t elem_size, Schema::TypeKind kind, bool nullable = false,
+                    ChunkArena* arena = nullptr, bool compress = false)
+        : elem_size_(elem_size), kind_(kind), nullable_(nullable), compress_(compress), arena_(arena), zones_(kind) {}
+
+    auto push(const std::byte* data) -> void {
+        if (tail_space() == 0) add_chunk();
+
+        std::byte* dst = slot(rows_);
+        std::memcpy(dst, data, elem_size_);
+        if (nullable_) mask_nulls(dst, data, 1, 0);
+        zones_.append(rows_, dst, elem_size_, 1);
+        ++rows_;
     }
 
-    template<typename T>
-    auto insert(const T& src, TypeHandle type) -> void {
-        static_assert(std::is_trivially_copyable_v<T>);
+    // push() of a statically typed value: a constant-size copy and an inline
+    // zone update.
+    template <typename V>
+    auto push_value(V v) -> void {
+        if constexpr (is_nullable<V>) {
+            assert(nullable_);
+            valid_.append(rows_, v.valid);
+            return push_plain(v.valid ? v.value : decltype(v.value){});
+        } else {
+            push_plain(v);
+        }
+    }
 
-        Table& table = get_or_create_table(type);
-        const auto* bytes = reinterpret_cast<const std::byte*>(&src);
+    template <typename V>
+    auto push_plain(V v) -> void {
+        assert(sizeof(V) == elem_size_);
+        if (tail_space() == 0) add_chunk();
 
-        table.insert_row(bytes);
+        std::memcpy(slot(rows_), &v, sizeof(V));
+        if constexpr (std::is_arithmetic_v<V>) {
+            if (zones_.enabled()) zones_.append_value(rows_, v);
+        }
+        ++rows_;
     }
 
-    template<typename T>
-    [[nodiscard]] auto query_first(TypeHandle type) const -> T {
-        static_assert(std::is_trivially_copyable_v<T>);
+    // Appends `count` elements read from `src` at `stride` byte intervals, i.e.
+    // gathers one field out of a block of AoS rows.
+    auto push_strided(const std::byte* src, size_t count, size_t stride) -> void {
+        while (count > 0) {
+            if (tail_space() == 0) add_chunk();
 
-        const Table* table = get_table_ptr(type);
-        if (table == nullptr || table->row_count() == 0) {
-            return T{};
+            const size_t n = std::min(count, tail_space());
+            std::byte* dst = slot(rows_);
+            gather(dst, src, n, stride, elem_size_);
+            if (nullable_) mask_nulls(dst, src, n, stride);
+            zones_.append(rows_, dst, elem_size_, n);
+
+            rows_ += n;
+            src   += n * stride;
+            count -= n;
         }
+    }
 
-        T result {};
-        auto* dst = reinterpret_cast<std::byte*>(&result);
-        table->read_row(0, dst);
+    // Appends `count` rows holding the default value: zero, and null if the
+    // column is nullable. Whole chunks of them map the shared zero chunk, so
+    // filling a column added to a large table allocates and copies nothing;
+    // the zero tail gets memory of its own only when a value is pushed.
+    auto fill(size_t count) -> void {
+        zones_.append_zeros(rows_, count);
+        if (nullable_) valid_.append_nulls(rows_, count);
 
-        return result;
+        while (count > 0) {
+            size_t n;
+            if (zero_tail_ && rows_ % ChunkRows != 0) {
+                n = std::min(count, ChunkRows - rows_ % ChunkRows);
+            } else if (tail_space() == 0 && rows_ % ChunkRows == 0 && elem_size_ <= ZeroElemMax) {
+                seal_tail();
+                chunks_.push_back(mapped_chunk(zero_chunk()));
+                tail_cap_  = ChunkRows;
+                zero_tail_ = true;
+                n = std::min(count, ChunkRows);
+            } else {
+                if (tail_space() == 0) add_chunk();
+                n = std::min(count, tail_space());
+                std::memset(slot(rows_), 0, n * elem_size_);
+            }
+            rows_ += n;
+            count -= n;
+        }
     }
 
-    // Default Types
-    constexpr static TypeHandle U8   { std::to_underlying(Schema::TypeKind::U8  ) };
-    constexpr static TypeHandle U16  { std::to_underlying(Schema::TypeKind::U16 ) };
-    constexpr static TypeHandle U32  { std::to_underlying(Schema::TypeKind::U32 ) };
-    constexpr static TypeHandle U64  { std::to_underlying(Schema::TypeKind::U64 ) };
-    constexpr static TypeHandle I8   { std::to_underlying(Schema::TypeKind::I8  ) };
-    constexpr static TypeHandle I16  { std::to_underlying(Schema::TypeKind::I16 ) };
-    constexpr static TypeHandle I32  { std::to_underlying(Schema::TypeKind::I32 ) };
-    constexpr static TypeHandle I64  { std::to_underlying(Schema::TypeKind::I64 ) };
-    constexpr static TypeHandle F32  { std::to_underlying(Schema::TypeKind::F32 ) };
-    constexpr static TypeHandle F64  { std::to_underlying(Schema::TypeKind::F64 ) };
-    constexpr static TypeHandle BOOL { std::to_underlying(Schema::TypeKind::BOOL) };
+    // Appends a full chunk that lives in a mapped segment, with its zones and,
+    // if nullable, its validity words.
+    auto attach(const std::byte* data, std::span<const ZoneMap::Zone> zones, std::span<const u64> valid) -> void {
+        assert(tail_space() == 0);
+        assert(valid.size() == (nullable_ ? ChunkRows / 64 : 0));
+        chunks_.push_back(mapped_chunk(data));
+        zones_.append_zones(zones);
+        if (nullable_) valid_.append_chunk(valid.data());
+        rows_     += ChunkRows;
+        tail_cap_  = ChunkRows;
+        zero_tail_ = false;
+    }
 
-    constexpr static TypeHandle TIME_NS { std::to_underlying(Schema::TypeKind::TIMESTAMP_NS) };
+    // Serves full chunk `i` from `data`, a mapped copy of its rows, and
+    // releases the chunk's own memory.
+    auto map_chunk(size_t i, const std::byte* data) -> void {
+        assert((i + 1) * ChunkRows <= rows_);
+        release(entry(i));
+        entry(i) = mapped_chunk(data);
+    }
+
+    // Drops the oldest chunk, which must be full, in O(1): its memory goes
+    // back to the OS (heap), to the arena's free list, or with its segment.
+    // Rows are renumbered from the next chunk on.
+    auto drop_front() -> void {
+        assert(rows_ >= ChunkRows);
+
+        release(entry(0));
+        ++head_;
+        rows_ -= ChunkRows;
+        zones_.drop_front(ZonesPerChunk);
+        if (nullable_) valid_.drop_front();
+
+        // Compact once the dead prefix is half the directory; amortised O(1).
+        if (head_ * 2 >= chunks_.size()) {
+            chunks_.erase(chunks_.begin(), chunks_.begin() + static_cast<std::ptrdiff_t>(head_));
+            head_ = 0;
+        }
+    }
+
+    [[nodiscard]] auto is_mapped(size_t i) const -> bool { return entry(i).mapped; }
+
+    [[nodiscard]] auto at(size_t row, Cursor& cur) const -> const std::byte* {
+        const Chunk& c = entry(row / ChunkRows);
+        const std::byte* base = c.raw ? c.raw.get() : decoded(row / ChunkRows, cur);
+        return base + (row % ChunkRows) * elem_size_;
+    }
+
+    template <typename V>
+    [[nodiscard]] auto value(size_t row, Cursor& cur) const -> V {
+        if constexpr (is_nullable<V>) {
+            return is_valid(row) ? V { value<decltype(V::value)>(row, cur) } : V {};
+        } else {
+            assert(sizeof(V) == elem_size_);
+            V v;
+            std::memcpy(&v, at(row, cur), sizeof(V));
+            return v;
+        }
+    }
+
+    // The value of a row, None if the column is nullable and the row null.
+    template <typename V>
+    [[nodiscard]] auto get(size_t row, Cursor& cur) const -> Option<V> {
+        if (!is_valid(row)) return None;
+        return Some(value<V>(row, cur));
+    }
+
+    [[nodiscard]] auto nullable() const -> bool { return nullable_; }
+
+    [[nodiscard]] auto is_valid(size_t row) const -> bool { return !nullable_ || valid_.test(row); }
+
+    // Validity bitmap of a nullable column; bit `row` is set if it has a value.
+    [[nodiscard]] auto validity() const -> const Validity& { return valid_; }
+
+    [[nodiscard]] auto row_count() const -> size_t { return rows_; }
+
+    [[nodiscard]] auto elem_size() const -> size_t { return elem_size_; }
+
+    [[nodiscard]] auto chunk_count() const -> size_t { return chunks_.size() - head_; }
+
+    // The filled part of chunk `i`; every chunk but the last is always full.
+    [[nodiscard]] auto chunk(size_t i, Cursor& cur) const -> std::span<const std::byte> {
+        const size_t rows = std::min(ChunkRows, rows_ - i * ChunkRows);
+        const Chunk& c = entry(i);
+        return { c.raw ? c.raw.get() : decoded(i, cur), rows * elem_size_ };
+    }
+
+    [[nodiscard]] auto is_sealed(size_t i) const -> bool { return !entry(i).raw; }
+
+    // Bytes held by chunks, raw or encoded; excludes cursors and chunks
+    // mapped from segments.
+    [[nodiscard]] auto memory_bytes() const -> size_t {
+        size_t total = 0;
+        for (const Chunk& c : std::span(chunks_).subspan(head_)) {
+            if (c.mapped) continue;
+            const size_t rows = &c == &chunks_.back() ? tail_cap_ : ChunkRows;
+            total += c.raw ? rows * elem_size_ : c.encoded.size_bytes();
+        }
+        return total;
+    }
+
+    template <typename T>
+    [[nodiscard]] auto chunk_as(size_t i, Cursor& cur) const -> std::span<const T> {
+        assert(sizeof(T) == elem_size_);
+        const auto bytes = chunk(i, cur);
+        return { reinterpret_cast<const T*>(bytes.data()), bytes.size() / sizeof(T) };
+    }
+
+    auto reserve(size_t row_count) -> void {
+        chunks_.reserve(head_ + (row_count + ChunkRows - 1) / ChunkRows);
+    }
+
+    [[nodiscard]] auto zones() const -> const ZoneMap& { return zones_; }
 
 private:
-    [[nodiscard]] auto get_table_ptr(TypeHandle type) const -> const Table* {
-        auto it = tables_.find(type);
-        if (it != tables_.end()) return &it->second;
-        return nullptr;
+    [[nodiscard]] auto tail_space() const -> size_t {
+        if (chunk_count() == 0 || zero_tail_) return 0;
+        return (chunk_count() - 1) * ChunkRows + tail_cap_ - rows_;
     }
 
-    [[nodiscard]] auto get_or_create_table(TypeHandle type) -> Table& {
-        if (auto it = tables_.find(type); it != tables_.end()) {
-            return it->second;
+    // Records the presence bytes that follow each of `count` source values
+    // `stride` apart, and zeroes the gathered values of null rows.
+    auto mask_nulls(std::byte* dst, const std::byte* src, size_t count, size_t stride) -> void {
+        for (size_t i = 0; i < count; ++i) {
+            const bool valid = src[i * stride + elem_size_] != std::byte{0};
+            valid_.append(rows_ + i, valid);
+            if (!valid) std::memset(dst + i * elem_size_, 0, elem_size_);
         }
+    }
 
-        auto&& fields = schema_.meta_of(type).fields;
+    struct Chunk {
+        ChunkPtr         raw;
+        gorilla::Encoded encoded;
+        bool             mapped  = false;
+        u64              seal_id = 0;   // set by seal(), never reused
+    };
 
-        auto offsets = fields
-            | std::views::transform([](auto& f) { return f.offset; })
-            | std::ranges::to<std::vector<u32>>();
+    // Ids for Chunk::seal_id, unique across columns as a cursor may move
+    // between them.
+    [[nodiscard]] static auto next_seal_id() -> u64 {
+        static std::atomic<u64> next { 1 };
+        return next.fetch_add(1, std::memory_order_relaxed);
+    }
 
-        auto sizes = fields
-            | std::views::transform([&](auto& f) { return schema_.meta_of(f.type).size; })
-            | std::ranges::to<std::vector<size_t>>();
+    // Widest element fill() can serve from the zero chunk.
+    constexpr static size_t ZeroElemMax = 16;
+
+    // ChunkRows * ZeroElemMax read-only zero bytes. Every page of the mapping
+    // is the kernel's zero page, so it costs address space only.
+    [[nodiscard]] static auto zero_chunk() -> const std::byte* {
+        static const std::byte* zeros = [] {
+            void* p = ::mmap(nullptr, ChunkRows * ZeroElemMax, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                             -1, 0);
+            assert(p != MAP_FAILED);
+            return static_cast<const std::byte*>(p);
+        }();
+        return zeros;
+    }
+
+    [[nodiscard]] static auto mapped_chunk(const std::byte* data) -> Chunk {
+        // Never written through: mapped chunks are full, and only the tail
+        // chunk takes appends.
+        return { .raw = ChunkPtr { const_cast<std::byte*>(data), ChunkDeleter{ .from_heap = false } }, .mapped = true };
+    }
+
+    [[nodiscard]] auto entry(size_t i) -> Chunk& { return chunks_[head_ + i]; }
+    [[nodiscard]] auto entry(size_t i) const -> const Chunk& { return chunks_[head_ + i]; }
 
-        return tables_.emplace(type, Table {std::move(sizes), {offsets.begin(), offsets.end()}}).first->second;
+    auto release(Chunk& c) -> void {
+        if (c.raw && !c.mapped) {
+            const size_t bytes = ChunkRows * elem_size_;
+            if (c.raw.get_deleter().from_heap) {
+                // The allocator may keep the block; its pages go back now.
+                const auto first = align_up(reinterpret_cast<std::uintptr_t>(c.raw.get()), std::uintptr_t{4096});
+                const auto last  = (reinterpret_cast<std::uintptr_t>(c.raw.get()) + bytes) & ~std::uintptr_t{4095};
+                if (first < last) ::madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+            } else if (arena_ != nullptr) {
+                arena_->release(c.raw.release(), bytes);
+            }
+        }
+        c = Chunk {};
     }
 
-    Schema schema_;
-    absl::flat_hash_map<TypeHandle, Table> tables_;
+    [[nodiscard]] auto slot(size_t row) -> std::byte* {
+        return entry(row / ChunkRows).raw.get() + (row % ChunkRows) * elem_size_;
+    }
+
+    [[nodiscard]] auto alloc_chunk(size_t rows = ChunkRows) const -> ChunkPtr {
+        const size_t bytes = rows * elem_size_;
+
+        if (arena_ != nullptr && bytes <= ChunkArena::region_size) {
+            auto* p = static_cast<std::byte*>(arena_->allocate(bytes, ChunkAlign));
+            return { p, ChunkDeleter{ .from_heap = false } };
+        }
+
+        auto* p = static_cast<std::byte*>(::operator new[](bytes, std::align_val_t{ChunkAlign}));
+        return { p, ChunkDeleter{} };
+    }
+
+    auto add_chunk() -> void {
+        if (zero_tail_ && rows_ % ChunkRows != 0) return own_zero_tail();
+        if (chunk_count() > 0 && tail_cap_ < ChunkRows) return grow_tail();
+
+        seal_tail();
+        zero_tail_ = false;
+        tail_cap_  = chunk_count() == 0 ? FirstChunkRows : ChunkRows;
+        chunks_.push_back({ .raw = alloc_chunk(tail_cap_) });
+    }
+
+    // Encodes the last chunk, which is full, before another is added.
+    auto seal_tail() -> void {
+        if (compress_ && chunk_count() > 0 && !chunks_.back().mapped) seal(chunks_.back());
+    }
+
+    // Gives a partly filled zero tail chunk memory of its own, so appends
+    // can write to it.
+    auto own_zero_tail() -> void {
+        ChunkPtr raw = alloc_chunk();
+        std::memset(raw.get(), 0, (rows_ % ChunkRows) * elem_size_);
+        chunks_.back() = { .raw = std::move(raw) };
+        zero_tail_     = false;
+    }
+
+    // Doubles a first chunk that is not yet ChunkRows long; its rows move.
+    auto grow_tail() -> void {
+        const size_t cap   = std::min(ChunkRows, tail_cap_ * 2);
+        ChunkPtr     grown = alloc_chunk(cap);
+
+        Chunk& c = chunks_.back();
+        std::memcpy(grown.get(), c.raw.get(), tail_cap_ * elem_size_);
+        if (!c.raw.get_deleter().from_heap && arena_ != nullptr) {
+            arena_->release(c.raw.release(), tail_cap_ * elem_size_);
+        }
+
+        c.raw     = std::move(grown);
+        tail_cap_ = cap;
+    }
+
+    auto seal(Chunk& c) -> void {
+        const std::byte* raw = c.raw.get();
+
+        auto encode = [&]<typename T>() {
+            const std::span<const T> v { reinterpret_cast<const T*>(raw), ChunkRows };
+            if constexpr (std::floating_point<T>) return gorilla::encode_xor(v);
+            else                                  return gorilla::encode_bitpack(v);
+        };
+
+        switch (kind_) {
+            case Schema::TypeKind::TIMESTAMP_NS:
+                c.encoded = gorilla::encode_timestamps({ reinterpret_cast<const i64*>(raw), ChunkRows });
+                break;
+            case Schema::TypeKind::BOOL:
+                c.encoded = encode.template operator()<bool>();
+                break;
+            case Schema::TypeKind::SYMBOL:
+                c.encoded = encode.template operator()<u32>();
+                break;
+            default:
+                // Struct-valued and BYTES fields have no codec and stay raw.
+                if (auto e = Schema::visit_numeric(kind_, encode); e.is_some()) {
+                    c.encoded = std::move(e).unwrap();
+                    break;
+                }
+                return;
+        }
+
+        c.seal_id = next_seal_id();
+
+        // The raw rows go back to the heap or to the arena's free list.
+        if (!c.raw.get_deleter().from_heap && arena_ != nullptr) {
+            arena_->release(c.raw.release(), ChunkRows * elem_size_);
+        }
+        c.raw.reset();
+    }
+
+    // Chunk `i`, which is sealed, decoded into `cur`.
+    [[nodiscard]] auto decoded(size_t i, Cursor& cur) const -> const std::byte* {
+        const Chunk&            c = entry(i);
+        const gorilla::Encoded& e = c.encoded;
+        if (cur.key_ == c.seal_id) return cur.buf_.get();
+
+        // Heap memory: cursors belong to readers, which must not touch the arena.
+        if (cur.cap_ < ChunkRows * elem_size_) {
+            cur.cap_ = ChunkRows * elem_size_;
+            cur.buf_.reset(static_cast<std::byte*>(::operator new[](cur.cap_, std::align_val_t{ChunkAlign})));
+        }
+        std::byte* out = cur.buf_.get();
+
+        auto decode = [&]<typename T>() {
+            const std::span<T> v { reinterpret_cast<T*>(out), ChunkRows };
+            if constexpr (std::floating_point<T>) gorilla::decode_xor(e, v);
+            else                                  gorilla::decode_bitpack(e, v);
+            return 0;
+        };
+
+        switch (kind_) {
+            case Schema::TypeKind::TIMESTAMP_NS:
+                gorilla::decode_timestamps(e, { reinterpret_cast<i64*>(out), ChunkRows });
+                break;
+            case Schema::TypeKind::BOOL:
+                decode.template operator()<bool>();
+                break;
+            case Schema::TypeKind::SYMBOL:
+                decode.template operator()<u32>();
+                break;
+            default:
+                (void)Schema::visit_numeric(kind_, decode);
+        }
+
+        cur.key_ = c.seal_id;
+        return out;
+    }
+
+    template <size_t N>
+    static auto gather_fixed(std::byte* dst, const std::byte* src, size_t count, size_t stride) -> void {
+        for (size_t i = 0; i < count; ++i) {
+            std::memcpy(dst + i * N, src + i * stride, N);
+        }
+    }
+
+    static auto gather(std::byte* dst, const std::byte* src, size_t count, size_t stride, size_t elem_size) -> void {
+        switch (elem_size) {
+            case 1: return gather_fixed<1>(dst, src, count, stride);
+            case 2: return gather_fixed<2>(dst, src, count, stride);
+            case 4: return gather_fixed<4>(dst, src, count, stride);
+            case 8: return gather_fixed<8>(dst, src, count, stride);
+            default:
+                for (size_t i = 0; i < count; ++i) {
+                    std::memcpy(dst + i * elem_size, src + i * stride, elem_size);
+                }
+        }
+    }
+
+    size_t           elem_size_ = 0;
+    size_t           rows_      = 0;
+    Schema::TypeKind kind_      = Schema::TypeKind::STRUCT;
+    bool             nullable_  = false;
+    bool             compress_  = false;
+    ChunkArena*      arena_     = nullptr;
+    std::vector<Chunk> chunks_;
+    size_t           head_      = 0;    // dropped chunks still at the front of chunks_
+    size_t           tail_cap_  = 0;    // rows the last chunk can hold
+    bool             zero_tail_ = false;   // the last chunk is the zero chunk
+    ZoneMap          zones_;
+    Validity         valid_;
+};
+
+// Type-erased result of an aggregation, widened to f64.
+struct Aggregate {
+    f64 sum   = 0;
+    f64 min   = std::numeric_limits<f64>::infinity();
+    f64 max   = -std::numeric_limits<f64>::infinity();
+    u64 count = 0;
+
+    [[nodiscard]] auto mean() const -> f64 {
+        return count > 0 ? sum / static_cast<f64>(count) : std::numeric_limits<f64>::quiet_NaN();
+    }
+
+    template <typename T>
+    [[nodiscard]] static auto from(const kernels::Summary<T>& s) -> Aggregate {
+        if (s.count == 0) return {};
+        return {
+            .sum   = static_cast<f64>(s.sum),
+            .min   = static_cast<f64>(s.min),
+            .max   = static_cast<f64>(s.max),
+            .count = s.count,
+        };
+    }
+};
+
+// Zero-copy typed view of rows [first, last) of a column. Rows live in
+// separate chunks, so bulk access goes through chunks(), which yields one
+// contiguous span per chunk. A view decodes sealed chunks into a cursor of
+// its own: take one per reading thread.
+template <typename T>
+class ColumnView {
+public:
+    ColumnView() = default;
+    ColumnView(const Column* column, size_t first, size_t last)
+        : column_(column), first_(first), last_(last)
+    {
+        assert(column_ == nullptr || column_->elem_size() == sizeof(T));
+    }
+
+    [[nodiscard]] auto size() const -> size_t { return last_ - first_; }
+    [[nodiscard]] auto empty() const -> bool { return first_ == last_; }
+
+    [[nodiscard]] auto first_row() const -> size_t { return first_; }
+
+    [[nodiscard]] auto operator[](size_t i) const -> T { return column_->template value<T>(first_ + i, cursor_); }
+
+    // Row i as an option: None where a nullable column holds no value.
+    [[nodiscard]] auto get(size_t i) const -> Option<T> { return column_->template get<T>(first_ + i, cursor_); }
+
+    [[nodiscard]] auto nullable() const -> bool { return column_ != nullptr && column_->nullable(); }
+    [[nodiscard]] auto is_valid(size_t i) const -> bool { return column_->is_valid(first_ + i); }
+
+    // Each span stays valid until the range yields the next one.
+    [[nodiscard]] auto chunks() const {
+        const size_t first_chunk = first_ / ChunkRows;
+        const size_t end_chunk   = empty() ? first_chunk : (last_ - 1) / ChunkRows + 1;
+
+        // Captures by value so the range outlives a temporary view.
+        return std::views::iota(first_chunk, end_chunk)
+             | std::views::transform([column = column_, first = first_, last = last_,
+                                      cur = std::make_shared<Column::Cursor>()](size_t c) {
+                   const size_t base = c * ChunkRows;
+                   const size_t lo   = std::max(first, base) - base;
+                   const size_t hi   = std::min(last, base + ChunkRows) - base;
+                   return column->template chunk_as<T>(c, *cur).subspan(lo, hi - lo);
+               });
+    }
+
+private:
+    const Column*          column_ = nullptr;
+    size_t                 first_  = 0;
+    size_t                 last_   = 0;
+    mutable Column::Cursor cursor_;
+};
+
+struct Table {
+public:
+    // A Column::Cursor per column, for reads that go row by row.
+    using Cursor = std::vector<Column::Cursor>;
+
+    Table(std::vector<size_t> field_sizes, std::vector<size_t> field_offsets,
+          std::vector<Schema::TypeKind> field_kinds, size_t row_size, TableOptions options = {},
+          std::vector<bool> field_nullable = {})
+        : compress_(options.compress_sealed), latest_(std::in_place, row_size), field_offsets_(std::move(field_offsets))
+    {
+        if (options.memory == TableMemory::HugePages) {
+            arena_ = std::make_unique<ChunkArena>();
+        }
+
+        field_nullable.resize(field_sizes.size());
+        columns_.reserve(field_sizes.size());
+        for (size_t i = 0; i < field_sizes.size(); ++i) {
+            columns_.emplace_back(field_sizes[i], field_kinds[i], field_nullable[i], arena_.get(),
+                                  options.compress_sealed);
+        }
+    }
+
+    auto insert_row(const std::byte* src) -> void {
+        if (lateness_.is_some()) return stage(src, 1, latest_->size());
+
+        for (size_t i = 0; i < columns_.size(); ++i) {
+            if (field_offsets_[i] == Schema::Field::Dropped) columns_[i].fill(1);
+            else                                             columns_[i].push(src + field_offsets_[i]);
+        }
+        ++row_count_;
+        latest_->store(src);
+    }
+
+    auto insert_rows(const std::byte* src, size_t count, size_t stride) -> void {
+        if (lateness_.is_some()) return stage(src, count, stride);
+
+        append_rows(src, count, stride);
+        if (count > 0) latest_->store(src + (count - 1) * stride);
+    }
+
+    // insert_row and read_row for a reflected T, unrolled over its fields:
+    // each column gets one copy with a constant size from a constant offset.
+    template <reflect::Reflected T>
+    auto insert_typed(const T& row) -> void {
+        const auto* bytes = reinterpret_cast<const std::byte*>(&row);
+        if (lateness_.is_some()) return stage(bytes, 1, sizeof(T));
+
+        assert(columns_.size() == reflect::field_count<T> && latest_->size() == sizeof(T));
+        [&]<size_t... I>(std::index_sequence<I...>) {
+            (columns_[I].push_value(row.*std::get<I>(reflect::Fields<T>::fields).member), ...);
+        }(std::make_index_sequence<reflect::field_count<T>>{});
+
+        ++row_count_;
+        latest_->store(bytes);
+    }
+
+    template <reflect::Reflected T>
+    [[nodiscard]] auto read_typed(size_t row, Cursor& cur) const -> T {
+        cur.resize(std::max(cur.size(), columns_.size()));
+        T result {};
+        [&]<size_t... I>(std::index_sequence<I...>) {
+            ((result.*std::get<I>(reflect::Fields<T>::fields).member
+                = columns_[I].template value<reflect::field_type<T, I>>(row, cur[I])), ...);
+        }(std::make_index_sequence<reflect::field_count<T>>{});
+        return result;
+    }
+
+    template <reflect::Reflected T>
+    [[nodiscard]] auto read_typed(size_t row) const -> T {
+        Cursor cur;
+        return read_typed<T>(row, cur);
+    }
+
+    // Accepts rows up to window_ns older than the newest one seen. Rows are
+    // staged sorted by timestamp and appended once the newest timestamp is
+    // window_ns past them, so the columns stay sorted and are never re-sorted.
+    // Staged rows are invisible to row-based reads; rows older than the last
+    // appended one can no longer be placed and are counted in late_rows().
+    auto set_lateness(i64 window_ns) -> void {
+        assert(window_ns >= 0);
+        lateness_ = Some(window_ns);
+        commit_staged(newest_ts() - window_ns);
+    }
+
+    // Appends every staged row, e.g. before writing the last segment.
+    auto flush_staged() -> void {
+        commit_staged(std::numeric_limits<i64>::max());
+    }
+
+    [[nodiscard]] auto staged_rows() const -> size_t { return staged_.size() / latest_->size() - staged_head_; }
+
+    [[nodiscard]] auto late_rows() const -> u64 { return late_rows_; }
+
+    // Copies the last appended row into `dst` without touching the columns;
+    // safe while another thread appends, but not during relayout(). False if
+    // the table is empty.
+    auto read_latest(std::byte* dst) const -> bool {
+        return latest_->load(dst);
+    }
+
+    // Reads through `cur` reuse its decoded chunks, so scans should keep one
+    // cursor for all their rows.
+    auto read_row(size_t row, std::byte* dst, Cursor& cur) const -> void {
+        cur.resize(std::max(cur.size(), columns_.size()));
+        for (size_t i = 0; i < columns_.size(); ++i) {
+            if (field_offsets_[i] == Schema::Field::Dropped) continue;
+
+            const Column& col = columns_[i];
+            std::memcpy(dst + field_offsets_[i], col.at(row, cur[i]), col.elem_size());
+            if (col.nullable()) dst[field_offsets_[i] + col.elem_size()] = std::byte{col.is_valid(row)};
+        }
+    }
+
+    auto read_row(size_t row, std::byte* dst) const -> void {
+        Cursor cur;
+        read_row(row, dst, cur);
+    }
+
+    auto reserve(size_t row_count) -> void {
+        for (auto& col : columns_) {
+            col.reserve(row_count);
+        }
+    }
+
+    // First row whose timestamp is >= ts. Rows are appended in timestamp order,
+    // so this is a binary search over the timestamp zone maxima (which stay in
+    // cache) and then over the one ZoneRows block that can hold ts.
+    [[nodiscard]] auto lower_bound(i64 ts) const -> size_t {
+        const Column&  col   = columns_[0];
+        const ZoneMap& zones = col.zones();
+
+        size_t lo = 0;
+        size_t hi = zones.size();
+        while (lo < hi) {
+            const size_t mid = lo + (hi - lo) / 2;
+            if (zones.bounds<i64>(mid).second < ts) lo = mid + 1;
+            else                                    hi = mid;
+        }
+
+        if (lo == zones.size()) return row_count_;
+
+        const size_t   first = lo * ZoneRows;
+        Column::Cursor cur;
+        const auto     block = col.chunk_as<i64>(first / ChunkRows, cur)
+                                  .subspan(first % ChunkRows)
+                                  .first(std::min(ZoneRows, row_count_ - first));
+        return first + static_cast<size_t>(std::ranges::lower_bound(block, ts) - block.begin());
+    }
+
+    // Rows [first, last) with start_ns <= timestamp < end_ns.
+    [[nodiscard]] auto row_bounds(i64 start_ns, i64 end_ns) const -> std::pair<size_t, size_t> {
+        if (start_ns >= end_ns) return { 0, 0 };
+        return { lower_bound(start_ns), lower_bound(end_ns) };
+    }
+
+    // Calls f(first, last) for each piece of rows [first, last) whose zone
+    // bounds on column `col` intersect [lo, hi]; other blocks are never read.
+    // Pieces never cross a zone, so each lies in one chunk. A column without
+    // a zone map (e.g. BOOL) has every piece as a candidate.
+    template <typename V, typename F>
+    auto for_each_candidate(size_t col, V lo, V hi, size_t first, size_t last, F&& f) const -> void {
+        const ZoneMap& zones = columns_[col].zones();
+
+        while (first < last) {
+            const size_t zone = first / ZoneRows;
+            const size_t end  = std::min(last, (zone + 1) * ZoneRows);
+
+            if (!zones.enabled()) {
+                f(first, end);
+            } else if (const auto [zmin, zmax] = zones.bounds<V>(zone); !(zmax < lo || hi < zmin)) {
+                f(first, end);
+            }
+
+            first = end;
+        }
+    }
+
+    [[nodiscard]] auto row_count() const -> size_t { return row_count_; }
+
+    [[nodiscard]] auto column_count() const -> size_t { return columns_.size(); }
+
+    // Adds a column for a new field; the rows so far read as its default
+    // (see Column::fill). Views of the table's columns taken before are stale.
+    // Staged rows have no value for it, so flush_staged() them first.
+    auto add_column(size_t elem_size, Schema::TypeKind kind, bool nullable) -> void {
+        assert(staged_rows() == 0);
+        columns_.emplace_back(elem_size, kind, nullable, arena_.get(), compress_);
+        columns_.back().fill(row_count_);
+    }
+
+    // Switches inserts to rows of `row_size` bytes with column i at
+    // offsets[i], or Schema::Field::Dropped for a column that takes no more
+    // values and gets defaults instead. Rows still staged for lateness were
+    // given in the old layout, so they must be flushed before the columns or
+    // the layout change. The seqlocked copy of the last row is replaced by
+    // one of the new size, so no read_latest() may run meanwhile.
+    auto relayout(std::vector<size_t> offsets, size_t row_size) -> void {
+        assert(offsets.size() == columns_.size() && staged_rows() == 0);
+        field_offsets_ = std::move(offsets);
+
+        latest_.emplace(row_size);
+        if (row_count_ > 0) {
+            std::vector<std::byte> last(row_size);
+            read_row(row_count_ - 1, last.data());
+            latest_->store(last.data());
+        }
+    }
+
+    [[nodiscard]] auto memory_bytes() const -> size_t {
+        size_t total = 0;
+        for (const auto& col : columns_) total += col.memory_bytes();
+        return total;
+    }
+
+    [[nodiscard]] auto column(size_t i) const -> const Column& { return columns_[i]; }
+
+    [[nodiscard]] auto arena() const -> const ChunkArena* { return arena_.get(); }
+
+    // Full chunks [0, persisted_chunks()) are served from segment files.
+    [[nodiscard]] auto persisted_chunks() const -> size_t { return persisted_chunks_; }
+
+    [[nodiscard]] auto full_chunks() const -> size_t { return row_count_ / ChunkRows; }
+
+    // The newest timestamp in the persisted chunks and how many of their rows
+    // have it; None if no chunk is persisted.
+    [[nodiscard]] auto persisted_mark() const -> Option<std::pair<i64, u64>> {
+        const size_t rows = persisted_chunks_ * ChunkRows;
+        if (rows == 0) return None;
+
+        Column::Cursor cur;
+        const i64 newest = columns_[0].value<i64>(rows - 1, cur);
+        u64 ties = 0;
+        for (size_t r = rows; r > 0 && columns_[0].value<i64>(r - 1, cur) == newest; --r) ++ties;
+        return Some(std::pair { newest, ties });
+    }
+
+    // Serves full chunks [first, first + n) from `seg`, which holds a copy of
+    // them, and frees their memory.
+    auto adopt_segment(segment::Segment seg, size_t first) -> void {
+        const size_t n = seg.header().chunk_count;
+        for (size_t i = 0; i < columns_.size(); ++i) {
+            for (size_t c = 0; c < n; ++c) {
+                columns_[i].map_chunk(first + c, seg.chunk(i, c));
+            }
+        }
+        persisted_chunks_ = first + n;
+        segments_.push_back({ std::move(seg), n });
+    }
+
+    // Appends the rows of `seg` after the table's own, which must all be in
+    // persisted chunks. Only chunk pointers and zones are touched. A segment
+    // of an older version of the type may lack the newest columns; those
+    // are filled with defaults.
+    auto attach_segment(segment::Segment seg) -> void {
+        assert(persisted_chunks_ * ChunkRows == row_count_);
+
+        const size_t n = seg.header().chunk_count;
+        for (size_t i = seg.header().field_count; i < columns_.size(); ++i) columns_[i].fill(n * ChunkRows);
+        for (size_t i = 0; i < seg.header().field_count; ++i) {
+            const auto zones = seg.zones(i);
+            const auto valid = seg.valid(i);
+            for (size_t c = 0; c < n; ++c) {
+                columns_[i].attach(seg.chunk(i, c),
+                                   zones.empty() ? zones : zones.subspan(c * ZonesPerChunk, ZonesPerChunk),
+                                   valid.empty() ? valid : valid.subspan(c * ChunkRows / 64, ChunkRows / 64));
+            }
+        }
+        row_count_        += n * ChunkRows;
+        persisted_chunks_ += n;
+        segments_.push_back({ std::move(seg), n });
+
+        std::vector<std::byte> last(latest_->size());
+        read_row(row_count_ - 1, last.data());
+        latest_->store(last.data());
+    }
+
+    // Drops whole chunks, oldest first, while the newest row of the oldest
+    // one is before cutoff_ns. Each drop is O(1) per column: no rows move.
+    // Rows are renumbered, so row indices and views taken before are stale.
+    // Returns the number of rows dropped.
+    auto drop_before(i64 cutoff_ns) -> size_t {
+        size_t dropped = 0;
+        while (row_count_ >= ChunkRows) {
+            if (columns_[0].zones().bounds<i64>(ZonesPerChunk - 1).second >= cutoff_ns) break;
+
+            for (auto& col : columns_) col.drop_front();
+            row_count_ -= ChunkRows;
+            dropped    += ChunkRows;
+
+            // Persisted chunks are a prefix served from segments in order; a
+            // segment is unmapped with its last chunk.
+            if (persisted_chunks_ > 0) {
+                --persisted_chunks_;
+                if (--segments_.front().live_chunks == 0) segments_.erase(segments_.begin());
+            }
+        }
+        return dropped;
+    }
+
+private:
+    // Column-at-a-time transpose of `count` rows laid out `stride` bytes apart.
+    auto append_rows(const std::byte* src, size_t count, size_t stride) -> void {
+        for (size_t i = 0; i < columns_.size(); ++i) {
+            if (field_offsets_[i] == Schema::Field::Dropped) columns_[i].fill(count);
+            else                                             columns_[i].push_strided(src + field_offsets_[i], count, stride);
+        }
+        row_count_ += count;
+    }
+
+    [[nodiscard]] auto timestamp_at(const std::byte* row) const -> i64 {
+        i64 ts;
+        std::memcpy(&ts, row + field_offsets_[0], sizeof(ts));
+        return ts;
+    }
+
+    [[nodiscard]] auto staged_row(size_t i) const -> const std::byte* {
+        return staged_.data() + (staged_head_ + i) * latest_->size();
+    }
+
+    // Newest timestamp in the columns; nothing older can be appended.
+    [[nodiscard]] auto committed_ts() const -> i64 {
+        if (row_count_ == 0) return std::numeric_limits<i64>::min();
+        const ZoneMap& ts = columns_[0].zones();
+        return ts.bounds<i64>(ts.size() - 1).second;
+    }
+
+    [[nodiscard]] auto newest_ts() const -> i64 {
+        const size_t n = staged_rows();
+        return n > 0 ? timestamp_at(staged_row(n - 1)) : committed_ts();
+    }
+
+    // First staged row with a timestamp after ts.
+    [[nodiscard]] auto staged_upper_bound(i64 ts) const -> size_t {
+        return *std::ranges::partition_point(std::views::iota(size_t{0}, staged_rows()),
+                                             [&](size_t i) { return timestamp_at(staged_row(i)) <= ts; });
+    }
+
+    auto stage(const std::byte* src, size_t count, size_t stride) -> void {
+        if (count == 0) return;
+
+        const size_t rs    = latest_->size();
+        const i64    floor = committed_ts();
+        auto row = [&](size_t i) { return src + i * stride; };
+
+        bool in_order = true;
+        for (i64 prev = staged_rows() > 0 ? newest_ts() : floor; const size_t i : std::views::iota(size_t{0}, count)) {
+            const i64 ts = timestamp_at(row(i));
+            if (ts < prev) {
+                in_order = false;
+                break;
+            }
+            prev = ts;
+        }
+
+        if (in_order) {
+            // The common case: every row goes after everything staged.
+            const size_t at = staged_.size();
+            staged_.resize(at + count * rs);
+            for (size_t i = 0; i < count; ++i) {
+                std::memcpy(staged_.data() + at + i * rs, row(i), rs);
+            }
+        } else {
+            std::vector<u32> order;
+            order.reserve(count);
+            for (u32 i = 0; i < count; ++i) {
+                if (timestamp_at(row(i)) >= floor) order.push_back(i);
+            }
+            late_rows_ += count - order.size();
+            if (order.empty()) return;
+
+            std::ranges::stable_sort(order, {}, [&](u32 i) { return timestamp_at(row(i)); });
+
+            // Staged rows up to the oldest new one keep their place; the rest
+            // are merged with the sorted batch, staged rows first on ties.
+            const size_t from = staged_head_ + staged_upper_bound(timestamp_at(row(order.front())));
+            std::vector<std::byte> tail(staged_.begin() + static_cast<std::ptrdiff_t>(from * rs), staged_.end());
+            const size_t tail_rows = tail.size() / rs;
+
+            staged_.resize((from + tail_rows + order.size()) * rs);
+            std::byte* out = staged_.data() + from * rs;
+
+            size_t t = 0;
+            size_t o = 0;
+            while (t < tail_rows || o < order.size()) {
+                const bool take_tail = o == order.size()
+                    || (t < tail_rows && timestamp_at(tail.data() + t * rs) <= timestamp_at(row(order[o])));
+                std::memcpy(out, take_tail ? tail.data() + t++ * rs : row(order[o++]), rs);
+                out += rs;
+            }
+        }
+
+        latest_->store(staged_row(staged_rows() - 1));
+        commit_staged(newest_ts() - lateness_.unwrap());
+    }
+
+    // Appends the staged rows with timestamps up to cutoff_ns.
+    auto commit_staged(i64 cutoff_ns) -> void {
+        const size_t n = staged_upper_bound(cutoff_ns);
+        if (n == 0) return;
+
+        const size_t rs = latest_->size();
+        append_rows(staged_row(0), n, rs);
+        staged_head_ += n;
+
+        if (staged_head_ * rs == staged_.size()) {
+            staged_.clear();
+            staged_head_ = 0;
+        } else if (staged_head_ * rs * 2 >= staged_.size()) {
+            staged_.erase(staged_.begin(), staged_.begin() + static_cast<std::ptrdiff_t>(staged_head_ * rs));
+            staged_head_ = 0;
+        }
+    }
+
+    struct MappedSegment {
+        segment::Segment file;
+        size_t           live_chunks;
+    };
+
+    // Declared before columns_ so chunks are released before their arena.
+    std::unique_ptr<ChunkArena> arena_;
+    std::vector<MappedSegment> segments_;
+
+    size_t row_count_        = 0;
+    size_t persisted_chunks_ = 0;
+    bool   compress_         = false;
+
+    // Replaced when the row layout changes; see relayout().
+    std::optional<SeqLockedRow> latest_;
+
+    // Out-of-order staging, sorted by timestamp; rows before staged_head_
+    // are already appended.
+    Option<i64>            lateness_ = None;
+    std::vector<std::byte> staged_;
+    size_t                 staged_head_ = 0;
+    u64                    late_rows_   = 0;
+
+    std::vector<size_t> field_offsets_;
+    std::vector<Column> columns_;
+};
+
+// Per-bucket reductions of a time-bucketed aggregation.
+enum class AggOp : u8 {
+    Min,
+    Max,
+    Sum,
+    Avg,
+    Count,
+};
+
+// Columnar result of a time-bucketed aggregation: entry i of each column
+// describes the bucket starting at bucket_start[i]. Only the columns of the
+// requested ops are filled, and buckets without rows are left out.
+template <typename T>
+struct Buckets {
+    std::vector<i64>                 bucket_start;
+    std::vector<T>                   min;
+    std::vector<T>                   max;
+    std::vector<kernels::SumType<T>> sum;
+    std::vector<f64>                 avg;
+    std::vector<u64>                 count;
+
+    [[nodiscard]] auto size() const -> size_t { return bucket_start.size(); }
+};
+
+// Row type of a rollup table: one per closed bucket, stamped with the
+// bucket's start. Values are widened to f64 whatever the source field's kind.
+struct RollupRow {
+    i64 timestamp_ns;
+    f64 min;
+    f64 max;
+    f64 sum;
+    u64 count;
+
+    [[nodiscard]] auto mean() const -> f64 { return sum / static_cast<f64>(count); }
+};
+
+// Rows [first, last) of several tables of one type, merged into timestamp
+// order. Each table is sorted on its own, so this is a k-way merge over one
+// cursor per table. Single pass: iterating consumes the view.
+template <typename T>
+class MergedRows {
+public:
+    struct Source {
+        const Table* table;
+        size_t       first;
+        size_t       last;
+    };
+
+    explicit MergedRows(std::vector<Source> sources) : sources_(std::move(sources)), cursors_(sources_.size()) {
+        for (u32 i = 0; i < sources_.size(); ++i) {
+            cursors_[i].resize(sources_[i].table->column_count());
+            if (sources_[i].first < sources_[i].last) heap_.push_back({ timestamp(i), i });
+        }
+        std::ranges::make_heap(heap_, later);
+    }
+
+    [[nodiscard]] auto empty() const -> bool { return heap_.empty(); }
+
+    // The earliest remaining row.
+    [[nodiscard]] auto front() const -> T {
+        const u32     i = heap_.front().source;
+        const Source& s = sources_[i];
+        T result {};
+        s.table->read_row(s.first, reinterpret_cast<std::byte*>(&result), cursors_[i]);
+        return result;
+    }
+
+    auto pop() -> void {
+        std::ranges::pop_heap(heap_, later);
+        const u32 i = heap_.back().source;
+        if (++sources_[i].first < sources_[i].last) {
+            heap_.back().ts = timestamp(i);
+            std::ranges::push_heap(heap_, later);
+        } else {
+            heap_.pop_back();
+        }
+    }
+
+    class iterator {
+    public:
+        using value_type      = T;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+        explicit iterator(MergedRows* rows) : rows_(rows) {}
+
+        auto operator*() const -> T { return rows_->front(); }
+        auto operator++() -> iterator& { rows_->pop(); return *this; }
+        auto operator++(int) -> void { rows_->pop(); }
+
+        friend auto operator==(const iterator& it, std::default_sentinel_t) -> bool { return it.rows_->empty(); }
+
+    private:
+        MergedRows* rows_ = nullptr;
+    };
+
+    [[nodiscard]] auto begin() -> iterator { return iterator { this }; }
+    [[nodiscard]] auto end() const -> std::default_sentinel_t { return {}; }
+
+private:
+    struct Cursor {
+        i64 ts;
+        u32 source;
+    };
+
+    // Max-heap comparator giving a min-heap; ties go to the lower source.
+    static auto later(const Cursor& a, const Cursor& b) -> bool {
+        return std::tie(a.ts, a.source) > std::tie(b.ts, b.source);
+    }
+
+    [[nodiscard]] auto timestamp(u32 i) const -> i64 {
+        i64 ts;
+        std::memcpy(&ts, sources_[i].table->column(0).at(sources_[i].first, cursors_[i][0]), sizeof(ts));
+        return ts;
+    }
+
+    std::vector<Source>               sources_;
+    mutable std::vector<Table::Cursor> cursors_;   // one per source
+    std::vector<Cursor>               heap_;
+};
+
+// Comparison of a where() predicate.
+using CmpOp = kernels::CmpOp;
+
+// Rows of one table that passed a Filter, as a bitmap: bit i of words[k]
+// covers row base + 64 * k + i, and base is a multiple of 64. for_each and
+// to_vector give the selection vector, in row order.
+struct Selection {
+    size_t           base = 0;
+    std::vector<u64> words;
+
+    [[nodiscard]] auto count() const -> size_t {
+        size_t n = 0;
+        for (u64 w : words) n += static_cast<size_t>(std::popcount(w));
+        return n;
+    }
+
+    [[nodiscard]] auto contains(size_t row) const -> bool {
+        if (row < base || (row - base) / 64 >= words.size()) return false;
+        return (words[(row - base) / 64] >> ((row - base) % 64)) & 1;
+    }
+
+    // Calls f(row) for every selected row in increasing order.
+    template <typename F>
+    auto for_each(F&& f) const -> void { for_each_set(words, base, f); }
+
+    [[nodiscard]] auto to_vector() const -> std::vector<size_t> {
+        std::vector<size_t> out;
+        out.reserve(count());
+        for_each([&](size_t row) { out.push_back(row); });
+        return out;
+    }
+
+    // for_each over `bits`, where bit i of bits[k] stands for row base + 64 * k + i.
+    template <typename F>
+    static auto for_each_set(std::span<const u64> bits, size_t base, F&& f) -> void {
+        for (size_t k = 0; k < bits.size(); ++k) {
+            for (u64 word = bits[k]; word != 0; word &= word - 1) {
+                f(base + k * 64 + static_cast<size_t>(std::countr_zero(word)));
+            }
+        }
+    }
+};
+
+// A predicate over the fields of one type, built with where() and combined
+// with && and ||. It is evaluated a ZoneRows block at a time and column by
+// column: each comparison is a SIMD compare over its column's chunk that
+// yields a selection bitmask, ANDed with the validity bits if the field is
+// nullable, and the masks are combined with and/or. Rows are only read as
+// structs once they are known to pass. A comparison whose zone bounds decide
+// a block never reads its column there, and an && (||) whose left side
+// selects nothing (everything) in a block skips its right side.
+class Filter {
+public:
+    constexpr static size_t BlockWords = ZoneRows / 64;
+
+    template <typename T>
+    Filter(FieldHandle<T> field, CmpOp op, T value) : type_(field.type()) {
+        static_assert(std::is_arithmetic_v<T> && sizeof(T) <= sizeof(u64));
+        Node& leaf = nodes_.emplace_back(Node { .kind = Node::Kind::Leaf, .op = op, .column = field.column() });
+        std::memcpy(&leaf.value, &value, sizeof(T));
+        leaf.leaf = &compare_block<T>;
+    }
+
+    friend auto operator&&(Filter a, Filter b) -> Filter { return join(Node::Kind::And, std::move(a), std::move(b)); }
+    friend auto operator||(Filter a, Filter b) -> Filter { return join(Node::Kind::Or, std::move(a), std::move(b)); }
+
+    [[nodiscard]] auto type() const -> TypeHandle { return type_; }
+
+    // Calls f(row, n, words) for every ZoneRows block of rows [first, last)
+    // of `table` with a row that passes: bit i of words covers row + i for
+    // i < n, row is a multiple of 64, and bits outside [first, last) are clear.
+    template <typename F>
+    auto for_each_block(const Table& table, size_t first, size_t last, F&& f) const -> void {
+        std::vector<u64>            scratch(nodes_.size() * BlockWords);
+        std::vector<Column::Cursor> cursors(nodes_.size());
+        std::array<u64, BlockWords> words;
+        const auto                  root = static_cast<u32>(nodes_.size() - 1);
+
+        while (first < last) {
+            const size_t end = std::min(last, (first / ZoneRows + 1) * ZoneRows);
+            const size_t row = first / 64 * 64;
+            const size_t n   = end - row;
+            const std::span<u64> bits { words.data(), (n + 63) / 64 };
+
+            eval(root, table, row, n, bits.data(), scratch.data(), cursors.data());
+            bits[0] &= ~u64{0} << (first - row);
+            if (std::ranges::any_of(bits, [](u64 w) { return w != 0; })) f(row, n, std::span<const u64>(bits));
+
+            first = end;
+        }
+    }
+
+private:
+    enum class Match : u8 {
+        None,
+        Some,
+        All,
+    };
+
+    struct Node;
+
+    // Writes the selection bits of rows [row, row + n) of `col`, which lie in
+    // one ZoneRows block; bits of the last word past n are cleared.
+    using LeafFn = void (*)(const Node&, const Column& col, Column::Cursor& cur, size_t row, size_t n, u64* out);
+
+    // Nodes are stored children first, so the root is the last one.
+    struct Node {
+        enum class Kind : u8 {
+            Leaf,
+            And,
+            Or,
+        };
+
+        Kind   kind;
+        CmpOp  op     = CmpOp::Eq;
+        u32    column = 0;
+        u64    value  = 0;   // bit pattern of the field's type, as in ZoneMap
+        u32    lhs    = 0;
+        u32    rhs    = 0;
+        LeafFn leaf   = nullptr;
+    };
+
+    [[nodiscard]] static auto join(Node::Kind kind, Filter a, Filter b) -> Filter {
+        assert(a.type_ == b.type_);
+        const auto shift = static_cast<u32>(a.nodes_.size());
+        for (Node n : b.nodes_) {
+            if (n.kind != Node::Kind::Leaf) {
+                n.lhs += shift;
+                n.rhs += shift;
+            }
+            a.nodes_.push_back(n);
+        }
+        a.nodes_.push_back({ .kind = kind, .lhs = shift - 1, .rhs = static_cast<u32>(a.nodes_.size() - 1) });
+        return a;
+    }
+
+    auto eval(u32 i, const Table& table, size_t row, size_t n, u64* out, u64* scratch,
+              Column::Cursor* cursors) const -> void {
+        const Node& node = nodes_[i];
+        if (node.kind == Node::Kind::Leaf) {
+            assert(node.column < table.column_count());
+            return node.leaf(node, table.column(node.column), cursors[i], row, n, out);
+        }
+
+        const size_t words = (n + 63) / 64;
+        eval(node.lhs, table, row, n, out, scratch, cursors);
+        if (node.kind == Node::Kind::And ? std::all_of(out, out + words, [](u64 w) { return w == 0; })
+                                         : all_set(out, n)) {
+            return;
+        }
+
+        // Each node has its own slot, so nested nodes never share one.
+        u64* rhs = scratch + i * BlockWords;
+        eval(node.rhs, table, row, n, rhs, scratch, cursors);
+        if (node.kind == Node::Kind::And) for (size_t k = 0; k < words; ++k) out[k] &= rhs[k];
+        else                              for (size_t k = 0; k < words; ++k) out[k] |= rhs[k];
+    }
+
+    template <typename T>
+    static auto compare_block(const Node& node, const Column& col, Column::Cursor& cur, size_t row, size_t n,
+                              u64* out) -> void {
+        T value;
+        std::memcpy(&value, &node.value, sizeof(T));
+
+        const size_t words = (n + 63) / 64;
+        const u64*   valid = col.nullable() ? col.validity().words(row / ChunkRows) + row % ChunkRows / 64 : nullptr;
+
+        switch (zone_match(node.op, value, col.zones(), row / ZoneRows)) {
+            case Match::None:
+                std::fill_n(out, words, 0);
+                return;
+            case Match::All:
+                // Every value passes, so only nulls are left out.
+                if (valid == nullptr) return fill_ones(out, n);
+                std::copy_n(valid, words, out);
+                break;
+            case Match::Some:
+                kernels::compare(col.chunk_as<T>(row / ChunkRows, cur).subspan(row % ChunkRows, n), node.op, value, out);
+                if (valid != nullptr) for (size_t k = 0; k < words; ++k) out[k] &= valid[k];
+                break;
+        }
+        if (n % 64 != 0) out[words - 1] &= (u64{1} << (n % 64)) - 1;
+    }
+
+    // Whether all, some or none of a block's values can pass, from its zone
+    // bounds alone. A NaN operand never claims All.
+    template <typename T>
+    [[nodiscard]] static auto zone_match(CmpOp op, T c, const ZoneMap& zones, size_t zone) -> Match {
+        if (!zones.enabled()) return Match::Some;
+
+        const auto [lo, hi] = zones.bounds<T>(zone);
+        bool none = false;
+        bool all  = false;
+        switch (op) {
+            case CmpOp::Eq: none = !(lo <= c && c <= hi); all = lo == c && hi == c; break;
+            case CmpOp::Ne: none = lo == c && hi == c;    all = c < lo || hi < c;   break;
+            case CmpOp::Lt: none = !(lo < c);             all = hi < c;             break;
+            case CmpOp::Le: none = !(lo <= c);            all = hi <= c;            break;
+            case CmpOp::Gt: none = !(hi > c);             all = lo > c;             break;
+            case CmpOp::Ge: none = !(hi >= c);            all = lo >= c;            break;
+        }
+        return none ? Match::None : all ? Match::All : Match::Some;
+    }
+
+    static auto fill_ones(u64* out, size_t n) -> void {
+        std::fill_n(out, n / 64, ~u64{0});
+        if (n % 64 != 0) out[n / 64] = (u64{1} << (n % 64)) - 1;
+    }
+
+    [[nodiscard]] static auto all_set(const u64* bits, size_t n) -> bool {
+        for (size_t k = 0; k < n / 64; ++k) {
+            if (bits[k] != ~u64{0}) return false;
+        }
+        return n % 64 == 0 || bits[n / 64] == (u64{1} << (n % 64)) - 1;
+    }
+
+    TypeHandle        type_;
+    std::vector<Node> nodes_;
+};
+
+// The rows whose `field` compares to `value` with `op`, e.g.
+// where(temp, CmpOp::Gt, 42.0) && where(code, CmpOp::Eq, 7u). Rows where a
+// nullable field is null never pass, whatever the op.
+template <typename T>
+[[nodiscard]] auto where(FieldHandle<T> field, CmpOp op, std::type_identity_t<T> value) -> Filter {
+    return Filter { field, op, value };
+}
+
+class TSDB {
+    struct Rollup;
+
+public:
+    // Concurrent ingestion handle; take one per thread. Rows go to per-type
+    // shards private to this writer, so writers share no table and no lock
+    // once each has inserted its first row of a type. Reads of the shards go
+    // through query_range_merged and must not overlap with writes, and types
+    // must be registered before writers start. A shard keeps the retention
+    // and rollups its type had when the writer first inserted a row of it;
+    // rows are folded into the rollups under a lock shared by all writers.
+    class Writer {
+    public:
+        explicit Writer(TSDB& db) : db_(db) {}
+
+        template<typename T>
+        auto insert(const T& src, TypeHandle type) -> void {
+            static_assert(std::is_trivially_copyable_v<T>);
+            const auto* bytes = reinterpret_cast<const std::byte*>(&src);
+
+            if (db_.wal_) db_.wal_->append(type.v_ | ShardBit, bytes, sizeof(T), 1, sizeof(T));
+            Shard& s = shard(type);
+            s.table->insert_row(bytes);
+            after_insert(s, bytes, 1, sizeof(T));
+        }
+
+        template<typename T>
+        auto insert_batch(std::span<const T> src, TypeHandle type) -> void {
+            static_assert(std::is_trivially_copyable_v<T>);
+            if (src.empty()) return;
+            const auto* bytes = reinterpret_cast<const std::byte*>(src.data());
+
+            if (db_.wal_) db_.wal_->append(type.v_ | ShardBit, bytes, sizeof(T), src.size(), sizeof(T));
+            Shard& s = shard(type);
+            s.table->insert_rows(bytes, src.size(), sizeof(T));
+            after_insert(s, bytes, src.size(), sizeof(T));
+        }
+
+    private:
+        // A shard with the rollups and retention of its type, resolved when
+        // it is made so inserts read no map of the TSDB.
+        struct Shard {
+            Table*                                  table;
+            std::vector<std::pair<Rollup*, Table*>> rollups;
+            Option<i64>                             ttl_ns;
+        };
+
+        [[nodiscard]] auto shard(TypeHandle type) -> Shard& {
+            if (auto it = shards_.find(type); it != shards_.end()) return it->second;
+
+            Shard s { .table = db_.add_shard(type), .rollups = {}, .ttl_ns = None };
+            if (auto it = db_.rollups_.find(type); it != db_.rollups_.end()) {
+                for (Rollup& r : it->second) s.rollups.emplace_back(&r, &db_.get_or_create_table(r.target));
+            }
+            if (auto it = db_.retention_.find(type); it != db_.retention_.end()) s.ttl_ns = Some(it->second);
+            return shards_.emplace(type, std::move(s)).first->second;
+        }
+
+        auto after_insert(Shard& s, const std::byte* rows, size_t count, size_t stride) -> void {
+            if (!s.rollups.empty()) {
+                std::unique_lock lock { db_.rollups_mu_ };
+                for (auto [r, target] : s.rollups) update_rollup(*r, *target, rows, count, stride);
+            }
+            if (s.ttl_ns.is_some()) retain(*s.table, s.ttl_ns.unwrap(), rows, count, stride);
+        }
+
+        TSDB& db_;
+        absl::flat_hash_map<TypeHandle, Shard> shards_;
+    };
+
+    // The table of a type registered with register_type<T>(). Rows move
+    // between T and the columns field by field with constant offsets and
+    // sizes instead of the Table's loop over runtime ones; inserts are logged
+    // and feed rollups and retention like TSDB::insert.
+    //
+    // Once the type is evolved by add_field or drop_field, T no longer has
+    // the layout of its rows: inserts fail and insert nothing. Reads keep
+    // working, as T's fields keep their columns.
+    template <reflect::Reflected T>
+    class TypedTable {
+    public:
+        [[nodiscard]] auto type() const -> TypeHandle { return type_; }
+
+        // Whether the type has been evolved since this table was taken.
+        [[nodiscard]] auto stale() const -> bool { return db_->schema_version(type_) != version_; }
+
+        // False, inserting nothing, if stale().
+        auto insert_row(const T& row) -> bool {
+            if (stale()) return false;
+            const auto* bytes = reinterpret_cast<const std::byte*>(&row);
+
+            if (db_->wal_) db_->wal_->append(type_.v_, bytes, sizeof(T), 1, sizeof(T));
+            table_->insert_typed(row);
+            db_->after_insert(type_, *table_, bytes, 1, sizeof(T));
+            return true;
+        }
+
+        auto insert_batch(std::span<const T> rows) -> bool {
+            if (stale()) return false;
+            db_->insert_batch(rows, type_);
+            return true;
+        }
+
+        [[nodiscard]] auto read_row(size_t row) const -> T { return table_->read_typed<T>(row); }
+        [[nodiscard]] auto read_row(size_t row, Table::Cursor& cur) const -> T { return table_->read_typed<T>(row, cur); }
+
+        [[nodiscard]] auto row_count() const -> size_t { return table_->row_count(); }
+
+        [[nodiscard]] auto query_range(i64 start_ns, i64 end_ns) const {
+            const auto [first, last] = table_->row_bounds(start_ns, end_ns);
+            return std::views::iota(first, last)
+                 | std::views::transform([table = table_, cur = std::make_shared<Table::Cursor>()](size_t row) {
+                       return table->read_typed<T>(row, *cur);
+                   });
+        }
+
+    private:
+        friend class TSDB;
+
+        TypedTable(TSDB& db, TypeHandle type)
+            : db_(&db), type_(type), version_(db.schema_version(type)), table_(&db.get_or_create_table(type)) {}
+
+        TSDB*      db_;
+        TypeHandle type_;
+        u32        version_;
+        Table*     table_;
+    };
+
+private:
+    struct IngestQueue;
+
+public:
+    // Producer end of a queue made by start_ingest; copy it to every thread
+    // that enqueues. It touches only its queue, never the maps of the TSDB,
+    // so producers may run while other types are added. Valid until
+    // stop_ingest of its type.
+    class Ingest {
+    public:
+        // Copies the row into the queue (one CAS and a memcpy). Returns its
+        // ticket, or None if the queue is full; the row is in the table once
+        // applied() > ticket.
+        template<typename T>
+        auto enqueue(const T& src) const -> Option<u64> {
+            static_assert(std::is_trivially_copyable_v<T>);
+            assert(q_->ring.record_size() == sizeof(T));
+            return q_->ring.try_push(reinterpret_cast<const std::byte*>(&src));
+        }
+
+        [[nodiscard]] auto applied() const -> u64 { return q_->applied.load(std::memory_order_acquire); }
+
+        [[nodiscard]] auto type() const -> TypeHandle { return type_; }
+
+    private:
+        friend class TSDB;
+
+        Ingest(IngestQueue& q, TypeHandle type) : q_(&q), type_(type) {}
+
+        IngestQueue* q_;
+        TypeHandle   type_;
+    };
+
+    TSDB(size_t est_num_types = 1, TableOptions options = {})
+        : schema_(est_num_types), options_(options) {}
+
+    ~TSDB()           = default;
+    TSDB(const TSDB&) = delete;
+    TSDB(TSDB&&)      = delete;
+
+    auto register_struct(std::string name,
+                         std::initializer_list<std::pair<std::string, const TypeHandle>> fields) -> TypeHandle
+    {
+        return add_stores(schema_.register_struct(name, fields));
+    }
+
+    // Field type for an optional value of a primitive, as in
+    // {"temp", db.nullable(TSDB::F64)}; rows lay it out as Nullable<f64>.
+    auto nullable(TypeHandle prim) -> TypeHandle { return schema_.nullable(prim); }
+
+    // Adds a field to a registered struct as a new version of it, placed
+    // after the others (see Schema::add_field). Rows inserted from now on use
+    // the new layout; rows already in any table of the type read the field as
+    // zero, or null if it is nullable. No column is copied: the new ones map
+    // a shared zero chunk for every full chunk of existing rows. Writers of
+    // the type must be idle, no ingest queue or query_last may run for it,
+    // and views and typed tables taken before see the old layout. Returns the new version,
+    // or None if the type already has a field of that name.
+    auto add_field(TypeHandle type, std::string name, TypeHandle field_type) -> Option<u32> {
+        assert(!queues_.contains(type));
+
+        const auto& ft = schema_.meta_of(field_type);
+        const auto  at = schema_.add_field(type, name, field_type);
+        if (at.is_none()) return None;
+
+        // Rows staged for lateness are in the old layout; append them first.
+        for_each_table(type, [&](Table& t) {
+            t.flush_staged();
+            t.add_column(schema_.value_size(field_type), ft.kind, ft.nullable);
+        });
+        log_schema_change(type, SchemaChange::Op::Add, name, field_type);
+        return Some(evolved(type));
+    }
+
+    // Removes a field from a registered struct as a new version of it. The
+    // column stays, with its values for the rows so far, and reads as zero or
+    // null for rows inserted later; a FieldHandle resolved before still reads
+    // it. Same restrictions as add_field. Returns the new version, or None if
+    // the type has no such field.
+    auto drop_field(TypeHandle type, std::string_view name) -> Option<u32> {
+        assert(!queues_.contains(type));
+
+        if (schema_.drop_field(type, name).is_none()) return None;
+
+        for_each_table(type, [](Table& t) { t.flush_staged(); });
+        log_schema_change(type, SchemaChange::Op::Drop, name, U8);
+        return Some(evolved(type));
+    }
+
+    [[nodiscard]] auto schema_version(TypeHandle type) const -> u32 { return schema_.meta_of(type).version; }
+
+    // Registers T from its TSDB_REFLECT field list, or finds it if already
+    // registered. The layout is checked at compile time against T's own
+    // offsets and size, so rows can be inserted as the T they are. None if a
+    // type of that name is registered with a layout other than T's, e.g.
+    // after add_field or drop_field.
+    template <reflect::Reflected T>
+    auto register_type() -> Option<TypedTable<T>> {
+        static_assert(Schema::matches_layout<T>(), "TSDB_REFLECT fields must list every member of T in order");
+
+        const std::string name { reflect::Fields<T>::name };
+        if (auto found = schema_.find(name); found.is_some()) {
+            if (!schema_.matches<T>(found.unwrap())) return None;
+            return Some(TypedTable<T> { *this, found.unwrap() });
+        }
+
+        std::vector<std::pair<std::string, const TypeHandle>> fields;
+        reflect::for_each_field<T>([&]<typename V>(const reflect::Field<V, T>& f) {
+            if (f.offset > 0) fields.emplace_back(std::string(f.name), schema_.handle_for<V>());
+        });
+
+        return Some(TypedTable<T> { *this, add_stores(schema_.register_struct(name, fields)) });
+    }
+
+    template<typename T>
+    auto insert(const T& src, TypeHandle type) -> void {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        Table& table = get_or_create_table(type);
+        const auto* bytes = reinterpret_cast<const std::byte*>(&src);
+
+        if (wal_) wal_->append(type.v_, bytes, sizeof(T), 1, sizeof(T));
+        table.insert_row(bytes);
+        after_insert(type, table, bytes, 1, sizeof(T));
+    }
+
+    template<typename T>
+    auto insert_batch(std::span<const T> src, TypeHandle type) -> void {
+        static_assert(std::is_trivially_copyable_v<T>);
+        assert(sizeof(T) == schema_.meta_of(type).size);
+
+        if (src.empty()) return;
+
+        Table& table = get_or_create_table(type);
+        const auto* bytes = reinterpret_cast<const std::byte*>(src.data());
+
+        if (wal_) wal_->append(type.v_, bytes, sizeof(T), src.size(), sizeof(T));
+        table.insert_rows(bytes, src.size(), sizeof(T));
+        after_insert(type, table, bytes, src.size(), sizeof(T));
+    }
+
+    // Tag key/value pairs of a series, sorted by key.
+    using Tags = TagIndex::Tags;
+
+    // The series of `type` with these tag values, created on first use; tag
+    // order does not matter. Ids are dense in creation order, and the WAL
+    // refers to series by id, so create series in the same order before
+    // replaying a log, as with types.
+    auto series(TypeHandle type, std::initializer_list<std::pair<std::string_view, std::string_view>> tags)
+        -> SeriesHandle
+    {
+        Tags sorted = sorted_tags(tags);
+        std::string key = series_key(type, sorted);
+        if (auto it = series_ids_.find(key); it != series_ids_.end()) return { type, it->second };
+
+        const auto id = static_cast<u32>(series_.size());
+        series_.push_back({ .type = type, .tags = std::move(sorted), .table = make_table(type) });
+        series_ids_.emplace(std::move(key), id);
+        tag_index_[type].add(id, series_.back().tags);
+        return { type, id };
+    }
+
+    // Ids of the series of `type` matching every matcher, from the inverted
+    // tag index, e.g. {{"region", Op::Eq, "us-east"}, {"host", Op::Regex,
+    // "web.*"}}. Results combine with &, | and - for other boolean forms;
+    // SeriesHandle{type, id} addresses each series.
+    [[nodiscard]] auto select_series(TypeHandle type, std::initializer_list<TagMatcher> matchers) const
+        -> RoaringBitmap
+    {
+        auto it = tag_index_.find(type);
+        if (it == tag_index_.end()) return {};
+        return it->second.select(std::span(matchers.begin(), matchers.size()));
+    }
+
+    [[nodiscard]] auto find_series(TypeHandle type,
+                                   std::initializer_list<std::pair<std::string_view, std::string_view>> tags) const
+        -> Option<SeriesHandle>
+    {
+        auto it = series_ids_.find(series_key(type, sorted_tags(tags)));
+        if (it == series_ids_.end()) return None;
+        return Some(SeriesHandle { type, it->second });
+    }
+
+    [[nodiscard]] auto series_count() const -> size_t { return series_.size(); }
+
+    [[nodiscard]] auto series_tags(SeriesHandle s) const -> const Tags& { return series_[s.id()].tags; }
+
+    // Inserts into the series' own table; the WAL, rollups of the type and
+    // its retention and lateness apply as for TSDB::insert.
+    template<typename T>
+    auto insert(const T& src, SeriesHandle s) -> void {
+        insert_batch(std::span<const T> { &src, 1 }, s);
+    }
+
+    template<typename T>
+    auto insert_batch(std::span<const T> src, SeriesHandle s) -> void {
+        static_assert(std::is_trivially_copyable_v<T>);
+        assert(sizeof(T) == schema_.meta_of(s.type()).size);
+
+        if (src.empty()) return;
+
+        Table& table = *series_[s.id()].table;
+        const auto* bytes = reinterpret_cast<const std::byte*>(src.data());
+
+        if (wal_) wal_->append(SeriesBit | s.id(), bytes, sizeof(T), src.size(), sizeof(T));
+        if (src.size() == 1) table.insert_row(bytes);
+        else                 table.insert_rows(bytes, src.size(), sizeof(T));
+        after_insert(s.type(), table, bytes, src.size(), sizeof(T));
+    }
+
+    // Rows of one series only; other series' data is never touched.
+    template<typename T>
+    [[nodiscard]] auto query_range(SeriesHandle s, i64 start_ns, i64 end_ns) const {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        const Table* table = series_[s.id()].table.get();
+        const auto [first, last] = table->row_bounds(start_ns, end_ns);
+
+        return std::views::iota(first, last)
+             | std::views::transform([table, cur = std::make_shared<Table::Cursor>()](size_t row) {
+                   T result {};
+                   table->read_row(row, reinterpret_cast<std::byte*>(&result), *cur);
+                   return result;
+               });
+    }
+
+    template<typename T>
+    [[nodiscard]] auto query_last(SeriesHandle s) const -> T {
+        static_assert(std::is_trivially_copyable_v<T>);
+        assert(sizeof(T) == schema_.meta_of(s.type()).size);
+
+        T result {};
+        (void)series_[s.id()].table->read_latest(reinterpret_cast<std::byte*>(&result));
+        return result;
+    }
+
+    [[nodiscard]] auto table(SeriesHandle s) const -> const Table* { return series_[s.id()].table.get(); }
+
+    // Id of `s` in the dictionary of a type with SYMBOL fields, adding it if
+    // new; rows then store the id. All SYMBOL fields, shards and series of
+    // the type share one dictionary, so ids compare across all of them. New
+    // strings are logged to the WAL ahead of the rows using them.
+    auto symbol(TypeHandle type, std::string_view s) -> u32 {
+        return symbols_of(type).intern(s, [&](u32) {
+            if (wal_) wal_->append(type.v_ | SymbolBit, reinterpret_cast<const std::byte*>(s.data()),
+                                   static_cast<u32>(s.size()), 1, s.size());
+        });
+    }
+
+    // Lock-free lookups, safe while other threads intern.
+    [[nodiscard]] auto find_symbol(TypeHandle type, std::string_view s) const -> Option<u32> {
+        return symbols_of(type).find(s);
+    }
+
+    [[nodiscard]] auto symbol_name(TypeHandle type, u32 id) const -> std::string_view {
+        return symbols_of(type).name(id);
+    }
+
+    [[nodiscard]] auto symbol_count(TypeHandle type) const -> u32 { return symbols_of(type).size(); }
+
+    // Copies a payload for a BYTES field of `type` into the type's arena and
+    // returns the reference to store in the row. Like symbols, the arena is
+    // shared by the type's shards and series, and payloads are logged to the
+    // WAL ahead of the rows referring to them, in the order they were stored.
+    // Types with BYTES fields cannot be flushed to segments. Payloads are
+    // never reclaimed, not even when retention drops their rows.
+    auto append_bytes(TypeHandle type, std::span<const std::byte> payload) -> BlobRef {
+        return blobs_of(type).append(payload, [&](BlobRef) {
+            if (wal_) wal_->append(type.v_ | BytesBit, payload.data(), static_cast<u32>(payload.size()), 1, payload.size());
+        });
+    }
+
+    // The payload behind a BYTES value, read in place from the arena.
+    [[nodiscard]] auto read_bytes(TypeHandle type, BlobRef ref) const -> std::span<const std::byte> {
+        return blobs_of(type).get(ref);
+    }
+
+    // Maintains per-bucket min/max/sum/count of the named numeric field in a
+    // table of its own, registered as a new type of RollupRow rows and
+    // returned. Every insert through this TSDB (including queued ingestion,
+    // WAL replay and Writer shards) folds its rows into the open bucket in
+    // O(1) per row; the bucket becomes a row of the rollup table when a row
+    // of a later bucket arrives. Rows inserted before registration are not
+    // included, so register it before any writer inserts the type. None if
+    // the field is missing or not numeric.
+    auto register_rollup(TypeHandle type, std::string_view name, i64 bucket_ns) -> Option<TypeHandle> {
+        assert(bucket_ns > 0 && !queues_.contains(type) && !has_shards(type));
+
+        return schema_.field_index(type, name).and_then([&](u32 i) -> Option<TypeHandle> {
+            const auto& field = schema_.meta_of(type).fields[i];
+            const auto  kind  = schema_.meta_of(field.type).kind;
+
+            auto load = Schema::visit_numeric(kind, []<typename T>() -> Rollup::LoadFn {
+                return +[](const std::byte* p) -> f64 {
+                    T v;
+                    std::memcpy(&v, p, sizeof(T));
+                    return static_cast<f64>(v);
+                };
+            });
+            if (load.is_none()) return None;
+
+            const TypeHandle target = schema_.register_struct(
+                std::format("{}.{}/{}ns", schema_.meta_of(type).name, name, bucket_ns), {
+                    {"min",   F64},
+                    {"max",   F64},
+                    {"sum",   F64},
+                    {"count", U64},
+                });
+            assert(schema_.meta_of(target).size == sizeof(RollupRow));
+            (void)get_or_create_table(target);
+
+            Rollup& r = rollups_[type].emplace_back(Rollup {
+                .target    = target,
+                .column    = i,
+                .offset    = 0,
+                .bucket_ns = bucket_ns,
+                .load      = std::move(load).unwrap(),
+            });
+            place_rollup(r, field);
+            return Some(target);
+        });
+    }
+
+    template<typename T>
+    [[nodiscard]] auto query_first(TypeHandle type) const -> T {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        const Table* table = get_table_ptr(type);
+        if (table == nullptr || table->row_count() == 0) {
+            return T{};
+        }
+
+        T result {};
+        auto* dst = reinterpret_cast<std::byte*>(&result);
+        table->read_row(0, dst);
+
+        return result;
+    }
+
+    // Lazily reads the rows with start_ns <= timestamp_ns < end_ns. The bounds
+    // are found by binary search, so only matching rows are ever touched.
+    template<typename T>
+    [[nodiscard]] auto query_range(TypeHandle type, i64 start_ns, i64 end_ns) const {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        const Table* table = get_table_ptr(type);
+        const auto [first, last] = table != nullptr
+            ? table->row_bounds(start_ns, end_ns)
+            : std::pair<size_t, size_t>{ 0, 0 };
+
+        return std::views::iota(first, last)
+             | std::views::transform([table, cur = std::make_shared<Table::Cursor>()](size_t row) {
+                   T result {};
+                   table->read_row(row, reinterpret_cast<std::byte*>(&result), *cur);
+                   return result;
+               });
+    }
+
+    [[nodiscard]] auto writer() -> Writer { return Writer { *this }; }
+
+    // Queued ingestion for `type`: any thread may enqueue rows through the
+    // returned handle into a bounded lock-free ring, and a dedicated thread
+    // drains it into the table in batches, feeding the type's rollups and
+    // retention as it goes. Those are resolved here, so the drain thread
+    // reads no map of the TSDB. Until stop_ingest the table and the type's
+    // rollup tables must not be written otherwise or read, no other path may
+    // insert rows of the type, and its rollups, retention and fields must not
+    // change; Ingest::applied() is the only safe view of progress.
+    auto start_ingest(TypeHandle type, size_t capacity = 1 << 16) -> Ingest {
+        assert(!queues_.contains(type));
+
+        Table& table = get_or_create_table(type);
+        auto q = std::make_unique<IngestQueue>(schema_.meta_of(type).size, capacity);
+        if (auto it = rollups_.find(type); it != rollups_.end()) {
+            for (Rollup& r : it->second) q->rollups.emplace_back(&r, &get_or_create_table(r.target));
+        }
+        if (auto it = retention_.find(type); it != retention_.end()) q->ttl_ns = Some(it->second);
+
+        q->drainer = std::jthread([this, type, &table, q = q.get()](std::stop_token stop) {
+            drain_loop(type, table, *q, stop);
+        });
+        return Ingest { *queues_.emplace(type, std::move(q)).first->second, type };
+    }
+
+    // Applies every row already enqueued, then stops the drain thread.
+    // Producers must have stopped first; their handles are invalid after.
+    auto stop_ingest(TypeHandle type) -> void {
+        queues_.erase(type);
+    }
+
+    // Rows of `type` with start_ns <= timestamp < end_ns from the table and
+    // every writer shard, in timestamp order. Each source is range-limited by
+    // its own binary search before merging.
+    template<typename T>
+    [[nodiscard]] auto query_range_merged(TypeHandle type, i64 start_ns, i64 end_ns) const -> MergedRows<T> {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        std::vector<typename MergedRows<T>::Source> sources;
+        auto add = [&](const Table& t) {
+            const auto [first, last] = t.row_bounds(start_ns, end_ns);
+            if (first < last) sources.push_back({ &t, first, last });
+        };
+
+        if (const Table* table = get_table_ptr(type)) add(*table);
+
+        std::shared_lock lock { shards_mu_ };
+        if (auto it = shards_.find(type); it != shards_.end()) {
+            for (const auto& shard : it->second) add(*shard);
+        }
+
+        return MergedRows<T> { std::move(sources) };
+    }
+
+    // The most recent row of `type` across the table and writer shards, read
+    // from each one's seqlocked copy of its last row: O(1) per source, never
+    // touches column data and never blocks concurrent writers. It must not
+    // overlap add_field or drop_field of the type, which replace those copies.
+    template<typename T>
+    [[nodiscard]] auto query_last(TypeHandle type) const -> T {
+        static_assert(std::is_trivially_copyable_v<T>);
+        static_assert(sizeof(T) % sizeof(u64) == 0);
+        assert(sizeof(T) == schema_.meta_of(type).size);
+
+        T result {};
+        bool found = false;
+
+        auto consider = [&](const Table& t) {
+            T row;
+            if (!t.read_latest(reinterpret_cast<std::byte*>(&row))) return;
+            if (!found || timestamp_of(row) > timestamp_of(result)) result = row;
+            found = true;
+        };
+
+        if (const Table* table = get_table_ptr(type)) consider(*table);
+
+        std::shared_lock lock { shards_mu_ };
+        if (auto it = shards_.find(type); it != shards_.end()) {
+            for (const auto& shard : it->second) consider(*shard);
+        }
+
+        return result;
+    }
+
+    // Resolves a field by name once; the handle is then reused across queries.
+    template<typename T>
+    [[nodiscard]] auto field(TypeHandle type, std::string_view name) const -> Option<FieldHandle<T>> {
+        return schema_.field_index(type, name)
+            .filter([&](u32 i) {
+                const auto& f = schema_.meta_of(type).fields[i];
+                return Schema::holds<T>(schema_.meta_of(f.type).kind);
+            })
+            .map([&](u32 i) { return FieldHandle<T>{ type, i }; });
+    }
+
+    template<typename T>
+    [[nodiscard]] auto column(FieldHandle<T> field) const -> ColumnView<T> {
+        const Table* table = get_table_ptr(field.type());
+        if (table == nullptr) return {};
+
+        return { &table->column(field.column()), 0, table->row_count() };
+    }
+
+    template<typename T>
+    [[nodiscard]] auto column(FieldHandle<T> field, i64 start_ns, i64 end_ns) const -> ColumnView<T> {
+        const Table* table = get_table_ptr(field.type());
+        if (table == nullptr) return {};
+
+        const auto [first, last] = table->row_bounds(start_ns, end_ns);
+        return { &table->column(field.column()), first, last };
+    }
+
+    template<typename T>
+    [[nodiscard]] auto column(TypeHandle type, std::string_view name) const -> Option<ColumnView<T>> {
+        return field<T>(type, name).map([&](FieldHandle<T> f) { return column(f); });
+    }
+
+    // Rows with start_ns <= timestamp_ns < end_ns and lo <= field <= hi. Zone
+    // maps rule out whole blocks before any of their rows are touched.
+    template<typename T, typename V>
+    [[nodiscard]] auto query_where(FieldHandle<V> field, V lo, V hi, i64 start_ns, i64 end_ns) const
+        -> std::vector<T>
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        std::vector<T> result;
+
+        const Table* table = get_table_ptr(field.type());
+        if (table == nullptr) return result;
+
+        const Column& col = table->column(field.column());
+        const auto [first, last] = table->row_bounds(start_ns, end_ns);
+
+        Column::Cursor values_cur;
+        Table::Cursor  rows_cur;
+        table->for_each_candidate(field.column(), lo, hi, first, last, [&](size_t begin, size_t end) {
+            const auto* values = reinterpret_cast<const V*>(col.at(begin, values_cur));
+            for (size_t row = begin; row < end; ++row) {
+                const V v = values[row - begin];
+                if (v < lo || hi < v || !col.is_valid(row)) continue;
+
+                T& out = result.emplace_back();
+                table->read_row(row, reinterpret_cast<std::byte*>(&out), rows_cur);
+            }
+        });
+
+        return result;
+    }
+
+    // Rows with start_ns <= timestamp_ns < end_ns that pass `filter`, as a
+    // selection bitmap over the filter type's table.
+    [[nodiscard]] auto filter(const Filter& f, i64 start_ns, i64 end_ns) const -> Selection {
+        Selection sel;
+        const Table* table = get_table_ptr(f.type());
+        if (table == nullptr) return sel;
+
+        const auto [first, last] = table->row_bounds(start_ns, end_ns);
+        sel.base = first / 64 * 64;
+        sel.words.resize((last - sel.base + 63) / 64);
+        f.for_each_block(*table, first, last, [&](size_t row, size_t, std::span<const u64> words) {
+            std::ranges::copy(words, sel.words.begin() + static_cast<std::ptrdiff_t>((row - sel.base) / 64));
+        });
+        return sel;
+    }
+
+    // query_where() with any filter: the filter is evaluated over its
+    // columns first, and only the rows that pass are assembled by read_row.
+    template<typename T>
+    [[nodiscard]] auto select(const Filter& filter, i64 start_ns, i64 end_ns) const -> std::vector<T> {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        std::vector<T> result;
+        const Table* table = get_table_ptr(filter.type());
+        if (table == nullptr) return result;
+
+        const auto [first, last] = table->row_bounds(start_ns, end_ns);
+        Table::Cursor cur;
+        filter.for_each_block(*table, first, last, [&](size_t row, size_t, std::span<const u64> words) {
+            Selection::for_each_set(words, row, [&](size_t r) {
+                table->read_row(r, reinterpret_cast<std::byte*>(&result.emplace_back()), cur);
+            });
+        });
+        return result;
+    }
+
+    // aggregate() of the rows that pass `filter`. Each block's selection
+    // bits, ANDed with the field's validity if it is nullable, are the lane
+    // masks of the masked kernels, so no row is copied out; blocks where
+    // nothing passes are not read at all.
+    template<typename T>
+    [[nodiscard]] auto aggregate(FieldHandle<T> field, const Filter& filter, i64 start_ns, i64 end_ns) const
+        -> kernels::Summary<T>
+    {
+        assert(field.type() == filter.type());
+
+        kernels::Summary<T> result;
+        const Table* table = get_table_ptr(field.type());
+        if (table == nullptr) return result;
+
+        const Column& col = table->column(field.column());
+        const auto [first, last] = table->row_bounds(start_ns, end_ns);
+        Column::Cursor cur;
+        filter.for_each_block(*table, first, last, [&](size_t row, size_t n, std::span<const u64> words) {
+            const size_t off = row % ChunkRows;
+            const u64*   sel = words.data();
+
+            std::array<u64, Filter::BlockWords> masked;
+            if (col.nullable()) {
+                const u64* valid = col.validity().words(row / ChunkRows) + off / 64;
+                for (size_t k = 0; k < words.size(); ++k) masked[k] = words[k] & valid[k];
+                sel = masked.data();
+            }
+            result.merge(kernels::summarize_masked(col.chunk_as<T>(row / ChunkRows, cur).subspan(off, n), sel, 0));
+        });
+        return result;
+    }
+
+    // sum/min/max/count of a numeric field over a time range, reduced chunk by
+    // chunk with the widest SIMD kernels the CPU supports. Nulls of a nullable
+    // field are masked out and not counted.
+    template<typename T>
+    [[nodiscard]] auto aggregate(FieldHandle<T> field, i64 start_ns, i64 end_ns) const -> kernels::Summary<T> {
+        kernels::Summary<T> result;
+        const Table* table = get_table_ptr(field.type());
+        if (table == nullptr) return result;
+
+        const Column& col = table->column(field.column());
+        const auto [first, last] = table->row_bounds(start_ns, end_ns);
+        Column::Cursor cur;
+        for (size_t row = first; row < last;) {
+            const size_t off = row % ChunkRows;
+            const size_t n   = std::min(last - row, ChunkRows - off);
+            const auto   v   = col.chunk_as<T>(row / ChunkRows, cur).subspan(off, n);
+            result.merge(col.nullable() ? kernels::summarize_masked(v, col.validity().words(row / ChunkRows), off)
+                                        : kernels::summarize(v));
+            row += n;
+        }
+        return result;
+    }
+
+    // Same as above for a field named at runtime; the kernel is picked from
+    // the field's Schema::TypeKind. None if the field is missing or not numeric.
+    [[nodiscard]] auto aggregate(TypeHandle type, std::string_view name, i64 start_ns, i64 end_ns) const
+        -> Option<Aggregate>
+    {
+        return schema_.field_index(type, name).and_then([&](u32 i) {
+            const auto kind = schema_.meta_of(schema_.meta_of(type).fields[i].type).kind;
+            return Schema::visit_numeric(kind, [&]<typename T>() {
+                return Aggregate::from(aggregate(FieldHandle<T>{ type, i }, start_ns, end_ns));
+            });
+        });
+    }
+
+    // sum/min/max/count of `field` per value of the SYMBOL field `key`,
+    // indexed by symbol id. Grouping compares ids only; no string is read.
+    // Rows where either field is null are skipped, as are rows whose key is
+    // not an id of the dictionary (a raw u32 that never came from symbol()).
+    template<typename T>
+    [[nodiscard]] auto aggregate_by(FieldHandle<u32> key, FieldHandle<T> field, i64 start_ns, i64 end_ns) const
+        -> std::vector<kernels::Summary<T>>
+    {
+        assert(key.type() == field.type());
+        std::vector<kernels::Summary<T>> groups(symbol_count(key.type()));
+
+        const ColumnView<u32> keys   = column(key, start_ns, end_ns);
+        const ColumnView<T>   values = column(field, start_ns, end_ns);
+        const bool nullable = keys.nullable() || values.nullable();
+
+        // Both views cover the same rows, so their chunks pair up.
+        auto   chunks = values.chunks();
+        auto   it     = chunks.begin();
+        size_t row    = 0;
+        for (std::span<const u32> k : keys.chunks()) {
+            const std::span<const T> v = *it++;
+            for (size_t i = 0; i < k.size(); ++i) {
+                if (nullable && !(keys.is_valid(row + i) && values.is_valid(row + i))) continue;
+                if (k[i] >= groups.size()) continue;
+
+                kernels::Summary<T>& g = groups[k[i]];
+                g.sum  += v[i];
+                g.min   = std::min(g.min, v[i]);
+                g.max   = std::max(g.max, v[i]);
+                g.count++;
+            }
+            row += k.size();
+        }
+        return groups;
+    }
+
+    // Splits [start_ns, end_ns) into buckets of bucket_ns starting at start_ns
+    // and reduces `field` over each one. Timestamps are sorted, so each
+    // non-empty bucket costs one binary search for its end; its rows are then
+    // reduced ZoneRows at a time with every requested kernel, so the column is
+    // read once. Nulls of a nullable field are masked out; a bucket holding
+    // only nulls is left out like an empty one.
+    template<typename T>
+    [[nodiscard]] auto aggregate(FieldHandle<T> field, i64 start_ns, i64 end_ns, i64 bucket_ns,
+                                 std::initializer_list<AggOp> ops) const -> Buckets<T>
+    {
+        assert(bucket_ns > 0);
+
+        Buckets<T> out;
+        const Table* table = get_table_ptr(field.type());
+        if (table == nullptr) return out;
+
+        u32 mask = 0;
+        for (AggOp op : ops) mask |= 1u << std::to_underlying(op);
+        auto wants = [&](AggOp op) { return (mask >> std::to_underlying(op)) & 1; };
+
+        const bool need_min = wants(AggOp::Min);
+        const bool need_max = wants(AggOp::Max);
+        const bool need_sum = wants(AggOp::Sum) || wants(AggOp::Avg);
+
+        const Column& ts  = table->column(0);
+        const Column& col = table->column(field.column());
+        Column::Cursor ts_cur;
+        Column::Cursor col_cur;
+
+        auto [row, last] = table->row_bounds(start_ns, end_ns);
+        while (row < last) {
+            i64 t;
+            std::memcpy(&t, ts.at(row, ts_cur), sizeof(t));
+
+            // Jump straight to the bucket of the next row; empty ones cost nothing.
+            // Differences of timestamps are taken in u64: start_ns <= t < end_ns,
+            // so they are exact even where i64 would overflow.
+            const u64 bucket   = static_cast<u64>(bucket_ns);
+            const u64 offset   = static_cast<u64>(t) - static_cast<u64>(start_ns);
+            const i64 first_ns = static_cast<i64>(static_cast<u64>(start_ns) + offset / bucket * bucket);
+            const u64 left     = static_cast<u64>(end_ns) - static_cast<u64>(first_ns);
+            const i64 limit_ns = left <= bucket ? end_ns : first_ns + bucket_ns;
+            const size_t stop  = std::min(last, table->lower_bound(limit_ns));
+
+            kernels::Summary<T> s;
+            for (size_t r = row; r < stop;) {
+                const size_t off = r % ChunkRows;
+                const size_t n   = std::min({ stop - r, ChunkRows - off, ZoneRows - off % ZoneRows });
+                const auto   v   = col.chunk_as<T>(r / ChunkRows, col_cur).subspan(off, n);
+
+                if (col.nullable()) {
+                    s.merge(kernels::summarize_masked(v, col.validity().words(r / ChunkRows), off));
+                } else {
+                    if (need_min) s.min  = std::min(s.min, kernels::min(v));
+                    if (need_max) s.max  = std::max(s.max, kernels::max(v));
+                    if (need_sum) s.sum += kernels::sum(v);
+                    s.count += n;
+                }
+                r += n;
+            }
+            if (s.count == 0) {
+                row = stop;
+                continue;
+            }
+
+            out.bucket_start.push_back(first_ns);
+            if (need_min)              out.min.push_back(s.min);
+            if (need_max)              out.max.push_back(s.max);
+            if (wants(AggOp::Sum))     out.sum.push_back(s.sum);
+            if (wants(AggOp::Avg))     out.avg.push_back(static_cast<f64>(s.sum) / static_cast<f64>(s.count));
+            if (wants(AggOp::Count))   out.count.push_back(s.count);
+
+            row = stop;
+        }
+        return out;
+    }
+
+    // Same as above for a field named at runtime. None if the field is
+    // missing or does not hold T.
+    template<typename T>
+    [[nodiscard]] auto aggregate(TypeHandle type, std::string_view name, i64 start_ns, i64 end_ns, i64 bucket_ns,
+                                 std::initializer_list<AggOp> ops) const -> Option<Buckets<T>>
+    {
+        return field<T>(type, name).map([&](FieldHandle<T> f) {
+            return aggregate(f, start_ns, end_ns, bucket_ns, ops);
+        });
+    }
+
+    [[nodiscard]] auto table(TypeHandle type) const -> const Table* {
+        return get_table_ptr(type);
+    }
+
+    // Lets rows of `type` arrive up to window_ns out of order (see
+    // Table::set_lateness); rows inside the window become visible to range
+    // queries once it has passed, or on flush_staged. Applies to the shared,
+    // Writer shard and series tables of the type, existing or made later, and
+    // to WAL replay; must not overlap with writer inserts.
+    auto set_lateness(TypeHandle type, i64 window_ns) -> void {
+        lateness_[type] = window_ns;
+        (void)get_or_create_table(type);
+        for_each_table(type, [&](Table& t) { t.set_lateness(window_ns); });
+    }
+
+    // Same restriction as set_lateness.
+    auto flush_staged(TypeHandle type) -> void {
+        for_each_table(type, [](Table& t) { t.flush_staged(); });
+    }
+
+    // Keeps rows of `type` for ttl_ns: after each insert, whole chunks whose
+    // newest row is more than ttl_ns older than the newest inserted row are
+    // dropped in O(1) each (see Table::drop_before). Data is therefore kept
+    // for at least ttl_ns and at most one more chunk's worth. Writer shards
+    // apply it against their own newest row; set it before any writer
+    // inserts the type.
+    auto set_retention(TypeHandle type, i64 ttl_ns) -> void {
+        assert(ttl_ns >= 0 && !queues_.contains(type) && !has_shards(type));
+        retention_[type] = ttl_ns;
+    }
+
+    // Applies every retention policy against a caller-supplied clock, e.g.
+    // wall time when a type stops receiving rows, to the shared, Writer shard
+    // and series tables alike; must not overlap with writer inserts. Returns
+    // the rows dropped.
+    auto expire(i64 now_ns) -> size_t {
+        size_t dropped = 0;
+        for (const auto& [type, ttl_ns] : retention_) {
+            for_each_table(type, [&](Table& t) { dropped += t.drop_before(now_ns - ttl_ns); });
+        }
+        return dropped;
+    }
+
+    // Writes the full chunks of `type` that are not on disk yet to a new
+    // segment at `path`, then serves them from the mapped file and frees
+    // their memory. Returns the rows written; 0 (and no file) if none.
+    // Unsupported for types with BYTES fields, as segments do not hold the
+    // payloads their refs point to.
+    //
+    // With a WAL open, the log is then rewritten without the type's rows
+    // older than the newest one written, which replay would skip anyway (see
+    // open_wal); throws std::system_error if that fails, leaving the log and
+    // keeping the segment.
+    auto flush_segment(TypeHandle type, const std::string& path) -> Result<size_t, SegmentError> {
+        auto it = tables_.find(type);
+        if (it == tables_.end()) return Ok(size_t{0});
+        if (has_field_kind(type, Schema::TypeKind::BYTES)) return Err(SegmentError::Unsupported);
+
+        Table& table = *it->second;
+        const size_t first = table.persisted_chunks();
+        const size_t count = table.full_chunks() - first;
+        if (count == 0) return Ok(size_t{0});
+
+        const auto& meta = schema_.meta_of(type);
+
+        std::vector<segment::ColumnSource> columns;
+        std::vector<std::vector<u64>>      valid(meta.fields.size());
+        columns.reserve(meta.fields.size());
+        for (size_t i = 0; i < meta.fields.size(); ++i) {
+            const Column& col   = table.column(i);
+            const auto    zones = col.zones().raw();
+            if (col.nullable()) {
+                // Validity blocks are per chunk; the segment stores them back to back.
+                valid[i].reserve(count * Validity::ChunkWords);
+                for (size_t c = first; c < first + count; ++c) {
+                    const u64* words = col.validity().words(c);
+                    valid[i].insert(valid[i].end(), words, words + Validity::ChunkWords);
+                }
+            }
+            columns.push_back({
+                .name          = meta.fields[i].name,
+                .kind          = std::to_underlying(schema_.meta_of(meta.fields[i].type).kind),
+                .elem_size     = static_cast<u32>(col.elem_size()),
+                .struct_offset = meta.fields[i].offset,
+                .zones         = zones.empty() ? zones : zones.subspan(first * ZonesPerChunk, count * ZonesPerChunk),
+                .valid         = valid[i],
+            });
+        }
+
+        const ZoneMap& ts = table.column(0).zones();
+        const i64 first_ts = ts.bounds<i64>(first * ZonesPerChunk).first;
+        const i64 last_ts  = ts.bounds<i64>((first + count) * ZonesPerChunk - 1).second;
+
+        Column::Cursor cur;
+        auto written = segment::write(path, meta.name, meta.size, ChunkRows, count, ZoneRows, first_ts, last_ts,
+                                      columns, [&](size_t field, size_t chunk) { return table.column(field).chunk(first + chunk, cur); });
+        if (written.is_err()) return Err(std::move(written).unwrap_err());
+
+        auto seg = segment::Segment::open(path);
+        if (seg.is_err()) return Err(std::move(seg).unwrap_err());
+
+        table.adopt_segment(std::move(seg).unwrap(), first);
+        note_persisted(type, table);
+        if (wal_) compact_wal();
+        return Ok(count * ChunkRows);
+    }
+
+    // Replays the write-ahead log at `path` into the tables, then logs every
+    // later insert to it before applying it. Types must be registered in the
+    // same order as when the log was written, each at the version its first
+    // logged row has or any later one: add_field and drop_field are logged,
+    // changes past the registered version are replayed in place, and rows
+    // logged at an older version are moved to the current layout. Returns
+    // the number of rows replayed. A record that does not fit the registered
+    // types fails with WalError::Apply and leaves the file untouched; only a
+    // torn or corrupt tail is truncated.
+    //
+    // Open the segments of a type first: rows of its shared table that they
+    // already hold are skipped, i.e. every row older than the newest one in
+    // them and as many of the rows at that timestamp as they have.
+    auto open_wal(const std::string& path, wal::Options options = {}) -> Result<size_t, WalError> {
+        assert(queues_.empty());   // drain threads read wal_ without a lock
+
+        auto marks = persisted_;
+        std::vector<std::byte> scratch;
+        std::vector<std::byte> upgraded;
+
+        // Version of the rows logged so far, by type. A type evolved before
+        // the log was opened starts one before its first logged change, so
+        // only those need a pass over the log first; the rest start current.
+        absl::flat_hash_map<TypeHandle, u32> logged;
+        if (std::ranges::any_of(std::views::iota(u32{0}, static_cast<u32>(schema_.type_count())),
+                                [&](u32 t) { return schema_version(TypeHandle { t }) > 0; }))
+        {
+            (void)wal::replay(path, [&](u32 type, const std::byte* data, u32 row_size, u32) {
+                if (!(type & (SeriesBit | SymbolBit | BytesBit)) && (type & SchemaBit)
+                    && row_size >= sizeof(SchemaChange))
+                {
+                    SchemaChange c;
+                    std::memcpy(&c, data, sizeof(c));
+                    if (c.version > 0) logged.try_emplace(TypeHandle { type & ~SchemaBit }, c.version - 1);
+                }
+                return true;
+            });
+        }
+
+        // Points `data` at rows of `h` in its current layout; false if
+        // row_size is not that of the version they were logged at.
+        auto fit = [&](TypeHandle h, const std::byte*& data, u32 row_size, u32 count) {
+            const auto it = logged.find(h);
+            const u32  at = it != logged.end() ? it->second : schema_version(h);
+            if (at > schema_version(h) || schema_.version(h, at).size != row_size) return false;
+            if (at < schema_version(h)) data = upgrade_rows(h, at, data, count, upgraded).data();
+            return true;
+        };
+
+        size_t rows = 0;
+        auto replayed = wal::replay(path, [&](u32 type, const std::byte* data, u32 row_size, u32 count) {
+            if (type & SeriesBit) {
+                const u32 id = type & ~SeriesBit;
+                if (id >= series_.size() || !fit(series_[id].type, data, row_size, count)) return false;
+                row_size = schema_.meta_of(series_[id].type).size;
+
+                Table& table = *series_[id].table;
+                table.insert_rows(data, count, row_size);
+                after_insert(series_[id].type, table, data, count, row_size);
+                rows += count;
+                return true;
+            }
+
+            if (type & SymbolBit) {
+                auto it = symbols_.find(TypeHandle { type & ~SymbolBit });
+                if (it == symbols_.end()) return false;
+
+                (void)it->second->intern({ reinterpret_cast<const char*>(data), row_size });
+                return true;
+            }
+            if (type & BytesBit) {
+                auto it = blobs_.find(TypeHandle { type & ~BytesBit });
+                if (it == blobs_.end()) return false;
+
+                (void)it->second->append({ data, row_size });
+                return true;
+            }
+            if (type & SchemaBit) {
+                const TypeHandle h { type & ~SchemaBit };
+                if (!schema_.contains(h) || row_size < sizeof(SchemaChange)) return false;
+
+                SchemaChange c;
+                std::memcpy(&c, data, sizeof(c));
+                const std::string name { reinterpret_cast<const char*>(data) + sizeof(c), row_size - sizeof(c) };
+
+                // Already applied if the type was evolved before the log was
+                // opened; a change past the next version means one is missing.
+                if (auto it = logged.find(h); it != logged.end()) it->second = c.version;
+                if (c.version <= schema_version(h)) return true;
+                if (c.version != schema_version(h) + 1) return false;
+                if (c.op == SchemaChange::Op::Add) {
+                    const TypeHandle ft { c.kind };
+                    return add_field(h, name, c.nullable ? schema_.nullable(ft) : ft).is_some();
+                }
+                return drop_field(h, name).is_some();
+            }
+
+            const TypeHandle h { type & ~ShardBit };
+            if (!schema_.contains(h) || schema_.meta_of(h).kind != Schema::TypeKind::STRUCT
+                || !fit(h, data, row_size, count))
+            {
+                return false;
+            }
+            row_size = schema_.meta_of(h).size;
+            if (auto it = marks.find(h); it != marks.end() && !(type & ShardBit)) {
+                const auto kept = unpersisted(it->second, data, row_size, count, scratch);
+                data  = kept.data();
+                count = static_cast<u32>(kept.size() / row_size);
+                if (count == 0) return true;
+            }
+            Table& table = get_or_create_table(h);
+            table.insert_rows(data, count, row_size);
+            after_insert(h, table, data, count, row_size);
+            rows += count;
+            return true;
+        });
+        if (replayed.is_err()) return Err(std::move(replayed).unwrap_err());
+
+        auto log = wal::Log::open(path, std::move(replayed).unwrap(), options);
+        if (log.is_err()) return Err(std::move(log).unwrap_err());
+
+        wal_ = std::move(log).unwrap();
+        return Ok(rows);
+    }
+
+    // Maps a segment written by flush_segment and appends its rows to the
+    // table of the registered type with the same name and the layout of one
+    // of its versions; fields added since read as defaults. Only the
+    // header is read; column data is paged in as queries touch it.
+    auto open_segment(const std::string& path) -> Result<TypeHandle, SegmentError> {
+        auto opened = segment::Segment::open(path);
+        if (opened.is_err()) return Err(std::move(opened).unwrap_err());
+        segment::Segment seg = std::move(opened).unwrap();
+
+        const segment::Header& h = seg.header();
+        const auto found = schema_.find(seg.type_name());
+        if (found.is_none()) return Err(SegmentError::UnknownType);
+
+        const TypeHandle type = found.unwrap();
+        if (h.chunk_rows != ChunkRows || h.zone_rows != ZoneRows) return Err(SegmentError::Layout);
+
+        // Any version of the type will do: columns only ever get appended, so
+        // an older segment's are a prefix of the table's.
+        auto written_by = [&](const Schema::TypeMeta& meta) {
+            if (h.type_size != meta.size || h.field_count != meta.fields.size()) return false;
+            for (size_t i = 0; i < meta.fields.size(); ++i) {
+                const segment::FieldDesc& f  = seg.field(i);
+                const auto&               ft = schema_.meta_of(meta.fields[i].type);
+                if (seg.field_name(i) != meta.fields[i].name || f.kind != std::to_underlying(ft.kind)
+                    || f.elem_size != schema_.value_size(meta.fields[i].type) || f.nullable != ft.nullable
+                    || f.struct_offset != meta.fields[i].offset || (f.zones_offset != 0) != ZoneMap(ft.kind).enabled())
+                {
+                    return false;
+                }
+            }
+            return true;
+        };
+        const auto versions = std::views::iota(u32{0}, schema_.meta_of(type).version + 1);
+        if (std::ranges::none_of(versions, [&](u32 v) { return written_by(schema_.version(type, v)); })) {
+            return Err(SegmentError::Layout);
+        }
+
+        // Segments extend a table at whole persisted chunks, in time order.
+        Table& table = get_or_create_table(type);
+        if (table.persisted_chunks() * ChunkRows != table.row_count()) return Err(SegmentError::Order);
+        if (table.row_count() > 0) {
+            const ZoneMap& ts = table.column(0).zones();
+            if (ts.bounds<i64>(ts.size() - 1).second > h.first_ts) return Err(SegmentError::Order);
+        }
+
+        table.attach_segment(std::move(seg));
+        note_persisted(type, table);
+        return Ok(type);
+    }
+
+    // Default Types
+    constexpr static TypeHandle U8   { std::to_underlying(Schema::TypeKind::U8  ) };
+    constexpr static TypeHandle U16  { std::to_underlying(Schema::TypeKind::U16 ) };
+    constexpr static TypeHandle U32  { std::to_underlying(Schema::TypeKind::U32 ) };
+    constexpr static TypeHandle U64  { std::to_underlying(Schema::TypeKind::U64 ) };
+    constexpr static TypeHandle I8   { std::to_underlying(Schema::TypeKind::I8  ) };
+    constexpr static TypeHandle I16  { std::to_underlying(Schema::TypeKind::I16 ) };
+    constexpr static TypeHandle I32  { std::to_underlying(Schema::TypeKind::I32 ) };
+    constexpr static TypeHandle I64  { std::to_underlying(Schema::TypeKind::I64 ) };
+    constexpr static TypeHandle F32  { std::to_underlying(Schema::TypeKind::F32 ) };
+    constexpr static TypeHandle F64  { std::to_underlying(Schema::TypeKind::F64 ) };
+    constexpr static TypeHandle BOOL { std::to_underlying(Schema::TypeKind::BOOL) };
+
+    constexpr static TypeHandle TIME_NS { std::to_underlying(Schema::TypeKind::TIMESTAMP_NS) };
+    constexpr static TypeHandle SYMBOL  { std::to_underlying(Schema::TypeKind::SYMBOL) };
+    constexpr static TypeHandle BYTES   { std::to_underlying(Schema::TypeKind::BYTES) };
+
+private:
+    // Every registered struct starts with its i64 timestamp.
+    template<typename T>
+    [[nodiscard]] static auto timestamp_of(const T& row) -> i64 {
+        i64 ts;
+        std::memcpy(&ts, &row, sizeof(ts));
+        return ts;
+    }
+
+    // Marks WAL records of a series; the rest of the type field is its id.
+    constexpr static u32 SeriesBit = u32{1} << 31;
+
+    // Marks WAL records holding one new symbol of the type in the rest of
+    // the field; the payload is the string.
+    constexpr static u32 SymbolBit = u32{1} << 30;
+
+    // Marks WAL records holding one BYTES payload of the type.
+    constexpr static u32 BytesBit = u32{1} << 29;
+
+    // Marks WAL records holding a change to the fields of the type: a
+    // SchemaChange followed by the field name.
+    constexpr static u32 SchemaBit = u32{1} << 28;
+
+    // Marks WAL records of rows inserted through a Writer shard. They are
+    // replayed into the shared table, but never held by its segments.
+    constexpr static u32 ShardBit = u32{1} << 27;
+
+    struct SchemaChange {
+        enum class Op : u8 { Add, Drop };
+
+        Op  op;
+        u8  kind;       // of an added field
+        u8  nullable;
+        u8  pad = 0;
+        u32 version;    // of the type once changed
+    };
+
+    auto log_schema_change(TypeHandle type, SchemaChange::Op op, std::string_view name, TypeHandle field_type)
+        -> void
+    {
+        if (!wal_) return;
+
+        const auto& ft = schema_.meta_of(field_type);
+        const SchemaChange c {
+            .op       = op,
+            .kind     = std::to_underlying(ft.kind),
+            .nullable = ft.nullable,
+            .version  = schema_version(type),
+        };
+
+        std::vector<std::byte> payload(sizeof(c) + name.size());
+        std::memcpy(payload.data(), &c, sizeof(c));
+        std::memcpy(payload.data() + sizeof(c), name.data(), name.size());
+        wal_->append(type.v_ | SchemaBit, payload.data(), static_cast<u32>(payload.size()), 1, payload.size());
+    }
+
+    // Moves every table and rollup of `type` to its current layout after
+    // add_field or drop_field; returns the new version.
+    auto evolved(TypeHandle type) -> u32 {
+        const auto& meta = schema_.meta_of(type);
+
+        auto offsets = meta.fields
+            | std::views::transform([](auto& f) -> size_t { return f.offset; })
+            | std::ranges::to<std::vector<size_t>>();
+        for_each_table(type, [&](Table& t) { t.relayout(offsets, meta.size); });
+
+        if (auto it = rollups_.find(type); it != rollups_.end()) {
+            // A rollup of a dropped field stops; its table stays.
+            std::erase_if(it->second, [&](Rollup& r) {
+                const auto& f = meta.fields[r.column];
+                if (!f.dropped()) place_rollup(r, f);
+                return f.dropped();
+            });
+        }
+
+        return meta.version;
+    }
+
+    // The shared table, Writer shards and series tables of a type.
+    template <typename F>
+    auto for_each_table(TypeHandle type, F&& f) -> void {
+        if (auto it = tables_.find(type); it != tables_.end()) f(*it->second);
+
+        std::unique_lock lock { shards_mu_ };
+        if (auto it = shards_.find(type); it != shards_.end()) {
+            for (auto& shard : it->second) f(*shard);
+        }
+        for (Series& s : series_) {
+            if (s.type == type) f(*s.table);
+        }
+    }
+
+    struct Series {
+        TypeHandle             type;
+        Tags                   tags;
+        std::unique_ptr<Table> table;
+    };
+
+    [[nodiscard]] static auto sorted_tags(std::initializer_list<std::pair<std::string_view, std::string_view>> tags)
+        -> Tags
+    {
+        Tags sorted;
+        sorted.reserve(tags.size());
+        for (const auto& [k, v] : tags) sorted.emplace_back(k, v);
+        std::ranges::sort(sorted);
+        assert(std::ranges::adjacent_find(sorted, {}, &Tags::value_type::first) == sorted.end());
+        return sorted;
+    }
+
+    // type id, then key \0 value \0 per tag in key order.
+    [[nodiscard]] static auto series_key(TypeHandle type, const Tags& tags) -> std::string {
+        std::string key(reinterpret_cast<const char*>(&type.v_), sizeof(type.v_));
+        for (const auto& [k, v] : tags) {
+            key.append(k).push_back('\0');
+            key.append(v).push_back('\0');
+        }
+        return key;
+    }
+
+    // Runs after every single-writer insert path has appended rows.
+    auto after_insert(TypeHandle type, Table& table, const std::byte* rows, size_t count, size_t stride) -> void {
+        if (count == 0) return;
+        if (!rollups_.empty()) {
+            if (auto it = rollups_.find(type); it != rollups_.end()) {
+                std::unique_lock lock { rollups_mu_ };
+                for (Rollup& r : it->second) update_rollup(r, get_or_create_table(r.target), rows, count, stride);
+            }
+        }
+
+        if (!retention_.empty()) {
+            if (auto it = retention_.find(type); it != retention_.end()) retain(table, it->second, rows, count, stride);
+        }
+    }
+
+    // `count` rows of struct `type` laid out as its version `from`, moved to
+    // the current layout in `out`: fields dropped since are left out, fields
+    // added since are zero (null if nullable).
+    auto upgrade_rows(TypeHandle type, u32 from, const std::byte* rows, u32 count, std::vector<std::byte>& out) const
+        -> std::span<const std::byte>
+    {
+        const auto& old = schema_.version(type, from);
+        const auto& cur = schema_.meta_of(type);
+
+        out.assign(size_t{count} * cur.size, std::byte { 0 });
+        for (size_t r = 0; r < count; ++r) {
+            const std::byte* src = rows + r * old.size;
+            std::byte*       dst = out.data() + r * cur.size;
+            for (size_t i = 0; i < old.fields.size(); ++i) {
+                if (old.fields[i].dropped() || cur.fields[i].dropped()) continue;
+                std::memcpy(dst + cur.fields[i].offset, src + old.fields[i].offset,
+                            schema_.meta_of(cur.fields[i].type).size);
+            }
+        }
+        return out;
+    }
+
+    // Rows of a type's shared table held in its segments: every row logged
+    // before `ts`, and the first `ties` logged at it.
+    struct Persisted {
+        i64 ts;
+        u64 ties;
+    };
+
+    auto note_persisted(TypeHandle type, const Table& table) -> void {
+        if (auto mark = table.persisted_mark(); mark.is_some()) {
+            const auto [ts, ties] = mark.unwrap();
+            persisted_[type] = { .ts = ts, .ties = ties };
+        }
+    }
+
+    // The rows of a logged batch not covered by `mark`, which is used up as
+    // tied rows are skipped; copied into `scratch` only if some are skipped.
+    static auto unpersisted(Persisted& mark, const std::byte* data, u32 row_size, u32 count,
+                            std::vector<std::byte>& scratch) -> std::span<const std::byte>
+    {
+        auto covered = [&](const std::byte* row) {
+            i64 ts;
+            std::memcpy(&ts, row, sizeof(ts));
+            if (ts == mark.ts && mark.ties > 0) {
+                --mark.ties;
+                return true;
+            }
+            return ts < mark.ts;
+        };
+
+        u32 i = 0;
+        while (i < count && !covered(data + size_t{i} * row_size)) ++i;
+        if (i == count) return { data, size_t{count} * row_size };
+
+        scratch.assign(data, data + size_t{i} * row_size);
+        for (++i; i < count; ++i) {
+            const std::byte* row = data + size_t{i} * row_size;
+            if (!covered(row)) scratch.insert(scratch.end(), row, row + row_size);
+        }
+        return scratch;
+    }
+
+    // Rewrites the WAL without the rows segments hold. Rows at a mark's own
+    // timestamp are kept, so replay can still tell which of them to skip.
+    auto compact_wal() -> void {
+        std::vector<std::byte> scratch;
+        wal_->compact([&](u32 type, const std::byte* rows, u32 row_size, u32 count) {
+            auto it = (type & (SeriesBit | SymbolBit | BytesBit | SchemaBit | ShardBit)) == 0
+                ? persisted_.find(TypeHandle { type })
+                : persisted_.end();
+            if (it == persisted_.end()) return std::pair { rows, count };
+
+            Persisted older { .ts = it->second.ts, .ties = 0 };
+            const auto kept = unpersisted(older, rows, row_size, count, scratch);
+            return std::pair { kept.data(), static_cast<u32>(kept.size() / row_size) };
+        });
+    }
+
+    // Drops what falls out of `table`'s retention once `rows` are in.
+    static auto retain(Table& table, i64 ttl_ns, const std::byte* rows, size_t count, size_t stride) -> void {
+        i64 newest;
+        std::memcpy(&newest, rows + (count - 1) * stride, sizeof(newest));
+        table.drop_before(newest - ttl_ns);
+    }
+
+    struct Rollup {
+        using LoadFn = f64 (*)(const std::byte*);
+
+        TypeHandle  target;
+        u32         column;
+        u32         offset;
+        Option<u32> valid_offset;   // presence byte of a nullable field
+        i64         bucket_ns;
+        LoadFn      load;
+
+        // The open bucket; count == 0 until the first row arrives.
+        RollupRow  open { .timestamp_ns = 0, .min = 0, .max = 0, .sum = 0, .count = 0 };
+    };
+
+    // Points a rollup at its field in the current rows of the source type.
+    auto place_rollup(Rollup& r, const Schema::Field& f) const -> void {
+        r.offset       = f.offset;
+        r.valid_offset = schema_.meta_of(f.type).nullable ? Option<u32> { Some(f.offset + schema_.value_size(f.type)) }
+                                                          : None;
+    }
+
+    // Folds `rows` into the open bucket of `r`, closing it into `target`
+    // first when a row of a later bucket arrives. Rows are taken in timestamp
+    // order; a row older than the open bucket is folded into it, since closed
+    // buckets are never rewritten.
+    static auto update_rollup(Rollup& r, Table& target, const std::byte* rows, size_t count, size_t stride) -> void {
+        RollupRow& b = r.open;
+        for (size_t i = 0; i < count; ++i) {
+            const std::byte* row = rows + i * stride;
+            if (r.valid_offset.is_some() && row[r.valid_offset.unwrap()] == std::byte { 0 }) continue;
+
+            i64 ts;
+            std::memcpy(&ts, row, sizeof(ts));
+            const f64 v = r.load(row + r.offset);
+
+            if (b.count > 0 && ts >= b.timestamp_ns + r.bucket_ns) {
+                target.insert_row(reinterpret_cast<const std::byte*>(&b));
+                b.count = 0;
+            }
+
+            if (b.count == 0) {
+                b = { .timestamp_ns = ts - ((ts % r.bucket_ns) + r.bucket_ns) % r.bucket_ns,
+                      .min = v, .max = v, .sum = 0, .count = 0 };
+            }
+
+            b.min    = std::min(b.min, v);
+            b.max    = std::max(b.max, v);
+            b.sum   += v;
+            b.count += 1;
+        }
+    }
+
+    // Rows per drain batch, bounding how long a batch holds up visibility.
+    constexpr static size_t IngestBatch = 4096;
+
+    struct IngestQueue {
+        IngestQueue(size_t row_size, size_t capacity) : ring(row_size, capacity) {}
+
+        MpscRing         ring;
+        std::atomic<u64> applied { 0 };
+
+        // The type's rollups with their tables, and its retention, resolved
+        // by start_ingest so the drain thread never reads rollups_,
+        // retention_ or tables_ while the owning thread changes them.
+        std::vector<std::pair<Rollup*, Table*>> rollups;
+        Option<i64>                             ttl_ns;
+
+        std::jthread drainer;   // last, so it stops before the rest goes away
+    };
+
+    auto drain_loop(TypeHandle type, Table& table, IngestQueue& q, std::stop_token stop) -> void {
+        const auto row_size = static_cast<u32>(q.ring.record_size());
+
+        u32 idle = 0;
+        for (;;) {
+            // Checked before draining, so everything enqueued before the stop
+            // request is applied before exiting.
+            const bool stopping = stop.stop_requested();
+
+            const size_t n = q.ring.drain(IngestBatch, [&](const std::byte* rows, size_t count, size_t stride) {
+                if (wal_) wal_->append(type.v_, rows, row_size, count, stride);
+                table.insert_rows(rows, count, stride);
+                for (auto [r, target] : q.rollups) update_rollup(*r, *target, rows, count, stride);
+                if (q.ttl_ns.is_some()) retain(table, q.ttl_ns.unwrap(), rows, count, stride);
+            });
+
+            if (n > 0) {
+                q.applied.store(q.applied.load(std::memory_order_relaxed) + n, std::memory_order_release);
+                idle = 0;
+            } else if (stopping) {
+                return;
+            } else if (++idle < 64) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds { 20 });
+            }
+        }
+    }
+
+    // Makes the symbol dictionary and payload arena of a new struct type.
+    // Every struct gets both, whatever its fields, so add_field never adds
+    // to these maps while other threads look a type up in them.
+    auto add_stores(TypeHandle type) -> TypeHandle {
+        symbols_.emplace(type, std::make_unique<SymbolTable>());
+        blobs_.emplace(type, std::make_unique<BlobArena>());
+        return type;
+    }
+
+    [[nodiscard]] auto symbols_of(TypeHandle type) const -> SymbolTable& {
+        auto it = symbols_.find(type);
+        assert(it != symbols_.end() && "symbols belong to struct types registered with this TSDB");
+        return *it->second;
+    }
+
+    [[nodiscard]] auto blobs_of(TypeHandle type) const -> BlobArena& {
+        auto it = blobs_.find(type);
+        assert(it != blobs_.end() && "payloads belong to struct types registered with this TSDB");
+        return *it->second;
+    }
+
+    // Whether any field of `type`, dropped ones included, is of `kind`.
+    [[nodiscard]] auto has_field_kind(TypeHandle type, Schema::TypeKind kind) const -> bool {
+        return std::ranges::any_of(schema_.meta_of(type).fields,
+                                   [&](auto& f) { return schema_.meta_of(f.type).kind == kind; });
+    }
+
+    [[nodiscard]] auto get_table_ptr(TypeHandle type) const -> const Table* {
+        auto it = tables_.find(type);
+        if (it != tables_.end()) return it->second.get();
+        return nullptr;
+    }
+
+    [[nodiscard]] auto get_or_create_table(TypeHandle type) -> Table& {
+        if (auto it = tables_.find(type); it != tables_.end()) {
+            return *it->second;
+        }
+        return *tables_.emplace(type, make_table(type)).first->second;
+    }
+
+    [[nodiscard]] auto has_shards(TypeHandle type) const -> bool {
+        std::shared_lock lock { shards_mu_ };
+        return shards_.contains(type);
+    }
+
+    [[nodiscard]] auto add_shard(TypeHandle type) -> Table* {
+        auto shard = make_table(type);
+        Table* result = shard.get();
+
+        std::unique_lock lock { shards_mu_ };
+        shards_[type].push_back(std::move(shard));
+        return result;
+    }
+
+    [[nodiscard]] auto make_table(TypeHandle type) const -> std::unique_ptr<Table> {
+        auto&& fields = schema_.meta_of(type).fields;
+
+        auto offsets = fields
+            | std::views::transform([](auto& f) { return f.offset; })
+            | std::ranges::to<std::vector<u32>>();
+
+        auto sizes = fields
+            | std::views::transform([&](auto& f) { return schema_.value_size(f.type); })
+            | std::ranges::to<std::vector<size_t>>();
+
+        auto kinds = fields
+            | std::views::transform([&](auto& f) { return schema_.meta_of(f.type).kind; })
+            | std::ranges::to<std::vector<Schema::TypeKind>>();
+
+        auto nullable = fields
+            | std::views::transform([&](auto& f) { return schema_.meta_of(f.type).nullable; })
+            | std::ranges::to<std::vector<bool>>();
+
+        auto table = std::make_unique<Table>(std::move(sizes), std::vector<size_t>(offsets.begin(), offsets.end()),
+                                             std::move(kinds), schema_.meta_of(type).size, options_,
+                                             std::move(nullable));
+        if (auto it = lateness_.find(type); it != lateness_.end()) table->set_lateness(it->second);
+        return table;
+    }
+
+    Schema       schema_;
+    TableOptions options_;
+    // Boxed so ingest threads can hold a Table& while other types are added.
+    absl::flat_hash_map<TypeHandle, std::unique_ptr<Table>> tables_;
+    std::unique_ptr<wal::Log> wal_;
+
+    // Writer shards; boxed so a writer's Table* survives other writers
+    // adding shards.
+    mutable std::shared_mutex shards_mu_;
+    absl::flat_hash_map<TypeHandle, std::vector<std::unique_ptr<Table>>> shards_;
+
+    // Series tables by id, and ids by type and tags.
+    std::vector<Series> series_;
+    absl::flat_hash_map<std::string, u32> series_ids_;
+    absl::flat_hash_map<TypeHandle, TagIndex> tag_index_;
+
+    // Out-of-order window in ns by type, for tables created later.
+    absl::flat_hash_map<TypeHandle, i64> lateness_;
+
+    // What the segments of each type's shared table hold, so WAL replay and
+    // compaction can leave it out.
+    absl::flat_hash_map<TypeHandle, Persisted> persisted_;
+
+    // Retention TTL in ns by type.
+    absl::flat_hash_map<TypeHandle, i64> retention_;
+
+    // String dictionary and payload arena of each struct type, made at
+    // registration so lookups never race with inserts into these maps.
+    absl::flat_hash_map<TypeHandle, std::unique_ptr<SymbolTable>> symbols_;
+    absl::flat_hash_map<TypeHandle, std::unique_ptr<BlobArena>>   blobs_;
+
+    // Continuous rollups keyed by their source type. The lock covers their
+    // open buckets and tables, which Writer shards fold rows into too.
+    absl::flat_hash_map<TypeHandle, std::vector<Rollup>> rollups_;
+    std::mutex                                           rollups_mu_;
+
+    // Declared last so drain threads stop before the tables go away.
+    absl::flat_hash_map<TypeHandle, std::unique_ptr<IngestQueue>> queues_;
 };
@@ -0,0 +1,375 @@
+#pragma once
+
+#include "result.hh"
+#include "utils.hh"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+enum class WalError : u8 {
+    Open,
+    Read,
+    Write,
+    BadMagic,
+    Apply,      // an intact record the caller could not apply; the log is left as is
+};
+
+// Write-ahead log of raw row batches.
+//
+//   magic | Record...    Record = RecordHeader | rows * row_size bytes
+//
+// Each insert call appends one record. Records are buffered in memory and
+// written by whichever writer flushes next, so concurrent writers waiting on
+// the same fsync share it (group commit). Replay stops at the first torn or
+// corrupt record, which is where the log is truncated before appending again.
+namespace wal {
+
+constexpr static char   Magic[8]   = { 'R', 'S', 'T', 'D', 'W', 'A', 'L', '1' };
+constexpr static size_t FlushBytes = 1 << 20;
+
+enum class Fsync : u8 {
+    PerBatch,   // every insert returns only once its record is on disk
+    Interval,   // a background thread syncs every `interval`
+    None,       // written when the buffer fills or the log closes; never synced
+};
+
+struct Options {
+    Fsync                     fsync    = Fsync::PerBatch;
+    std::chrono::milliseconds interval { 10 };
+};
+
+struct RecordHeader {
+    u32 type;
+    u32 row_size;
+    u32 rows;
+    u32 checksum;
+};
+
+// FNV-1a over 8-byte words, folded to 32 bits; enough to spot a torn tail.
+inline auto checksum(const RecordHeader& h, std::span<const std::byte> payload) -> u32 {
+    constexpr u64 prime = 0x100000001b3;
+
+    u64 x = 0xcbf29ce484222325;
+    x = (x ^ h.type) * prime;
+    x = (x ^ h.row_size) * prime;
+    x = (x ^ h.rows) * prime;
+
+    size_t i = 0;
+    for (; i + 8 <= payload.size(); i += 8) {
+        u64 w;
+        std::memcpy(&w, payload.data() + i, 8);
+        x = (x ^ w) * prime;
+    }
+    for (; i < payload.size(); ++i) {
+        x = (x ^ static_cast<u64>(payload[i])) * prime;
+    }
+    return static_cast<u32>(x ^ (x >> 32));
+}
+
+// Appends the record of `count` rows of `row_size` bytes, read `stride` bytes
+// apart, to `buf`; returns its size.
+inline auto encode(std::vector<std::byte>& buf, u32 type, const std::byte* rows, u32 row_size, size_t count,
+                   size_t stride) -> size_t
+{
+    RecordHeader h { .type = type, .row_size = row_size, .rows = static_cast<u32>(count), .checksum = 0 };
+
+    const size_t at = buf.size();
+    buf.resize(at + sizeof(h) + count * row_size);
+    std::byte* payload = buf.data() + at + sizeof(h);
+
+    if (stride == row_size) {
+        std::memcpy(payload, rows, count * row_size);
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            std::memcpy(payload + i * row_size, rows + i * stride, row_size);
+        }
+    }
+
+    h.checksum = checksum(h, { payload, count * row_size });
+    std::memcpy(buf.data() + at, &h, sizeof(h));
+    return sizeof(h) + count * row_size;
+}
+
+inline auto write_all(int fd, std::span<const std::byte> bytes) -> bool {
+    for (size_t done = 0; done < bytes.size();) {
+        const ssize_t n = ::write(fd, bytes.data() + done, bytes.size() - done);
+        if (n <= 0) return false;
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Calls apply(type, rows, row_size, count) for each intact record of the log
+// at `path`. Returns the byte length of the prefix before the first torn or
+// corrupt record, the only part safe to append after; a missing or empty file
+// is an empty log. Fails with WalError::Apply as soon as apply returns false,
+// since the records after it are still valid and must not be cut off.
+template <typename F>
+auto replay(const std::string& path, F&& apply) -> Result<u64, WalError> {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) return Ok(u64{0});
+        return Err(WalError::Open);
+    }
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return Err(WalError::Read);
+    }
+
+    const auto size = static_cast<size_t>(st.st_size);
+    if (size == 0) {
+        ::close(fd);
+        return Ok(u64{0});
+    }
+
+    void* p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) return Err(WalError::Read);
+
+    const auto* base = static_cast<const std::byte*>(p);
+    if (size < sizeof(Magic) || std::memcmp(base, Magic, sizeof(Magic)) != 0) {
+        ::munmap(p, size);
+        return Err(WalError::BadMagic);
+    }
+
+    ::madvise(p, size, MADV_SEQUENTIAL);
+
+    size_t off = sizeof(Magic);
+    while (size - off >= sizeof(RecordHeader)) {
+        RecordHeader h;
+        std::memcpy(&h, base + off, sizeof(h));
+
+        const u64 bytes = u64{h.rows} * h.row_size;
+        if (bytes > size - off - sizeof(h)) break;
+
+        const std::span payload { base + off + sizeof(h), static_cast<size_t>(bytes) };
+        if (checksum(h, payload) != h.checksum) break;
+        if (!apply(h.type, payload.data(), h.row_size, h.rows)) {
+            ::munmap(p, size);
+            return Err(WalError::Apply);
+        }
+
+        off += sizeof(h) + bytes;
+    }
+
+    ::munmap(p, size);
+    return Ok(static_cast<u64>(off));
+}
+
+class Log {
+public:
+    Log(const Log&) = delete;
+    Log& operator=(const Log&) = delete;
+
+    // Opens the log at `path` for appending after its first `valid_bytes`
+    // (as returned by replay), dropping anything past them.
+    [[nodiscard]] static auto open(const std::string& path, u64 valid_bytes, Options options)
+        -> Result<std::unique_ptr<Log>, WalError>
+    {
+        const int fd = ::open(path.c_str(), O_CREAT | O_WRONLY | O_CLOEXEC, 0644);
+        if (fd < 0) return Err(WalError::Open);
+
+        if (::ftruncate(fd, static_cast<off_t>(valid_bytes)) != 0 ||
+            ::lseek(fd, static_cast<off_t>(valid_bytes), SEEK_SET) < 0)
+        {
+            ::close(fd);
+            return Err(WalError::Write);
+        }
+
+        auto log = std::unique_ptr<Log>(new Log(fd, path, options));
+        if (valid_bytes == 0) {
+            const auto* magic = reinterpret_cast<const std::byte*>(Magic);
+            log->buf_.assign(magic, magic + sizeof(Magic));
+            log->appended_ = sizeof(Magic);
+            log->flush(true);
+        }
+
+        if (options.fsync == Fsync::Interval) {
+            log->syncer_ = std::jthread([l = log.get()](std::stop_token stop) { l->sync_loop(stop); });
+        }
+        return Ok(std::move(log));
+    }
+
+    ~Log() {
+        if (syncer_.joinable()) {
+            syncer_.request_stop();
+            syncer_.join();
+        }
+        try {
+            flush(true);
+        } catch (const std::system_error&) {
+            // Nothing left to report to; the tail is lost like after a crash.
+        }
+        ::close(fd_);
+    }
+
+    // Logs `count` rows of `row_size` bytes read `stride` bytes apart, and
+    // returns once the record is as durable as the fsync policy promises.
+    // Throws std::system_error if the log cannot be written.
+    auto append(u32 type, const std::byte* rows, u32 row_size, size_t count, size_t stride) -> void {
+        std::unique_lock lock { mu_ };
+        if (error_ != 0) throw std::system_error(error_, std::generic_category(), "wal write");
+
+        appended_ += encode(buf_, type, rows, row_size, count, stride);
+        const u64 lsn = appended_;
+
+        if (options_.fsync == Fsync::PerBatch) {
+            // Whoever finds no flush in progress writes everything buffered so
+            // far, including records of writers still waiting behind it.
+            while (durable_ < lsn) {
+                if (flushing_) cv_.wait(lock);
+                else           flush_locked(lock, true);
+            }
+        } else if (buf_.size() >= FlushBytes) {
+            flush_locked(lock, false);
+        }
+    }
+
+    // Writes everything appended so far, and syncs it if `sync`.
+    auto flush(bool sync) -> void {
+        std::unique_lock lock { mu_ };
+        flush_locked(lock, sync);
+    }
+
+    [[nodiscard]] auto fsync_count() const -> u64 {
+        std::lock_guard lock { mu_ };
+        return fsyncs_;
+    }
+
+    // Rewrites the log with only the rows keep(type, rows, row_size, count)
+    // returns of each record, as a (rows, count) pair; records it keeps no
+    // rows of are dropped. The new log replaces the old one by rename, so a
+    // crash leaves one or the other; appends wait until it is done. Throws
+    // std::system_error if it cannot be written, leaving the old log.
+    template <typename F>
+    auto compact(F&& keep) -> void {
+        std::unique_lock lock { mu_ };
+        flush_locked(lock, true);
+
+        const std::string tmp = path_ + ".compact";
+        const int fd = ::open(tmp.c_str(), O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC, 0644);
+        if (fd < 0) throw std::system_error(errno, std::generic_category(), "wal compact");
+
+        const auto* magic = reinterpret_cast<const std::byte*>(Magic);
+        std::vector<std::byte> out(magic, magic + sizeof(Magic));
+        bool ok = true;
+
+        auto replayed = replay(path_, [&](u32 type, const std::byte* rows, u32 row_size, u32 count) {
+            const auto [kept, n] = keep(type, rows, row_size, count);
+            if (n > 0) (void)encode(out, type, kept, row_size, n, row_size);
+            if (out.size() >= FlushBytes) {
+                ok  = write_all(fd, out);
+                out.clear();
+            }
+            return ok;
+        });
+        ok = ok && replayed.is_ok() && write_all(fd, out) && ::fdatasync(fd) == 0;
+        int err = errno;
+        ::close(fd);
+
+        if (ok && ::rename(tmp.c_str(), path_.c_str()) != 0) {
+            ok  = false;
+            err = errno;
+        }
+        if (!ok) {
+            ::unlink(tmp.c_str());
+            throw std::system_error(err, std::generic_category(), "wal compact");
+        }
+
+        // The rename is durable once the directory is synced.
+        const auto dir = std::filesystem::path(path_).parent_path();
+        if (const int d = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC); d >= 0) {
+            (void)::fsync(d);
+            ::close(d);
+        }
+
+        ::close(fd_);
+        fd_ = ::open(path_.c_str(), O_WRONLY | O_CLOEXEC);
+        if (fd_ < 0 || ::lseek(fd_, 0, SEEK_END) < 0) {
+            error_ = errno;
+            throw std::system_error(error_, std::generic_category(), "wal compact");
+        }
+    }
+
+private:
+    Log(int fd, std::string path, Options options) : fd_(fd), path_(std::move(path)), options_(options) {}
+
+    auto flush_locked(std::unique_lock<std::mutex>& lock, bool sync) -> void {
+        // Writes must reach the file in append order.
+        cv_.wait(lock, [&] { return !flushing_; });
+        if (buf_.empty() && (!sync || durable_ == appended_)) return;
+
+        flushing_ = true;
+        std::swap(buf_, spare_);
+        const u64 end = appended_;
+        lock.unlock();
+
+        bool ok = write_all(fd_, spare_);
+        if (ok && sync) ok = ::fdatasync(fd_) == 0;
+        const int err = errno;
+        spare_.clear();
+
+        lock.lock();
+        flushing_ = false;
+        if (sync && ok) {
+            durable_ = end;
+            ++fsyncs_;
+        }
+        if (!ok) error_ = err;
+        cv_.notify_all();
+
+        if (!ok) throw std::system_error(err, std::generic_category(), "wal write");
+    }
+
+    auto sync_loop(std::stop_token stop) -> void {
+        std::unique_lock lock { mu_ };
+        while (!stop.stop_requested()) {
+            tick_.wait_for(lock, stop, options_.interval, [] { return false; });
+            if (durable_ == appended_ || error_ != 0) continue;
+
+            try {
+                flush_locked(lock, true);
+            } catch (const std::system_error&) {
+                // Recorded in error_; the next append reports it.
+            }
+        }
+    }
+
+    int         fd_;
+    std::string path_;
+    Options     options_;
+
+    mutable std::mutex      mu_;
+    std::condition_variable cv_;
+    std::condition_variable_any tick_;
+
+    std::vector<std::byte> buf_;
+    std::vector<std::byte> spare_;
+    bool                   flushing_ = false;
+    u64                    appended_ = 0;   // bytes appended since open
+    u64                    durable_  = 0;   // prefix of those known synced
+    u64                    fsyncs_   = 0;
+    int                    error_    = 0;
+
+    std::jthread syncer_;
+};
+
+} // namespace wal
@@ -0,0 +1,84 @@
+#include "tsdb.hh"
+
+#include <limits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+struct Point { i64 timestamp_ns; f64 value; };
+
+constexpr i64 Min = std::numeric_limits<i64>::min();
+constexpr i64 Max = std::numeric_limits<i64>::max();
+
+auto insert_points(TSDB& db, const std::vector<i64>& timestamps) -> FieldHandle<f64> {
+    const auto type = db.register_struct("Point", { { "value", TSDB::F64 } });
+    std::vector<Point> rows;
+    for (const i64 ts : timestamps) rows.push_back({ ts, static_cast<f64>(rows.size()) });
+    db.insert_batch(std::span<const Point>(rows), type);
+    return db.field<f64>(type, "value").unwrap();
+}
+
+TEST(Aggregate, SummarizesWholeRange) {
+    TSDB db;
+    std::vector<i64> ts;
+    for (i64 i = 0; i < static_cast<i64>(ChunkRows) + 100; ++i) ts.push_back(i);
+    const auto value = insert_points(db, ts);
+
+    const auto s = db.aggregate(value, 10, 20);
+    EXPECT_EQ(s.count, 10u);
+    EXPECT_EQ(s.sum, 145.0);
+    EXPECT_EQ(s.min, 10.0);
+    EXPECT_EQ(s.max, 19.0);
+    EXPECT_EQ(db.aggregate(value, 0, Max).count, ts.size());
+}
+
+TEST(Aggregate, BucketsReduceEveryOpAndSkipEmptyBuckets) {
+    TSDB db;
+    std::vector<i64> ts;
+    for (i64 t = 0; t < 300; t += 10) ts.push_back(t);
+    for (i64 t = 500; t < 600; t += 10) ts.push_back(t);
+    const auto value = insert_points(db, ts);
+
+    const auto b = db.aggregate(value, 0, 1000, 100,
+                                { AggOp::Min, AggOp::Max, AggOp::Sum, AggOp::Avg, AggOp::Count });
+    EXPECT_EQ(b.bucket_start, (std::vector<i64> { 0, 100, 200, 500 }));
+    EXPECT_EQ(b.count, (std::vector<u64> { 10, 10, 10, 10 }));
+    EXPECT_EQ(b.min, (std::vector<f64> { 0, 10, 20, 30 }));
+    EXPECT_EQ(b.max, (std::vector<f64> { 9, 19, 29, 39 }));
+    EXPECT_EQ(b.sum[1], 145.0);
+    EXPECT_EQ(b.avg[3], 34.5);
+
+    // Only what was asked for is filled in.
+    const auto counts = db.aggregate(value, 0, 1000, 100, { AggOp::Count });
+    EXPECT_TRUE(counts.min.empty() && counts.sum.empty() && counts.avg.empty());
+    EXPECT_EQ(counts.size(), 4u);
+}
+
+TEST(Aggregate, BucketsAlignToNegativeStart) {
+    TSDB db;
+    const auto value = insert_points(db, { -1000, -951, -950, -1, 0, 49 });
+
+    const auto b = db.aggregate(value, -1050, 100, 100, { AggOp::Count });
+    EXPECT_EQ(b.bucket_start, (std::vector<i64> { -1050, -950, -50 }));
+    EXPECT_EQ(b.count, (std::vector<u64> { 2, 1, 3 }));
+}
+
+TEST(Aggregate, BucketsOverExtremeBounds) {
+    TSDB db;
+    const auto value = insert_points(db, { Min, Min + 1, -5, 0, 7, Max - 1 });
+
+    const auto whole = db.aggregate(value, Min, Max, Max, { AggOp::Count });
+    EXPECT_EQ(whole.bucket_start, (std::vector<i64> { Min, -1, Max - 1 }));
+    EXPECT_EQ(whole.count, (std::vector<u64> { 3, 2, 1 }));
+
+    // Buckets of 1000 from Min put -5, 0 and 7 in [-808, 192), and Max - 1
+    // in the one starting 2^64 - 2 - (2^64 - 2) % 1000 past Min.
+    const auto fine = db.aggregate(value, Min, Max, 1000, { AggOp::Count, AggOp::Sum });
+    EXPECT_EQ(fine.bucket_start, (std::vector<i64> { Min, -808, Max - 615 }));
+    EXPECT_EQ(fine.count, (std::vector<u64> { 2, 3, 1 }));
+    EXPECT_EQ(fine.sum[1], 9.0);
+}
+
+} // namespace
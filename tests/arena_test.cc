@@ -0,0 +1,79 @@
+#include "huge_page_allocator.hh"
+#include "tsdb.hh"
+
+#include <cstdint>
+#include <new>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using Arena = HugePageArena<>;
+
+TEST(HugePageArena, MapsRegionsOnDemand) {
+    Arena arena;
+    EXPECT_EQ(arena.region_count(), 0u);
+    EXPECT_EQ(arena.reserved(), 0u);
+
+    // Three blocks fit a region; the fourth maps another.
+    constexpr size_t Block = Arena::region_size / 3 / 64 * 64;
+    std::vector<void*> blocks;
+    for (int i = 0; i < 4; ++i) blocks.push_back(arena.allocate(Block));
+
+    EXPECT_EQ(arena.region_count(), 2u);
+    EXPECT_EQ(arena.reserved(), 2 * Arena::region_size);
+    for (void* p : blocks) {
+        ASSERT_NE(p, nullptr);
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(p) % 64, 0u);
+    }
+    EXPECT_EQ(static_cast<std::byte*>(blocks[1]) - static_cast<std::byte*>(blocks[0]), static_cast<std::ptrdiff_t>(Block));
+}
+
+TEST(HugePageArena, ReusesReleasedBlocksOfTheSameSize) {
+    Arena arena;
+    void* a = arena.allocate(4096);
+    void* b = arena.allocate(8192);
+
+    arena.release(a, 4096);
+    arena.release(b, 8192);
+    EXPECT_EQ(arena.free_bytes(), 4096u + 8192u);
+
+    EXPECT_EQ(arena.allocate(8192), b);
+    EXPECT_EQ(arena.allocate(4096), a);
+    EXPECT_EQ(arena.free_bytes(), 0u);
+    EXPECT_EQ(arena.region_count(), 1u);
+}
+
+TEST(HugePageArena, RejectsBlocksLargerThanARegion) {
+    Arena arena;
+    EXPECT_THROW((void)arena.allocate(Arena::region_size + 1), std::bad_alloc);
+}
+
+TEST(HugePageArena, BacksTableChunks) {
+    struct Point { i64 timestamp_ns; f64 value; };
+
+    TSDB db { 1, TableOptions { .memory = TableMemory::HugePages } };
+    const auto type = db.register_struct("Point", { { "value", TSDB::F64 } });
+
+    std::vector<Point> rows(4 * ChunkRows);
+    for (size_t i = 0; i < rows.size(); ++i) rows[i] = { static_cast<i64>(i), static_cast<f64>(i) };
+    db.insert_batch(std::span<const Point>(rows), type);
+
+    const ChunkArena* arena = db.table(type)->arena();
+    ASSERT_NE(arena, nullptr);
+    // Four chunks of two 8-byte columns, 512KB each, fill two 2MB regions;
+    // the blocks the first chunks grew through take part of a third.
+    EXPECT_EQ(arena->reserved(), 3 * ChunkArena::region_size);
+
+    const auto agg = db.aggregate(db.field<f64>(type, "value").unwrap(), 0, static_cast<i64>(rows.size()));
+    EXPECT_EQ(agg.count, rows.size());
+    EXPECT_EQ(agg.max, static_cast<f64>(rows.size() - 1));
+
+    TSDB heap;
+    const auto plain = heap.register_struct("Point", { { "value", TSDB::F64 } });
+    heap.insert_batch(std::span<const Point>(rows), plain);
+    EXPECT_EQ(heap.table(plain)->arena(), nullptr);
+}
+
+} // namespace
@@ -0,0 +1,73 @@
+#include "blob_arena.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+// Payload i is (i % 700) + 1 bytes of value i % 251.
+auto payload(u32 i) -> std::vector<std::byte> {
+    return std::vector<std::byte>(i % 700 + 1, static_cast<std::byte>(i % 251));
+}
+
+auto holds(std::span<const std::byte> got, u32 i) -> bool {
+    const auto want = payload(i);
+    return std::ranges::equal(got, want);
+}
+
+TEST(BlobArena, LargePayloadsGetWholeSlots) {
+    BlobArena arena;
+    const auto small = arena.append(payload(1));
+    const std::vector<std::byte> big(BlobArena::RegionSize + 1, std::byte { 7 });
+    const auto large = arena.append(big);
+    const auto after = arena.append(payload(2));
+
+    EXPECT_EQ(large.offset, BlobArena::RegionSize);
+    EXPECT_EQ(after.offset, 3 * BlobArena::RegionSize);
+    EXPECT_TRUE(holds(arena.get(small), 1));
+    EXPECT_TRUE(std::ranges::equal(arena.get(large), big));
+    EXPECT_TRUE(holds(arena.get(after), 2));
+}
+
+TEST(BlobArena, ConcurrentAppendsAndReads) {
+    constexpr u32 Writers = 4;
+    constexpr u32 PerWriter = 20'000;
+
+    BlobArena arena;
+    std::vector<std::vector<BlobRef>> refs(Writers, std::vector<BlobRef>(PerWriter));
+    std::vector<std::atomic<u32>>     published(Writers);
+    std::atomic<bool>                 bad { false };
+
+    std::vector<std::thread> threads;
+    for (u32 w = 0; w < Writers; ++w) {
+        threads.emplace_back([&, w] {
+            for (u32 i = 0; i < PerWriter; ++i) {
+                refs[w][i] = arena.append(payload(w * PerWriter + i));
+                published[w].store(i + 1, std::memory_order_release);
+            }
+        });
+    }
+    // Reads what the writers have published so far while they keep appending.
+    threads.emplace_back([&] {
+        for (u32 round = 0; round < 50; ++round) {
+            for (u32 w = 0; w < Writers; ++w) {
+                const u32 n = published[w].load(std::memory_order_acquire);
+                for (u32 i = 0; i < n; i += 97) {
+                    if (!holds(arena.get(refs[w][i]), w * PerWriter + i)) bad = true;
+                }
+            }
+        }
+    });
+    for (auto& t : threads) t.join();
+
+    EXPECT_FALSE(bad);
+    for (u32 w = 0; w < Writers; ++w) {
+        for (u32 i = 0; i < PerWriter; ++i) ASSERT_TRUE(holds(arena.get(refs[w][i]), w * PerWriter + i));
+    }
+}
+
+} // namespace
@@ -0,0 +1,90 @@
+#include "tsdb.hh"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+struct Point { i64 timestamp_ns; f64 value; };
+
+auto push_values(Column& column, size_t count) -> void {
+    for (size_t i = 0; i < count; ++i) column.push_value(static_cast<i64>(column.row_count()));
+}
+
+TEST(Chunk, FirstChunkDoublesUpToChunkRows) {
+    Column column { sizeof(i64), Schema::TypeKind::I64 };
+
+    push_values(column, 1);
+    EXPECT_EQ(column.memory_bytes(), FirstChunkRows * sizeof(i64));
+
+    push_values(column, FirstChunkRows);
+    EXPECT_EQ(column.memory_bytes(), 2 * FirstChunkRows * sizeof(i64));
+
+    push_values(column, ChunkRows - column.row_count());
+    EXPECT_EQ(column.chunk_count(), 1u);
+    EXPECT_EQ(column.memory_bytes(), ChunkRows * sizeof(i64));
+
+    push_values(column, 1);
+    EXPECT_EQ(column.chunk_count(), 2u);
+    EXPECT_EQ(column.memory_bytes(), 2 * ChunkRows * sizeof(i64));
+}
+
+TEST(Chunk, FullChunksNeverMove) {
+    Column column { sizeof(i64), Schema::TypeKind::I64 };
+    Column::Cursor cur;
+
+    push_values(column, ChunkRows);
+    const std::byte* first = column.at(5, cur);
+    const std::byte* last  = column.at(ChunkRows - 1, cur);
+
+    push_values(column, 3 * ChunkRows);
+    EXPECT_EQ(column.at(5, cur), first);
+    EXPECT_EQ(column.at(ChunkRows - 1, cur), last);
+    EXPECT_EQ(column.value<i64>(5, cur), 5);
+    EXPECT_EQ(column.value<i64>(4 * ChunkRows - 1, cur), static_cast<i64>(4 * ChunkRows - 1));
+}
+
+TEST(Chunk, StridedAppendsSplitAtChunkBoundaries) {
+    std::vector<Point> rows(2 * ChunkRows + 7);
+    for (size_t i = 0; i < rows.size(); ++i) rows[i] = { static_cast<i64>(i), static_cast<f64>(i) / 2 };
+
+    Column column { sizeof(f64), Schema::TypeKind::F64 };
+    column.push_strided(reinterpret_cast<const std::byte*>(&rows[0].value), rows.size(), sizeof(Point));
+
+    Column::Cursor cur;
+    ASSERT_EQ(column.chunk_count(), 3u);
+    EXPECT_EQ(column.chunk_as<f64>(0, cur).size(), ChunkRows);
+    EXPECT_EQ(column.chunk_as<f64>(2, cur).size(), 7u);
+    for (const size_t row : { size_t { 0 }, ChunkRows - 1, ChunkRows, 2 * ChunkRows - 1, 2 * ChunkRows, rows.size() - 1 }) {
+        EXPECT_EQ(column.value<f64>(row, cur), rows[row].value) << row;
+    }
+}
+
+// Rows read back the same whether they went in one at a time or in a batch
+// that crosses chunk boundaries.
+TEST(Chunk, TableRowsReadBackAcrossChunks) {
+    TSDB db;
+    const auto batched = db.register_struct("Batched", { { "value", TSDB::F64 } });
+    const auto single  = db.register_struct("Single", { { "value", TSDB::F64 } });
+
+    std::vector<Point> rows(3 * ChunkRows + 1);
+    for (size_t i = 0; i < rows.size(); ++i) rows[i] = { static_cast<i64>(i), static_cast<f64>(i % 1000) };
+    db.insert_batch(std::span<const Point>(rows), batched);
+    for (const Point& p : rows) db.insert(p, single);
+
+    for (const auto type : { batched, single }) {
+        const Table& t = *db.table(type);
+        ASSERT_EQ(t.row_count(), rows.size());
+        for (const size_t row : { size_t { 0 }, ChunkRows - 1, ChunkRows, 3 * ChunkRows }) {
+            Point p;
+            t.read_row(row, reinterpret_cast<std::byte*>(&p));
+            EXPECT_EQ(p.timestamp_ns, rows[row].timestamp_ns);
+            EXPECT_EQ(p.value, rows[row].value);
+        }
+    }
+    EXPECT_EQ(db.query_first<Point>(batched).timestamp_ns, 0);
+    EXPECT_EQ(db.query_last<Point>(single).timestamp_ns, static_cast<i64>(3 * ChunkRows));
+}
+
+} // namespace
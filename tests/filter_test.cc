@@ -0,0 +1,150 @@
+#include "tsdb.hh"
+
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+// Reflected types must live at namespace scope.
+struct Row {
+    i64           timestamp_ns;
+    f64           x;
+    u32           code;
+    Nullable<f64> h;
+    i32           level;
+};
+TSDB_REFLECT(Row, x, code, h, level)
+
+namespace {
+
+struct Case {
+    const char*                     name;
+    std::function<Filter()>         filter;
+    std::function<bool(const Row&)> matches;
+};
+
+class FilterTest : public ::testing::TestWithParam<bool> {
+protected:
+    FilterTest()
+        : db_ { 4, TableOptions { .compress_sealed = GetParam() } }
+        , type_ { db_.register_type<Row>().unwrap().type() } {
+
+        std::mt19937_64 rng { 7 };
+        rows_.resize(3 * ChunkRows + 12345);
+        for (size_t i = 0; i < rows_.size(); ++i) {
+            rows_[i] = { static_cast<i64>(i), static_cast<f64>(i % 70000) * 0.5, static_cast<u32>(rng() % 10),
+                         rng() % 4 ? Nullable<f64> { static_cast<f64>(rng() % 100) } : Nullable<f64> { None },
+                         static_cast<i32>(i / 1000) - 50 };
+        }
+        rows_[777].x = std::numeric_limits<f64>::quiet_NaN();
+        db_.insert_batch(std::span<const Row>(rows_), type_);
+    }
+
+    TSDB             db_;
+    TypeHandle       type_;
+    std::vector<Row> rows_;
+};
+
+TEST_P(FilterTest, MatchesRowAtATimeReference) {
+    const auto x     = db_.field<f64>(type_, "x").unwrap();
+    const auto code  = db_.field<u32>(type_, "code").unwrap();
+    const auto h     = db_.field<f64>(type_, "h").unwrap();
+    const auto level = db_.field<i32>(type_, "level").unwrap();
+
+    const Case cases[] = {
+        { "x > 1000", [&] { return where(x, CmpOp::Gt, 1000.0); }, [](const Row& r) { return r.x > 1000.0; } },
+        { "x != 5", [&] { return where(x, CmpOp::Ne, 5.0); }, [](const Row& r) { return r.x != 5.0; } },
+        { "code == 3", [&] { return where(code, CmpOp::Eq, 3u); }, [](const Row& r) { return r.code == 3; } },
+        { "h <= 50", [&] { return where(h, CmpOp::Le, 50.0); }, [](const Row& r) { return r.h.valid && r.h.value <= 50.0; } },
+        { "level in [10, 20)", [&] { return where(level, CmpOp::Ge, 10) && where(level, CmpOp::Lt, 20); },
+          [](const Row& r) { return r.level >= 10 && r.level < 20; } },
+        { "level == -3 || (code == 1 && h > 90)",
+          [&] { return where(level, CmpOp::Eq, -3) || (where(code, CmpOp::Eq, 1u) && where(h, CmpOp::Gt, 90.0)); },
+          [](const Row& r) { return r.level == -3 || (r.code == 1 && r.h.valid && r.h.value > 90.0); } },
+    };
+    const std::pair<i64, i64> ranges[] = {
+        { 0, static_cast<i64>(rows_.size()) }, { 5, 4100 }, { 63, 65 }, { ChunkRows - 3, 2 * ChunkRows + 70 }, { 100, 100 },
+    };
+
+    for (const Case& c : cases) {
+        for (auto [first, last] : ranges) {
+            SCOPED_TRACE(::testing::Message() << c.name << " [" << first << ", " << last << ")");
+
+            std::vector<size_t>   want;
+            kernels::Summary<f64> want_h;
+            for (size_t i = static_cast<size_t>(first); i < static_cast<size_t>(last); ++i) {
+                if (!c.matches(rows_[i])) continue;
+                want.push_back(i);
+                if (!rows_[i].h.valid) continue;
+                want_h.sum += rows_[i].h.value;
+                want_h.min = std::min(want_h.min, rows_[i].h.value);
+                want_h.max = std::max(want_h.max, rows_[i].h.value);
+                ++want_h.count;
+            }
+
+            const Filter f   = c.filter();
+            const auto   sel = db_.filter(f, first, last);
+            EXPECT_EQ(sel.to_vector(), want);
+            EXPECT_EQ(sel.count(), want.size());
+
+            const auto selected = db_.select<Row>(f, first, last);
+            ASSERT_EQ(selected.size(), want.size());
+            for (size_t i = 0; i < selected.size(); ++i) EXPECT_EQ(selected[i].timestamp_ns, rows_[want[i]].timestamp_ns);
+
+            const auto agg = db_.aggregate(h, f, first, last);
+            EXPECT_EQ(agg.count, want_h.count);
+            EXPECT_EQ(agg.sum, want_h.sum);
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Compression, FilterTest, ::testing::Bool());
+
+TEST(Kernels, CompareMatchesScalarOnEveryIsa) {
+    std::vector<i32> values(1000);
+    for (size_t i = 0; i < values.size(); ++i) values[i] = static_cast<i32>(i % 37) - 18;
+
+    for (auto isa : { kernels::Isa::Scalar, kernels::Isa::Avx2, kernels::Isa::Avx512 }) {
+        std::vector<u64> got((values.size() + 63) / 64);
+        kernels::compare(std::span<const i32>(values), CmpOp::Le, 3, got.data(), isa);
+        for (size_t i = 0; i < values.size(); ++i) {
+            EXPECT_EQ((got[i / 64] >> (i % 64)) & 1, values[i] <= 3 ? 1u : 0u) << i;
+        }
+    }
+}
+
+template <typename T>
+auto expect_nans_skipped() -> void {
+    const T nan = std::numeric_limits<T>::quiet_NaN();
+
+    // Scattered NaNs, then a run of them to the end of the vector body that
+    // would overwrite every lane if one got into an accumulator, then a tail.
+    std::vector<T> values(259);
+    for (size_t i = 0; i < values.size(); ++i) values[i] = i < 128 ? static_cast<T>(i % 50) - 20 : nan;
+    for (size_t i : { 0, 1, 17, 64 }) values[i] = nan;
+    for (size_t i = 256; i < values.size(); ++i) values[i] = 5;
+    std::vector<T> none(100, nan);
+    std::vector<u64> valid(5, ~u64{0});
+
+    for (auto isa : { kernels::Isa::Scalar, kernels::Isa::Avx2, kernels::Isa::Avx512 }) {
+        EXPECT_EQ(kernels::min(std::span<const T>(values), isa), -20) << int(isa);
+        EXPECT_EQ(kernels::max(std::span<const T>(values), isa), 29) << int(isa);
+        EXPECT_EQ(kernels::min(std::span<const T>(none), isa), std::numeric_limits<T>::max()) << int(isa);
+        EXPECT_EQ(kernels::max(std::span<const T>(none), isa), std::numeric_limits<T>::lowest()) << int(isa);
+
+        const auto s = kernels::summarize_masked(std::span<const T>(values), valid.data(), 0, isa);
+        EXPECT_EQ(s.min, -20) << int(isa);
+        EXPECT_EQ(s.max, 29) << int(isa);
+        EXPECT_TRUE(std::isnan(s.sum)) << int(isa);
+    }
+}
+
+TEST(Kernels, MinMaxSkipNansOnEveryIsa) {
+    expect_nans_skipped<f64>();
+    expect_nans_skipped<f32>();
+}
+
+} // namespace
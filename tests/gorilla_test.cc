@@ -0,0 +1,167 @@
+#include "gorilla.hh"
+#include "tsdb.hh"
+
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+TEST(Gorilla, TimestampsRoundTrip) {
+    std::mt19937_64 rng { 1 };
+    for (size_t n : { 0, 1, 2, 3, 1000, 65536 }) {
+        std::vector<i64> ts(n);
+        i64 t = -5'000'000'000;
+        for (auto& v : ts) v = t += 1'000'000 + static_cast<i64>(rng() % 3 == 0 ? rng() % 100'000 : 0);
+
+        const auto e = gorilla::encode_timestamps(ts);
+        std::vector<i64> out(n);
+        gorilla::decode_timestamps(e, out);
+        EXPECT_EQ(out, ts) << n;
+    }
+}
+
+TEST(Gorilla, XorRoundTripsBitPatterns) {
+    std::vector<f64> v { 0.0, -0.0, 1.5, 1.5, 1.25, std::numeric_limits<f64>::infinity(),
+                         std::numeric_limits<f64>::denorm_min(), -1e300, 20.01, 20.02 };
+    for (int i = 0; i < 5000; ++i) v.push_back(std::round(20.0 + std::sin(i * 0.01) * 100) / 100);
+    v.push_back(std::numeric_limits<f64>::quiet_NaN());
+
+    const auto e = gorilla::encode_xor(std::span<const f64>(v));
+    std::vector<f64> out(v.size());
+    gorilla::decode_xor(e, std::span(out));
+    EXPECT_EQ(std::memcmp(out.data(), v.data(), v.size() * sizeof(f64)), 0);
+
+    std::vector<f32> f(v.begin(), v.end());
+    const auto ef = gorilla::encode_xor(std::span<const f32>(f));
+    std::vector<f32> outf(f.size());
+    gorilla::decode_xor(ef, std::span(outf));
+    EXPECT_EQ(std::memcmp(outf.data(), f.data(), f.size() * sizeof(f32)), 0);
+}
+
+template <typename T>
+auto bitpack_round_trip(std::vector<T> v) -> void {
+    const auto e = gorilla::encode_bitpack(std::span<const T>(v));
+    std::vector<T> out(v.size());
+    gorilla::decode_bitpack(e, std::span(out));
+    EXPECT_EQ(out, v);
+}
+
+TEST(Gorilla, BitPackRoundTripsExtremes) {
+    bitpack_round_trip<i32>({ 200, 200, 500, std::numeric_limits<i32>::min(), std::numeric_limits<i32>::max() });
+    bitpack_round_trip<u32>({ 7, 7, 7, 7 });
+    bitpack_round_trip<i64>({ std::numeric_limits<i64>::min(), 0, std::numeric_limits<i64>::max() });
+    bitpack_round_trip<u8>({ 0, 255, 3 });
+}
+
+// Sealed chunks are encoded and read back through the column's decoder.
+TEST(Gorilla, CompressedTableReadsBack) {
+    struct Row { i64 timestamp_ns; f64 value; i32 code; i32 pad; };
+
+    TSDB db { 1, TableOptions { .compress_sealed = true } };
+    const auto type = db.register_struct("Row", { { "value", TSDB::F64 }, { "code", TSDB::I32 }, { "pad", TSDB::I32 } });
+
+    std::vector<Row> rows(3 * ChunkRows + 17);
+    for (size_t i = 0; i < rows.size(); ++i) {
+        rows[i] = { static_cast<i64>(i * 1000), static_cast<f64>(i % 977) * 0.5, static_cast<i32>(i % 5), 0 };
+    }
+    db.insert_batch(std::span<const Row>(rows), type);
+
+    const Table& t = *db.table(type);
+    ASSERT_TRUE(t.column(1).is_sealed(0));
+    EXPECT_LT(t.memory_bytes(), rows.size() * sizeof(Row));
+
+    for (size_t i = 0; i < rows.size(); i += 101) {
+        Row r;
+        t.read_row(i, reinterpret_cast<std::byte*>(&r));
+        EXPECT_EQ(r.timestamp_ns, rows[i].timestamp_ns);
+        EXPECT_EQ(r.value, rows[i].value);
+        EXPECT_EQ(r.code, rows[i].code);
+    }
+
+    const auto agg = db.aggregate(db.field<f64>(type, "value").unwrap(), 0, std::numeric_limits<i64>::max());
+    f64 sum = 0;
+    for (const Row& r : rows) sum += r.value;
+    EXPECT_EQ(agg.count, rows.size());
+    EXPECT_DOUBLE_EQ(agg.sum, sum);
+}
+
+TEST(Gorilla, SealingReturnsArenaChunks) {
+    struct Row { i64 timestamp_ns; f64 value; };
+
+    TSDB db { 1, TableOptions { .memory = TableMemory::HugePages, .compress_sealed = true } };
+    const auto type = db.register_struct("Row", { { "value", TSDB::F64 } });
+
+    std::vector<Row> rows(16 * ChunkRows + 1);
+    for (size_t i = 0; i < rows.size(); ++i) rows[i] = { static_cast<i64>(i), 1.0 };
+    db.insert_batch(std::span<const Row>(rows), type);
+
+    // Each chunk reuses the raw rows of the one sealed before it, so the
+    // arena holds about one chunk per column instead of sixteen.
+    const ChunkArena* arena = db.table(type)->arena();
+    ASSERT_NE(arena, nullptr);
+    EXPECT_LE(arena->reserved(), 4 * 2 * ChunkRows * sizeof(f64));
+}
+
+TEST(Gorilla, ConcurrentReadersOfSealedChunks) {
+    struct Row { i64 timestamp_ns; f64 value; };
+
+    TSDB db { 1, TableOptions { .compress_sealed = true } };
+    const auto type = db.register_struct("Row", { { "value", TSDB::F64 } });
+
+    std::vector<Row> rows(8 * ChunkRows);
+    for (size_t i = 0; i < rows.size(); ++i) rows[i] = { static_cast<i64>(i), static_cast<f64>(i % 1000) };
+    db.insert_batch(std::span<const Row>(rows), type);
+    const auto value = db.field<f64>(type, "value").unwrap();
+
+    // Each reader walks the chunks in its own order and holds two spans at
+    // once, so a shared decode buffer would hand it the wrong rows.
+    auto read = [&](size_t offset) {
+        const auto view = db.column(value);
+        u64 bad = 0;
+        for (size_t k = 0; k < 64; ++k) {
+            const size_t c = (k + offset) % 7;
+            auto chunks = view.chunks();
+            auto it     = std::ranges::next(chunks.begin(), static_cast<std::ptrdiff_t>(c));
+            const auto a = *it;
+            Column::Cursor other;
+            const auto b = db.table(type)->column(1).chunk_as<f64>(c + 1, other);
+            for (size_t i = 0; i < ChunkRows; i += 61) {
+                bad += a[i] != rows[c * ChunkRows + i].value;
+                bad += b[i] != rows[(c + 1) * ChunkRows + i].value;
+            }
+        }
+        return bad;
+    };
+
+    std::vector<u64> bad(4);
+    {
+        std::vector<std::jthread> readers;
+        for (size_t t = 0; t < bad.size(); ++t) readers.emplace_back([&, t] { bad[t] = read(t); });
+    }
+    for (u64 b : bad) EXPECT_EQ(b, 0u);
+}
+
+// A chunk sealed after another was dropped may get the freed chunk's
+// encoded words back; a cursor still holding that chunk must decode again.
+TEST(Gorilla, CursorDecodesChunkSealedAfterADrop) {
+    Column col { sizeof(f64), Schema::TypeKind::F64, false, nullptr, true };
+    auto push = [&](f64 v, size_t n) {
+        for (size_t i = 0; i < n; ++i) col.push(reinterpret_cast<const std::byte*>(&v));
+    };
+
+    push(1.0, ChunkRows + 1);
+    ASSERT_TRUE(col.is_sealed(0));
+    Column::Cursor cur;
+    EXPECT_EQ(col.value<f64>(0, cur), 1.0);
+
+    col.drop_front();
+    push(2.0, ChunkRows);
+    ASSERT_TRUE(col.is_sealed(0));
+    EXPECT_EQ(col.value<f64>(1, cur), 2.0);
+}
+
+} // namespace
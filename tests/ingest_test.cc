@@ -0,0 +1,74 @@
+#include "tsdb.hh"
+
+#include <format>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+struct Point {
+    i64 timestamp_ns;
+    f64 value;
+};
+
+TEST(Ingest, FeedsRollupsWhileOtherTypesAreAdded) {
+    constexpr i64 Rows   = 200'000;
+    constexpr i64 Bucket = 1000;
+
+    TSDB db;
+    const auto type   = db.register_struct("Point", { { "value", TSDB::F64 } });
+    const auto rollup = db.register_rollup(type, "value", Bucket).unwrap();
+    const auto queue  = db.start_ingest(type, 1024);
+
+    std::jthread producer { [&] {
+        for (i64 i = 0; i < Rows; ++i) {
+            while (queue.enqueue(Point { i, 1.0 }).is_none()) std::this_thread::yield();
+        }
+    } };
+
+    // New types and tables rehash the maps the drain thread used to read.
+    for (int k = 0; k < 200; ++k) {
+        const auto other = db.register_struct(std::format("other{}", k), { { "value", TSDB::F64 } });
+        (void)db.register_rollup(other, "value", Bucket);
+        db.set_retention(other, 1);
+        db.insert(Point { 0, 0.0 }, other);
+    }
+
+    producer.join();
+    while (queue.applied() < static_cast<u64>(Rows)) std::this_thread::yield();
+    db.stop_ingest(type);
+
+    EXPECT_EQ(db.table(type)->row_count(), static_cast<size_t>(Rows));
+
+    // Every bucket but the open last one is closed into the rollup table.
+    std::vector<RollupRow> buckets;
+    for (const RollupRow& r : db.query_range<RollupRow>(rollup, 0, Rows)) buckets.push_back(r);
+    ASSERT_EQ(buckets.size(), static_cast<size_t>(Rows / Bucket - 1));
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        EXPECT_EQ(buckets[i].timestamp_ns, static_cast<i64>(i) * Bucket);
+        EXPECT_EQ(buckets[i].count, static_cast<u64>(Bucket));
+        EXPECT_EQ(buckets[i].sum, static_cast<f64>(Bucket));
+    }
+}
+
+TEST(Ingest, AppliesRetention) {
+    TSDB db;
+    const auto type = db.register_struct("Point", { { "value", TSDB::F64 } });
+    db.set_retention(type, ChunkRows);
+    const auto queue = db.start_ingest(type);
+
+    const i64 rows = 4 * ChunkRows;
+    for (i64 i = 0; i < rows; ++i) {
+        while (queue.enqueue(Point { i, 0.0 }).is_none()) std::this_thread::yield();
+    }
+    db.stop_ingest(type);
+
+    // At least the TTL is kept and at most one more chunk.
+    const size_t kept = db.table(type)->row_count();
+    EXPECT_GE(kept, static_cast<size_t>(ChunkRows));
+    EXPECT_LE(kept, static_cast<size_t>(3 * ChunkRows));
+}
+
+} // namespace
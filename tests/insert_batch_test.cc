@@ -0,0 +1,70 @@
+#include "tsdb.hh"
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+struct Row { i64 timestamp_ns; f64 value; i32 code; u8 flag; };
+
+constexpr i64 Max = std::numeric_limits<i64>::max();
+
+auto register_row(TSDB& db, std::string name) -> TypeHandle {
+    return db.register_struct(std::move(name), { { "value", TSDB::F64 }, { "code", TSDB::I32 }, { "flag", TSDB::U8 } });
+}
+
+auto rows_of(const TSDB& db, TypeHandle type) -> std::vector<Row> {
+    std::vector<Row> out;
+    for (const Row& r : db.query_range<Row>(type, 0, Max)) out.push_back(r);
+    return out;
+}
+
+auto same(const std::vector<Row>& a, const std::vector<Row>& b) -> bool {
+    return std::ranges::equal(a, b, [](const Row& x, const Row& y) {
+        return x.timestamp_ns == y.timestamp_ns && x.value == y.value && x.code == y.code && x.flag == y.flag;
+    });
+}
+
+TEST(InsertBatch, MatchesRowAtATimeInserts) {
+    std::vector<Row> rows(3000);
+    for (size_t i = 0; i < rows.size(); ++i) {
+        rows[i] = { static_cast<i64>(i), static_cast<f64>(i % 37), static_cast<i32>(i) - 1500, static_cast<u8>(i) };
+    }
+
+    TSDB db;
+    const auto batched = register_row(db, "Batched");
+    const auto single  = register_row(db, "Single");
+
+    // Uneven batches, so each starts part way into a chunk.
+    const std::span<const Row> all(rows);
+    db.insert_batch(all.first(1), batched);
+    db.insert_batch(all.subspan(1, 1999), batched);
+    db.insert_batch(all.subspan(2000), batched);
+    for (const Row& r : rows) db.insert(r, single);
+
+    EXPECT_TRUE(same(rows_of(db, batched), rows));
+    EXPECT_TRUE(same(rows_of(db, single), rows));
+
+    const auto a = db.aggregate(db.field<f64>(batched, "value").unwrap(), 0, Max);
+    const auto b = db.aggregate(db.field<f64>(single, "value").unwrap(), 0, Max);
+    EXPECT_EQ(a.count, b.count);
+    EXPECT_EQ(a.sum, b.sum);
+    EXPECT_EQ(a.max, b.max);
+}
+
+TEST(InsertBatch, EmptyBatchInsertsNothing) {
+    TSDB db;
+    const auto type = register_row(db, "Row");
+    db.insert_batch(std::span<const Row>(), type);
+    db.insert(Row { 5, 1.0, 2, 3 }, type);
+    db.insert_batch(std::span<const Row>(), type);
+
+    EXPECT_EQ(db.table(type)->row_count(), 1u);
+    EXPECT_EQ(db.query_last<Row>(type).timestamp_ns, 5);
+}
+
+} // namespace
@@ -0,0 +1,76 @@
+#include "tsdb.hh"
+
+#include <limits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+struct Point { i64 timestamp_ns; f64 value; };
+
+constexpr i64 Min = std::numeric_limits<i64>::min();
+constexpr i64 Max = std::numeric_limits<i64>::max();
+
+auto timestamps_in(const TSDB& db, TypeHandle type) -> std::vector<i64> {
+    std::vector<i64> out;
+    for (const Point& p : db.query_range<Point>(type, Min, Max)) out.push_back(p.timestamp_ns);
+    return out;
+}
+
+TEST(Lateness, StagesRowsUntilTheWindowPasses) {
+    TSDB db;
+    const auto type = db.register_struct("Point", { { "value", TSDB::F64 } });
+    db.set_lateness(type, 100);
+
+    for (i64 t : { 0, 50, 30, 120 }) db.insert(Point { t, 0 }, type);
+    EXPECT_EQ(timestamps_in(db, type), (std::vector<i64> { 0 }));
+    EXPECT_EQ(db.table(type)->staged_rows(), 3u);
+
+    db.insert(Point { 200, 0 }, type);
+    EXPECT_EQ(timestamps_in(db, type), (std::vector<i64> { 0, 30, 50 }));
+
+    db.flush_staged(type);
+    EXPECT_EQ(timestamps_in(db, type), (std::vector<i64> { 0, 30, 50, 120, 200 }));
+    EXPECT_EQ(db.table(type)->staged_rows(), 0u);
+}
+
+TEST(Lateness, CountsRowsOlderThanTheCommittedOnes) {
+    TSDB db;
+    const auto type = db.register_struct("Point", { { "value", TSDB::F64 } });
+    db.set_lateness(type, 10);
+
+    for (i64 t : { 100, 200, 150, 50 }) db.insert(Point { t, 0 }, type);
+    db.flush_staged(type);
+
+    // 100 is committed once 200 arrives, so 50 can no longer be placed.
+    EXPECT_EQ(timestamps_in(db, type), (std::vector<i64> { 100, 150, 200 }));
+    EXPECT_EQ(db.table(type)->late_rows(), 1u);
+}
+
+TEST(Lateness, SettingItChangesExistingSeriesAndShards) {
+    TSDB db;
+    const auto type   = db.register_struct("Point", { { "value", TSDB::F64 } });
+    const auto series = db.series(type, { { "host", "a" } });
+    TSDB::Writer writer = db.writer();
+
+    db.insert(Point { 0, 0 }, series);
+    writer.insert(Point { 0, 0 }, type);
+    db.set_lateness(type, 100);
+
+    for (i64 t : { 60, 20 }) {
+        db.insert(Point { t, 0 }, series);
+        writer.insert(Point { t, 0 }, type);
+    }
+    db.flush_staged(type);
+
+    std::vector<i64> in_series;
+    for (const Point& p : db.query_range<Point>(series, Min, Max)) in_series.push_back(p.timestamp_ns);
+    EXPECT_EQ(in_series, (std::vector<i64> { 0, 20, 60 }));
+
+    std::vector<i64> merged;
+    for (const Point& p : db.query_range_merged<Point>(type, Min, Max)) merged.push_back(p.timestamp_ns);
+    EXPECT_EQ(merged, (std::vector<i64> { 0, 20, 60 }));
+}
+
+} // namespace
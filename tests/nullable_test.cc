@@ -0,0 +1,113 @@
+#include "test_util.hh"
+#include "tsdb.hh"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+// Reflected types must live at namespace scope.
+struct Reading {
+    i64            timestamp_ns;
+    Nullable<f64>  temp;
+    Nullable<i32>  level;
+    u32            id;
+};
+TSDB_REFLECT(Reading, temp, level, id)
+
+namespace {
+
+auto is_null(size_t i) -> bool { return (i * 2654435761u) % 7 < 3; }
+
+auto readings(size_t n) -> std::vector<Reading> {
+    std::vector<Reading> rows(n);
+    for (size_t i = 0; i < n; ++i) {
+        rows[i].timestamp_ns = static_cast<i64>(i);
+        rows[i].temp  = is_null(i) ? Nullable<f64> { None } : Nullable<f64> { static_cast<f64>(i % 1000) - 300.5 };
+        rows[i].level = is_null(i + 1) ? Nullable<i32> { None } : Nullable<i32> { static_cast<i32>(i % 5000) - 17 };
+        rows[i].id    = static_cast<u32>(i);
+    }
+    return rows;
+}
+
+// Reference aggregate over the non-null temps of rows [first, last).
+auto temp_summary(const std::vector<Reading>& rows, size_t first, size_t last) -> kernels::Summary<f64> {
+    kernels::Summary<f64> s;
+    for (size_t i = first; i < std::min(last, rows.size()); ++i) {
+        if (!rows[i].temp.valid) continue;
+        const f64 v = rows[i].temp.value;
+        s.sum += v;
+        s.min = std::min(s.min, v);
+        s.max = std::max(s.max, v);
+        ++s.count;
+    }
+    return s;
+}
+
+class NullableTest : public ::testing::TestWithParam<bool> {};
+
+TEST_P(NullableTest, ValidityRoundTripsAndAggregatesSkipNulls) {
+    TSDB db { 4, TableOptions { .compress_sealed = GetParam() } };
+    const auto type = db.register_type<Reading>().unwrap().type();
+    const auto rows = readings(3 * ChunkRows + 777);
+    db.insert(rows[0], type);
+    db.insert_batch(std::span<const Reading>(rows).subspan(1), type);
+
+    const auto temp  = db.field<f64>(type, "temp").unwrap();
+    const auto level = db.field<i32>(type, "level").unwrap();
+    for (size_t i = 0; i < rows.size(); i += 97) {
+        EXPECT_EQ(db.column(temp).get(i).is_some(), rows[i].temp.valid) << i;
+        EXPECT_EQ(db.column(level).get(i).is_some(), rows[i].level.valid) << i;
+    }
+
+    for (auto [first, last] : { std::pair<size_t, size_t> { 0, rows.size() }, { 5, 70000 }, { 65530, 65540 }, { 100, 200000 } }) {
+        const auto got  = db.aggregate(temp, static_cast<i64>(first), static_cast<i64>(last));
+        const auto want = temp_summary(rows, first, last);
+        EXPECT_EQ(got.count, want.count);
+        EXPECT_NEAR(got.sum, want.sum, 1e-6 * std::abs(want.sum) + 1e-6);
+        EXPECT_EQ(got.min, want.min);
+        EXPECT_EQ(got.max, want.max);
+    }
+
+    const auto last = db.query_last<Reading>(type);
+    EXPECT_EQ(last.temp.valid, rows.back().temp.valid);
+    EXPECT_EQ(last.id, rows.back().id);
+}
+
+INSTANTIATE_TEST_SUITE_P(Compression, NullableTest, ::testing::Bool());
+
+TEST(Nullable, ValidityReplaysFromWal) {
+    const auto path = temp_path("wal");
+    const auto rows = readings(ChunkRows + 10);
+    {
+        TSDB db;
+        const auto type = db.register_type<Reading>().unwrap().type();
+        (void)db.open_wal(path);
+        db.insert_batch(std::span<const Reading>(rows), type);
+    }
+
+    TSDB db;
+    const auto type = db.register_type<Reading>().unwrap().type();
+    ASSERT_EQ(db.open_wal(path).unwrap(), rows.size());
+    const auto temp = db.field<f64>(type, "temp").unwrap();
+    EXPECT_EQ(db.aggregate(temp, 0, static_cast<i64>(rows.size())).count, temp_summary(rows, 0, rows.size()).count);
+}
+
+TEST(Nullable, ValidityRoundTripsThroughSegment) {
+    const auto path = temp_path("seg");
+    const auto rows = readings(ChunkRows + 10);
+    {
+        TSDB db;
+        const auto type = db.register_type<Reading>().unwrap().type();
+        db.insert_batch(std::span<const Reading>(rows), type);
+        ASSERT_TRUE(db.flush_segment(type, path).is_ok());
+    }
+
+    TSDB db;
+    const auto type = db.register_type<Reading>().unwrap().type();
+    ASSERT_TRUE(db.open_segment(path).is_ok());
+    const auto temp = db.field<f64>(type, "temp").unwrap();
+    EXPECT_EQ(db.aggregate(temp, 0, ChunkRows).count, temp_summary(rows, 0, ChunkRows).count);
+    EXPECT_EQ(db.column(temp).get(3).is_some(), rows[3].temp.valid);
+}
+
+} // namespace
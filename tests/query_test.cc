@@ -0,0 +1,125 @@
+#include "tsdb.hh"
+
+#include <atomic>
+#include <limits>
+#include <ranges>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+struct Point { i64 timestamp_ns; f64 value; };
+
+constexpr i64 Min = std::numeric_limits<i64>::min();
+constexpr i64 Max = std::numeric_limits<i64>::max();
+
+auto insert_points(TSDB& db, const std::vector<i64>& timestamps) -> TypeHandle {
+    const auto type = db.register_struct("Point", { { "value", TSDB::F64 } });
+    std::vector<Point> rows;
+    for (const i64 ts : timestamps) rows.push_back({ ts, static_cast<f64>(rows.size()) });
+    db.insert_batch(std::span<const Point>(rows), type);
+    return type;
+}
+
+auto timestamps_in(const TSDB& db, TypeHandle type, i64 start_ns, i64 end_ns) -> std::vector<i64> {
+    std::vector<i64> out;
+    for (const Point& p : db.query_range<Point>(type, start_ns, end_ns)) out.push_back(p.timestamp_ns);
+    return out;
+}
+
+TEST(QueryRange, IsHalfOpenAndKeepsDuplicates) {
+    TSDB db;
+    const auto type = insert_points(db, { 100, 200, 200, 200, 300, 400 });
+
+    EXPECT_EQ(timestamps_in(db, type, 200, 300), (std::vector<i64> { 200, 200, 200 }));
+    EXPECT_EQ(timestamps_in(db, type, 150, 301), (std::vector<i64> { 200, 200, 200, 300 }));
+    EXPECT_EQ(timestamps_in(db, type, 100, 101), (std::vector<i64> { 100 }));
+    EXPECT_EQ(timestamps_in(db, type, Min, Max), (std::vector<i64> { 100, 200, 200, 200, 300, 400 }));
+}
+
+TEST(QueryRange, EmptyWhenNothingMatches) {
+    TSDB db;
+    const auto type = insert_points(db, { 100, 200, 300 });
+
+    EXPECT_TRUE(timestamps_in(db, type, 0, 100).empty());
+    EXPECT_TRUE(timestamps_in(db, type, 301, 1000).empty());
+    EXPECT_TRUE(timestamps_in(db, type, 201, 300).empty());
+    EXPECT_TRUE(timestamps_in(db, type, 200, 200).empty());
+    EXPECT_TRUE(timestamps_in(db, type, 300, 100).empty());
+
+    const auto unused = db.register_struct("Unused", { { "value", TSDB::F64 } });
+    EXPECT_TRUE(timestamps_in(db, unused, Min, Max).empty());
+}
+
+TEST(QueryRange, ReadsAcrossChunks) {
+    TSDB db;
+    std::vector<i64> ts;
+    for (i64 i = 0; i < static_cast<i64>(ChunkRows) + 2000; ++i) ts.push_back(2 * i);
+    const auto type = insert_points(db, ts);
+
+    const i64 start = 2 * static_cast<i64>(ChunkRows) - 10;
+    std::vector<f64> values;
+    for (const Point& p : db.query_range<Point>(type, start, start + 20)) values.push_back(p.value);
+
+    std::vector<f64> want;
+    for (i64 i = start / 2; i < start / 2 + 10; ++i) want.push_back(static_cast<f64>(i));
+    EXPECT_EQ(values, want);
+    EXPECT_EQ(std::ranges::distance(db.query_range<Point>(type, 0, Max)), static_cast<std::ptrdiff_t>(ts.size()));
+}
+
+TEST(QueryLast, IsTheNewestRowOfEverySource) {
+    TSDB db;
+    const auto type = db.register_struct("Point", { { "value", TSDB::F64 } });
+    EXPECT_EQ(db.query_last<Point>(type).timestamp_ns, 0);
+
+    db.insert(Point { 10, 1 }, type);
+    TSDB::Writer writer = db.writer();
+    writer.insert(Point { 30, 2 }, type);
+    db.insert(Point { 20, 3 }, type);
+    EXPECT_EQ(db.query_last<Point>(type).value, 2);
+
+    const auto series = db.series(type, { { "host", "a" } });
+    db.insert(Point { 5, 4 }, series);
+    EXPECT_EQ(db.query_last<Point>(series).value, 4);
+}
+
+TEST(QueryLast, FollowsTheLayoutAfterAddField) {
+    struct Wider { i64 timestamp_ns; f64 value; Nullable<f64> extra; };
+
+    TSDB db;
+    const auto type = insert_points(db, { 1, 2, 3 });
+    (void)db.add_field(type, "extra", db.nullable(TSDB::F64));
+
+    const Wider last = db.query_last<Wider>(type);
+    EXPECT_EQ(last.timestamp_ns, 3);
+    EXPECT_EQ(last.value, 2);
+    EXPECT_FALSE(last.extra.valid);
+}
+
+TEST(QueryLast, NeverSeesATornRowWhileAWriterAppends) {
+    constexpr i64 Rows = 200'000;
+
+    TSDB db;
+    const auto type = db.register_struct("Point", { { "value", TSDB::F64 } });
+    db.insert(Point { 0, 0 }, type);
+
+    std::atomic<bool> done { false };
+    std::jthread writer { [&] {
+        for (i64 i = 1; i < Rows; ++i) db.insert(Point { i, static_cast<f64>(i) }, type);
+        done = true;
+    } };
+
+    // Each row's value equals its timestamp, and rows only move forward.
+    i64 seen = 0;
+    while (!done.load()) {
+        const Point p = db.query_last<Point>(type);
+        ASSERT_EQ(static_cast<f64>(p.timestamp_ns), p.value);
+        ASSERT_GE(p.timestamp_ns, seen);
+        seen = p.timestamp_ns;
+    }
+    EXPECT_EQ(db.query_last<Point>(type).timestamp_ns, Rows - 1);
+}
+
+} // namespace
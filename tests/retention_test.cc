@@ -0,0 +1,77 @@
+#include "tsdb.hh"
+
+#include <iterator>
+#include <limits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+struct Point { i64 timestamp_ns; f64 value; };
+
+constexpr i64 Chunk = static_cast<i64>(ChunkRows);
+constexpr i64 Max   = std::numeric_limits<i64>::max();
+
+auto points(i64 first, i64 last) -> std::vector<Point> {
+    std::vector<Point> rows;
+    for (i64 t = first; t < last; ++t) rows.push_back({ t, 0.0 });
+    return rows;
+}
+
+auto merged_timestamps(const TSDB& db, TypeHandle type) -> std::vector<i64> {
+    std::vector<i64> out;
+    for (const Point& p : db.query_range_merged<Point>(type, 0, Max)) out.push_back(p.timestamp_ns);
+    return out;
+}
+
+TEST(Retention, DropsWholeChunksPastTheTtl) {
+    TSDB db;
+    const auto type = db.register_struct("Point", { { "value", TSDB::F64 } });
+    db.set_retention(type, Chunk);
+
+    // Newest row 4 * Chunk - 1: the first two chunks end before the cutoff,
+    // the third ends on it.
+    const auto rows = points(0, 4 * Chunk);
+    db.insert_batch(std::span<const Point>(rows), type);
+
+    EXPECT_EQ(db.table(type)->row_count(), static_cast<size_t>(2 * Chunk));
+    EXPECT_EQ(db.query_first<Point>(type).timestamp_ns, 2 * Chunk);
+}
+
+TEST(Retention, AppliesToWriterShards) {
+    TSDB db;
+    const auto type = db.register_struct("Point", { { "value", TSDB::F64 } });
+    db.set_retention(type, Chunk);
+
+    TSDB::Writer writer = db.writer();
+    const auto rows = points(0, 4 * Chunk);
+    writer.insert_batch(std::span<const Point>(rows), type);
+    for (i64 t = 4 * Chunk; t < 5 * Chunk; ++t) writer.insert(Point { t, 0.0 }, type);
+
+    const auto kept = merged_timestamps(db, type);
+    ASSERT_EQ(kept.size(), static_cast<size_t>(2 * Chunk));
+    EXPECT_EQ(kept.front(), 3 * Chunk);
+}
+
+TEST(Retention, ExpireCoversEveryTableOfTheType) {
+    TSDB db;
+    const auto type   = db.register_struct("Point", { { "value", TSDB::F64 } });
+    const auto series = db.series(type, { { "host", "a" } });
+    db.set_retention(type, 10 * Chunk);
+
+    const auto rows = points(0, 2 * Chunk);
+    db.insert_batch(std::span<const Point>(rows), type);
+    db.insert_batch(std::span<const Point>(rows), series);
+    TSDB::Writer writer = db.writer();
+    writer.insert_batch(std::span<const Point>(rows), type);
+
+    // Nothing is old enough yet, then the first chunk of each table is.
+    EXPECT_EQ(db.expire(10 * Chunk), 0u);
+    EXPECT_EQ(db.expire(11 * Chunk), static_cast<size_t>(3 * Chunk));
+
+    EXPECT_EQ(merged_timestamps(db, type).size(), static_cast<size_t>(2 * Chunk));
+    EXPECT_EQ(std::ranges::distance(db.query_range<Point>(series, 0, Max)), Chunk);
+}
+
+} // namespace
@@ -0,0 +1,215 @@
+#include "test_util.hh"
+#include "tsdb.hh"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+// Reflected types must live at namespace scope.
+struct Probe { i64 timestamp_ns; f64 temp; };
+TSDB_REFLECT(Probe, temp)
+
+namespace {
+
+struct V0 { i64 timestamp_ns; f64 temp; u32 code; };
+struct V1 { i64 timestamp_ns; f64 temp; u32 code; Nullable<f64> humidity; };
+struct V2 { i64 timestamp_ns; f64 temp; Nullable<f64> humidity; };
+
+constexpr i64 End = i64 { 1 } << 40;
+
+auto register_v0(TSDB& db) -> TypeHandle {
+    return db.register_struct("m", { { "temp", TSDB::F64 }, { "code", TSDB::U32 } });
+}
+
+auto v0_rows(size_t n) -> std::vector<V0> {
+    std::vector<V0> rows(n);
+    for (size_t i = 0; i < n; ++i) rows[i] = { static_cast<i64>(i), static_cast<f64>(i), static_cast<u32>(i % 7) };
+    return rows;
+}
+
+TEST(SchemaEvolution, AddFieldReadsNullForOldRows) {
+    TSDB db;
+    const auto type = register_v0(db);
+    const size_t n0 = ChunkRows + 100;
+    db.insert_batch(std::span<const V0>(v0_rows(n0)), type);
+
+    ASSERT_EQ(db.add_field(type, "humidity", db.nullable(TSDB::F64)).unwrap(), 1u);
+    EXPECT_TRUE(db.add_field(type, "humidity", TSDB::F64).is_none());
+    EXPECT_EQ(db.schema_version(type), 1u);
+
+    std::vector<V1> rows(500);
+    for (size_t i = 0; i < rows.size(); ++i) {
+        const size_t k = n0 + i;
+        rows[i] = { static_cast<i64>(k), static_cast<f64>(k), 0,
+                    i % 2 ? Nullable<f64> { static_cast<f64>(i) } : Nullable<f64> { None } };
+    }
+    db.insert(rows[0], type);
+    db.insert_batch(std::span<const V1>(rows).subspan(1), type);
+
+    const auto hum = db.field<f64>(type, "humidity").unwrap();
+    EXPECT_TRUE(db.column(hum).get(5).is_none());
+    EXPECT_TRUE(db.column(hum).get(n0).is_none());
+    EXPECT_EQ(db.column(hum).get(n0 + 1).unwrap(), 1.0);
+    EXPECT_EQ(db.aggregate(hum, 0, End).count, rows.size() / 2);
+    EXPECT_EQ(db.table(type)->row_count(), n0 + rows.size());
+}
+
+TEST(SchemaEvolution, DropFieldKeepsOldValuesForOldHandles) {
+    TSDB db;
+    const auto type = register_v0(db);
+    db.insert_batch(std::span<const V0>(v0_rows(1000)), type);
+    const auto code = db.field<u32>(type, "code").unwrap();
+
+    ASSERT_TRUE(db.drop_field(type, "code").is_some());
+    EXPECT_TRUE(db.field<u32>(type, "code").is_none());
+
+    struct Dropped { i64 timestamp_ns; f64 temp; };
+    std::vector<Dropped> rows(100);
+    for (size_t i = 0; i < rows.size(); ++i) rows[i] = { static_cast<i64>(1000 + i), 1.0 };
+    db.insert_batch(std::span<const Dropped>(rows), type);
+
+    const auto col = db.column(code);
+    EXPECT_EQ(col[8], 1u);
+    EXPECT_EQ(col[1005], 0u);
+    EXPECT_EQ(db.aggregate(db.field<f64>(type, "temp").unwrap(), 0, End).count, 1100u);
+}
+
+TEST(SchemaEvolution, ReplaysFromWal) {
+    const auto path = temp_path("wal");
+    {
+        TSDB db;
+        const auto type = register_v0(db);
+        (void)db.open_wal(path);
+        db.insert_batch(std::span<const V0>(v0_rows(100)), type);
+        (void)db.add_field(type, "humidity", db.nullable(TSDB::F64));
+        db.insert(V1 { 100, 1.0, 3, Nullable<f64> { 4.0 } }, type);
+        (void)db.drop_field(type, "code");
+        db.insert(V2 { 101, 2.0, Nullable<f64> { 5.0 } }, type);
+    }
+
+    TSDB db;
+    const auto type = register_v0(db);
+    ASSERT_EQ(db.open_wal(path).unwrap(), 102u);
+    EXPECT_EQ(db.schema_version(type), 2u);
+    EXPECT_TRUE(db.field<u32>(type, "code").is_none());
+
+    const auto hum = db.field<f64>(type, "humidity").unwrap();
+    EXPECT_EQ(db.aggregate(hum, 0, End).sum, 9.0);
+    EXPECT_EQ(db.query_last<V2>(type).temp, 2.0);
+}
+
+TEST(SchemaEvolution, OldSegmentOpensIntoEvolvedSchema) {
+    const auto path = temp_path("seg");
+    {
+        TSDB db;
+        const auto type = register_v0(db);
+        db.insert_batch(std::span<const V0>(v0_rows(ChunkRows + 10)), type);
+        ASSERT_EQ(db.flush_segment(type, path).unwrap(), static_cast<size_t>(ChunkRows));
+    }
+
+    TSDB db;
+    const auto type = register_v0(db);
+    (void)db.add_field(type, "humidity", db.nullable(TSDB::F64));
+    ASSERT_TRUE(db.open_segment(path).is_ok());
+
+    EXPECT_EQ(db.table(type)->row_count(), static_cast<size_t>(ChunkRows));
+    EXPECT_EQ(db.aggregate(db.field<f64>(type, "humidity").unwrap(), 0, End).count, 0u);
+    EXPECT_EQ(db.aggregate(db.field<u32>(type, "code").unwrap(), 0, End).max, 6u);
+}
+
+TEST(SchemaEvolution, StagedRowsAreAppendedBeforeTheLayoutChanges) {
+    TSDB db;
+    const auto type = register_v0(db);
+    const auto code = db.field<u32>(type, "code").unwrap();
+    db.set_lateness(type, 1000);
+
+    // 30 rows in reverse order, all staged.
+    for (i64 ts = 29; ts >= 0; --ts) db.insert(V0 { ts, static_cast<f64>(ts), 1 }, type);
+    (void)db.add_field(type, "humidity", db.nullable(TSDB::F64));
+    db.insert(V1 { 40, 40.0, 1, Nullable<f64> { 2.0 } }, type);
+    (void)db.drop_field(type, "code");
+    db.insert(V2 { 50, 50.0, Nullable<f64> { 3.0 } }, type);
+    db.flush_staged(type);
+
+    EXPECT_EQ(db.table(type)->row_count(), 32u);
+    EXPECT_EQ(db.aggregate(db.field<f64>(type, "temp").unwrap(), 0, End).sum, 435.0 + 90.0);
+    EXPECT_EQ(db.aggregate(db.field<f64>(type, "humidity").unwrap(), 0, End).sum, 5.0);
+    EXPECT_EQ(db.column(code)[29], 1u);
+    EXPECT_EQ(db.column(code)[31], 0u);
+}
+
+TEST(SchemaEvolution, StaleTypedTableRejectsInserts) {
+    TSDB db;
+    auto probes = db.register_type<Probe>().unwrap();
+    ASSERT_TRUE(probes.insert_row({ 0, 1.0 }));
+
+    (void)db.add_field(probes.type(), "humidity", db.nullable(TSDB::F64));
+    EXPECT_TRUE(probes.stale());
+    EXPECT_FALSE(probes.insert_row({ 1, 2.0 }));
+    EXPECT_FALSE(probes.insert_batch(std::vector<Probe> { { 2, 3.0 } }));
+    EXPECT_EQ(probes.row_count(), 1u);
+    EXPECT_EQ(probes.read_row(0).temp, 1.0);
+
+    EXPECT_TRUE(db.register_type<Probe>().is_none());
+}
+
+TEST(SchemaEvolution, ReplaySkipsChangesAlreadyApplied) {
+    const auto path = temp_path("wal");
+    {
+        TSDB db;
+        const auto type = register_v0(db);
+        (void)db.open_wal(path);
+        (void)db.drop_field(type, "code");
+        (void)db.add_field(type, "code", TSDB::U32);
+        db.insert(V0 { 1, 2.0, 3 }, type);
+    }
+
+    // The same changes made again before the log is opened.
+    TSDB db;
+    const auto type = register_v0(db);
+    (void)db.drop_field(type, "code");
+    (void)db.add_field(type, "code", TSDB::U32);
+    ASSERT_EQ(db.open_wal(path).unwrap(), 1u);
+
+    EXPECT_EQ(db.schema_version(type), 2u);
+    const auto code = db.field<u32>(type, "code").unwrap();
+    EXPECT_EQ(code.column(), 3u);
+    EXPECT_EQ(db.column(code)[0], 3u);
+}
+
+TEST(SchemaEvolution, ReplayMovesOlderRowsToTheRegisteredVersion) {
+    const auto path = temp_path("wal");
+    {
+        TSDB db;
+        const auto type   = register_v0(db);
+        const auto series = db.series(type, { { "site", "a" } });
+        (void)db.open_wal(path);
+        db.insert_batch(std::span<const V0>(v0_rows(100)), type);
+        db.insert(V0 { 0, 7.0, 1 }, series);
+        (void)db.add_field(type, "humidity", db.nullable(TSDB::F64));
+        db.insert(V1 { 100, 1.0, 3, Nullable<f64> { 4.0 } }, type);
+        (void)db.drop_field(type, "code");
+        db.insert(V2 { 101, 2.0, Nullable<f64> { 5.0 } }, type);
+    }
+
+    // Registered at v1 (the drop is replayed) and at v2 (nothing is).
+    for (const bool drop_first : { false, true }) {
+        TSDB db;
+        const auto type   = register_v0(db);
+        const auto series = db.series(type, { { "site", "a" } });
+        (void)db.add_field(type, "humidity", db.nullable(TSDB::F64));
+        if (drop_first) (void)db.drop_field(type, "code");
+        ASSERT_EQ(db.open_wal(path).unwrap(), 103u) << drop_first;
+        EXPECT_EQ(db.schema_version(type), 2u);
+
+        const auto temp = db.field<f64>(type, "temp").unwrap();
+        const auto hum  = db.field<f64>(type, "humidity").unwrap();
+        EXPECT_EQ(db.aggregate(temp, 0, End).sum, 4950.0 + 3.0);
+        EXPECT_EQ(db.aggregate(hum, 0, End).count, 2u);
+        EXPECT_EQ(db.aggregate(hum, 0, End).sum, 9.0);
+        EXPECT_EQ(db.query_range<V2>(series, 0, End).front().temp, 7.0);
+        EXPECT_FALSE(db.query_range<V2>(series, 0, End).front().humidity.valid);
+    }
+}
+
+} // namespace
@@ -0,0 +1,118 @@
+#include "test_util.hh"
+#include "tsdb.hh"
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+struct Point {
+    i64 timestamp_ns;
+    f64 value;
+};
+
+auto register_point(TSDB& db) -> TypeHandle {
+    return db.register_struct("Point", { { "value", TSDB::F64 } });
+}
+
+// Flushes two chunks of points to a segment at `path`.
+auto write_segment(const std::string& path) -> void {
+    TSDB db;
+    const auto type = register_point(db);
+    std::vector<Point> rows(2 * ChunkRows + 5);
+    for (size_t i = 0; i < rows.size(); ++i) rows[i] = { static_cast<i64>(i), static_cast<f64>(i) };
+    db.insert_batch(std::span<const Point>(rows), type);
+    ASSERT_EQ(db.flush_segment(type, path).unwrap(), 2 * ChunkRows);
+}
+
+template <typename T>
+auto overwrite(const std::string& path, size_t offset, T value) -> void {
+    std::fstream f { path, std::ios::binary | std::ios::in | std::ios::out };
+    f.seekp(static_cast<std::streamoff>(offset));
+    f.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+auto open_error(const std::string& path) -> Option<SegmentError> {
+    TSDB db;
+    (void)register_point(db);
+    auto opened = db.open_segment(path);
+    if (opened.is_ok()) return None;
+    return Some(std::move(opened).unwrap_err());
+}
+
+// Offset of FieldDesc member `member` of the value column.
+constexpr auto value_field(size_t member) -> size_t {
+    return sizeof(segment::Header) + sizeof(segment::FieldDesc) + member;
+}
+
+TEST(Segment, RoundTripsChunksAndZones) {
+    const auto path = temp_path("seg");
+    write_segment(path);
+
+    TSDB db;
+    const auto type = register_point(db);
+    ASSERT_TRUE(db.open_segment(path).is_ok());
+    const auto value = db.field<f64>(type, "value").unwrap();
+    EXPECT_EQ(db.aggregate(value, 0, 2 * ChunkRows).count, 2 * ChunkRows);
+    EXPECT_EQ(db.query_where<Point>(value, 70000.0, 70001.0, 0, 2 * ChunkRows).size(), 2u);
+}
+
+TEST(Segment, RejectsZoneCountThatDoesNotMatchChunks) {
+    const auto path = temp_path("seg");
+    write_segment(path);
+    overwrite<u64>(path, value_field(offsetof(segment::FieldDesc, zone_count)), 1);
+    EXPECT_EQ(open_error(path).unwrap(), SegmentError::Layout);
+}
+
+TEST(Segment, RejectsChunkCountPastTheData) {
+    const auto path = temp_path("seg");
+    write_segment(path);
+    overwrite<u64>(path, offsetof(segment::Header, chunk_count), 3);
+    EXPECT_TRUE(open_error(path).is_some());
+
+    // Large enough that the column size wraps around 64 bits.
+    overwrite<u64>(path, offsetof(segment::Header, chunk_count), u64 { 1 } << 48);
+    EXPECT_TRUE(open_error(path).is_some());
+}
+
+TEST(Segment, RejectsTruncatedFile) {
+    const auto path = temp_path("seg");
+    write_segment(path);
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 8);
+    EXPECT_EQ(open_error(path).unwrap(), SegmentError::Truncated);
+}
+
+TEST(Segment, RejectsTypesWithBytesFields) {
+    struct Note { i64 timestamp_ns; BlobRef body; };
+
+    TSDB db;
+    const auto type = db.register_struct("Note", { { "body", TSDB::BYTES } });
+    const std::byte payload[3] {};
+    for (size_t i = 0; i < ChunkRows; ++i) db.insert(Note { static_cast<i64>(i), db.append_bytes(type, payload) }, type);
+
+    const auto path = temp_path("seg");
+    EXPECT_EQ(db.flush_segment(type, path).unwrap_err(), SegmentError::Unsupported);
+    EXPECT_FALSE(std::filesystem::exists(path));
+}
+
+TEST(Segment, FlushReturnsArenaChunks) {
+    TSDB db { 1, TableOptions { .memory = TableMemory::HugePages } };
+    const auto type = register_point(db);
+    std::vector<Point> rows(2 * ChunkRows + 5);
+    for (size_t i = 0; i < rows.size(); ++i) rows[i] = { static_cast<i64>(i), static_cast<f64>(i) };
+    db.insert_batch(std::span<const Point>(rows), type);
+
+    const ChunkArena* arena = db.table(type)->arena();
+    ASSERT_NE(arena, nullptr);
+    const size_t before = arena->free_bytes();
+
+    ASSERT_EQ(db.flush_segment(type, temp_path("seg")).unwrap(), 2 * ChunkRows);
+    // Both full chunks of both columns are now served from the file.
+    EXPECT_EQ(arena->free_bytes() - before, 2 * 2 * ChunkRows * sizeof(f64));
+}
+
+} // namespace
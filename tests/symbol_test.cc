@@ -0,0 +1,76 @@
+#include "tsdb.hh"
+
+#include <atomic>
+#include <format>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+struct Request { i64 timestamp_ns; u32 host; f64 latency; };
+
+constexpr i64 End = i64 { 1 } << 40;
+
+TEST(Symbol, AggregateByGroupsPerId) {
+    TSDB db;
+    const auto type = db.register_struct("Request", { { "host", TSDB::SYMBOL }, { "latency", TSDB::F64 } });
+
+    std::vector<Request> rows(300);
+    for (size_t i = 0; i < rows.size(); ++i) {
+        rows[i] = { static_cast<i64>(i), db.symbol(type, i % 3 ? "web" : "db"), static_cast<f64>(i % 3) };
+    }
+    db.insert_batch(std::span<const Request>(rows), type);
+
+    const auto groups = db.aggregate_by(db.field<u32>(type, "host").unwrap(),
+                                        db.field<f64>(type, "latency").unwrap(), 0, End);
+    ASSERT_EQ(groups.size(), db.symbol_count(type));
+    EXPECT_EQ(groups[db.find_symbol(type, "db").unwrap()].count, 100u);
+    EXPECT_EQ(groups[db.find_symbol(type, "web").unwrap()].sum, 300.0);
+}
+
+TEST(Symbol, AggregateBySkipsIdsOutsideTheDictionary) {
+    TSDB db;
+    const auto type = db.register_struct("Request", { { "host", TSDB::SYMBOL }, { "latency", TSDB::F64 } });
+
+    const u32 web = db.symbol(type, "web");
+    db.insert(Request { 1, web, 2.0 }, type);
+    db.insert(Request { 2, 1'000'000, 5.0 }, type);
+    db.insert(Request { 3, web + 1, 7.0 }, type);
+
+    const auto groups = db.aggregate_by(db.field<u32>(type, "host").unwrap(),
+                                        db.field<f64>(type, "latency").unwrap(), 0, End);
+    ASSERT_EQ(groups.size(), 1u);
+    EXPECT_EQ(groups[web].count, 1u);
+    EXPECT_EQ(groups[web].sum, 2.0);
+}
+
+TEST(Symbol, AddFieldLeavesLookupsOfOtherTypesAlone) {
+    TSDB db;
+    const auto type = db.register_struct("Request", { { "host", TSDB::SYMBOL }, { "latency", TSDB::F64 } });
+    const u32  web  = db.symbol(type, "web");
+
+    std::vector<TypeHandle> others;
+    for (int i = 0; i < 50; ++i) {
+        others.push_back(db.register_struct(std::format("Other{}", i), { { "value", TSDB::F64 } }));
+    }
+
+    // Adding SYMBOL and BYTES fields makes no new dictionary or arena while
+    // another thread looks symbols up.
+    std::atomic<bool> done { false };
+    std::jthread reader { [&] {
+        while (!done.load(std::memory_order_relaxed)) ASSERT_EQ(db.find_symbol(type, "web").unwrap(), web);
+    } };
+    for (const TypeHandle other : others) {
+        (void)db.add_field(other, "tag", TSDB::SYMBOL);
+        (void)db.add_field(other, "blob", TSDB::BYTES);
+    }
+    done = true;
+    reader.join();
+
+    EXPECT_EQ(db.symbol(others.back(), "x"), 0u);
+    EXPECT_EQ(db.read_bytes(others.back(), db.append_bytes(others.back(), std::as_bytes(std::span("ab", 2)))).size(), 2u);
+}
+
+} // namespace
@@ -0,0 +1,71 @@
+#include "tag_index.hh"
+
+#include <regex>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+using Op = TagMatcher::Op;
+
+// Series i has host web-<i%50> or db-<i%50>, region r<i%3>, and every fifth
+// one has no zone tag.
+auto make_index(std::vector<TagIndex::Tags>& tags) -> TagIndex {
+    TagIndex index;
+    for (u32 id = 0; id < 3000; ++id) {
+        TagIndex::Tags t {
+            { "host",   std::string(id % 2 ? "db-" : "web-") + std::to_string(id % 50) },
+            { "region", "r" + std::to_string(id % 3) },
+        };
+        if (id % 5 != 0) t.emplace_back("zone", "z" + std::to_string(id % 4));
+        index.add(id, t);
+        tags.push_back(std::move(t));
+    }
+    return index;
+}
+
+auto holds(const TagIndex::Tags& tags, const TagMatcher& m) -> bool {
+    const std::string* value = nullptr;
+    for (const auto& [k, v] : tags) {
+        if (k == m.key) value = &v;
+    }
+    switch (m.op) {
+        case Op::Eq:       return value != nullptr && *value == m.value;
+        case Op::NotEq:    return value == nullptr || *value != m.value;
+        case Op::Regex:    return value != nullptr && std::regex_match(*value, std::regex { m.value });
+        case Op::NotRegex: return value == nullptr || !std::regex_match(*value, std::regex { m.value });
+    }
+    return false;
+}
+
+TEST(TagIndex, SelectMatchesBruteForce) {
+    std::vector<TagIndex::Tags> tags;
+    const TagIndex index = make_index(tags);
+
+    const std::vector<std::vector<TagMatcher>> cases {
+        { { "region", Op::Eq, "r1" }, { "host", Op::Regex, "web.*" } },
+        { { "region", Op::Eq, "r1" }, { "host", Op::Regex, "web-1[0-9]" } },
+        { { "region", Op::Eq, "r1" }, { "host", Op::NotRegex, "db.*" } },
+        { { "region", Op::Eq, "r2" }, { "zone", Op::Regex, "z[12]" } },
+        { { "region", Op::Eq, "r2" }, { "zone", Op::NotRegex, "z1" } },
+        { { "region", Op::Eq, "r0" }, { "missing", Op::Regex, ".*" } },
+        { { "region", Op::Eq, "r0" }, { "missing", Op::NotRegex, "x" } },
+        { { "host", Op::Regex, "web.*" }, { "zone", Op::Regex, "z3|z0" } },
+        { { "host", Op::NotRegex, "web.*" }, { "zone", Op::NotRegex, "z3" } },
+        { { "region", Op::Eq, "r1" }, { "region", Op::NotEq, "r1" }, { "host", Op::Regex, ".*" } },
+    };
+
+    for (const auto& matchers : cases) {
+        std::vector<u32> want;
+        for (u32 id = 0; id < tags.size(); ++id) {
+            bool all = true;
+            for (const TagMatcher& m : matchers) all = all && holds(tags[id], m);
+            if (all) want.push_back(id);
+        }
+        EXPECT_EQ(index.select(matchers).to_vector(), want) << matchers[0].key << " " << matchers[1].value;
+    }
+}
+
+} // namespace
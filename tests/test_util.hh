@@ -0,0 +1,16 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+#include <gtest/gtest.h>
+
+// A path under the test temp directory, named after the running test and
+// `name`, with nothing at it yet.
+inline auto temp_path(const std::string& name) -> std::string {
+    const auto* info = ::testing::UnitTest::GetInstance()->current_test_info();
+    const auto  path = std::filesystem::path(::testing::TempDir())
+                     / (std::string(info->test_suite_name()) + "." + info->name() + "." + name);
+    std::filesystem::remove(path);
+    return path.string();
+}
@@ -0,0 +1,189 @@
+#include "test_util.hh"
+#include "tsdb.hh"
+
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+struct Point {
+    i64 timestamp_ns;
+    f64 value;
+};
+
+auto register_point(TSDB& db) -> TypeHandle {
+    return db.register_struct("Point", { { "value", TSDB::F64 } });
+}
+
+auto points(size_t n, i64 first_ts = 0) -> std::vector<Point> {
+    std::vector<Point> rows(n);
+    for (size_t i = 0; i < n; ++i) rows[i] = { first_ts + static_cast<i64>(i), static_cast<f64>(i) };
+    return rows;
+}
+
+auto read_all(const TSDB& db, TypeHandle type) -> std::vector<Point> {
+    std::vector<Point> out;
+    for (const Point& p : db.query_range<Point>(type, 0, std::numeric_limits<i64>::max())) out.push_back(p);
+    return out;
+}
+
+TEST(Wal, ReplaysEveryInsertPath) {
+    const auto path = temp_path("wal");
+    const auto rows = points(5000);
+    {
+        TSDB db;
+        const auto type = register_point(db);
+        ASSERT_EQ(db.open_wal(path).unwrap(), 0u);
+
+        db.insert(rows[0], type);
+        db.insert_batch(std::span(rows).subspan(1, 2999), type);
+        db.insert_batch(std::span(rows).subspan(3000), type);
+    }
+
+    TSDB db;
+    const auto type = register_point(db);
+    ASSERT_EQ(db.open_wal(path).unwrap(), rows.size());
+
+    const auto back = read_all(db, type);
+    ASSERT_EQ(back.size(), rows.size());
+    for (size_t i = 0; i < rows.size(); ++i) EXPECT_EQ(back[i].value, rows[i].value);
+}
+
+TEST(Wal, TornTailIsTruncatedAndLoggingResumes) {
+    const auto path = temp_path("wal");
+    {
+        TSDB db;
+        const auto type = register_point(db);
+        (void)db.open_wal(path);
+        db.insert_batch(std::span<const Point>(points(100)), type);
+    }
+    {
+        // Half a record header, as after a crash mid-write.
+        std::ofstream f { path, std::ios::binary | std::ios::app };
+        f.write("\x05\x00\x00\x00\x10\x00", 6);
+    }
+    {
+        TSDB db;
+        const auto type = register_point(db);
+        ASSERT_EQ(db.open_wal(path).unwrap(), 100u);
+        db.insert_batch(std::span<const Point>(points(50, 100)), type);
+    }
+
+    TSDB db;
+    const auto type = register_point(db);
+    EXPECT_EQ(db.open_wal(path).unwrap(), 150u);
+    EXPECT_EQ(read_all(db, type).back().timestamp_ns, 149);
+}
+
+TEST(Wal, CorruptRecordEndsReplay) {
+    const auto path = temp_path("wal");
+    {
+        TSDB db;
+        const auto type = register_point(db);
+        (void)db.open_wal(path);
+        db.insert_batch(std::span<const Point>(points(10)), type);
+        db.insert_batch(std::span<const Point>(points(10, 10)), type);
+    }
+    {
+        // Flip a byte in the payload of the second record.
+        std::fstream f { path, std::ios::binary | std::ios::in | std::ios::out };
+        f.seekp(-3, std::ios::end);
+        f.put('\x7f');
+    }
+
+    TSDB db;
+    const auto type = register_point(db);
+    EXPECT_EQ(db.open_wal(path).unwrap(), 10u);
+    EXPECT_EQ(read_all(db, type).size(), 10u);
+}
+
+TEST(Wal, UnappliableRecordFailsWithoutTruncating) {
+    const auto path = temp_path("wal");
+    {
+        TSDB db;
+        const auto type = register_point(db);
+        (void)db.open_wal(path);
+        db.insert_batch(std::span<const Point>(points(10)), type);
+    }
+    const auto size = std::filesystem::file_size(path);
+    {
+        // Opened before the type is registered: nothing can be applied.
+        TSDB db;
+        auto opened = db.open_wal(path);
+        ASSERT_TRUE(opened.is_err());
+        EXPECT_EQ(std::move(opened).unwrap_err(), WalError::Apply);
+    }
+    EXPECT_EQ(std::filesystem::file_size(path), size);
+
+    TSDB db;
+    const auto type = register_point(db);
+    EXPECT_EQ(db.open_wal(path).unwrap(), 10u);
+    EXPECT_EQ(read_all(db, type).size(), 10u);
+}
+
+TEST(Wal, ReplaysSymbolsBeforeRows) {
+    struct Event { i64 timestamp_ns; u32 host; u32 pad; };
+
+    const auto path = temp_path("wal");
+    {
+        TSDB db;
+        const auto type = db.register_struct("Event", { { "host", TSDB::SYMBOL }, { "pad", TSDB::U32 } });
+        (void)db.open_wal(path);
+        db.insert(Event { 1, db.symbol(type, "web-1"), 0 }, type);
+        db.insert(Event { 2, db.symbol(type, "web-2"), 0 }, type);
+    }
+
+    TSDB db;
+    const auto type = db.register_struct("Event", { { "host", TSDB::SYMBOL }, { "pad", TSDB::U32 } });
+    ASSERT_EQ(db.open_wal(path).unwrap(), 2u);
+    EXPECT_EQ(db.find_symbol(type, "web-2").unwrap(), 1u);
+    EXPECT_EQ(db.symbol_name(type, db.column<u32>(type, "host").unwrap()[1]), "web-2");
+}
+
+TEST(Wal, RestartFromSegmentsSkipsPersistedRows) {
+    const auto path    = temp_path("wal");
+    const auto seg     = temp_path("seg");
+    const size_t total = 2 * ChunkRows + 1000;
+
+    // Three rows per timestamp, so the rows of one straddle the end of the
+    // second chunk: two are written to the segment and one is not.
+    std::vector<Point> all(total);
+    for (size_t i = 0; i < total; ++i) all[i] = { static_cast<i64>(i / 3), static_cast<f64>(i) };
+    const std::span<const Point> rows = all;
+    {
+        TSDB db;
+        const auto type = register_point(db);
+        (void)db.open_wal(path);
+        db.insert_batch(rows.first(ChunkRows + 7), type);
+        db.insert_batch(rows.subspan(ChunkRows + 7, ChunkRows), type);
+
+        const auto before = std::filesystem::file_size(path);
+        ASSERT_EQ(db.flush_segment(type, seg).unwrap(), 2 * ChunkRows);
+        EXPECT_LT(std::filesystem::file_size(path), before / 100);
+
+        db.insert_batch(rows.subspan(2 * ChunkRows + 7), type);
+        TSDB::Writer writer = db.writer();
+        writer.insert(Point { 0, -1 }, type);
+    }
+
+    for (int restart = 0; restart < 2; ++restart) {
+        TSDB db;
+        const auto type = register_point(db);
+        ASSERT_TRUE(db.open_segment(seg).is_ok());
+        ASSERT_EQ(db.open_wal(path).unwrap(), total - 2 * ChunkRows + 1) << restart;
+
+        // The shard's row is logged as such and replayed after the rest.
+        const Table& table = *db.table(type);
+        ASSERT_EQ(table.row_count(), total + 1);
+        Point p;
+        for (size_t i = 0; i <= total; ++i) {
+            table.read_row(i, reinterpret_cast<std::byte*>(&p));
+            ASSERT_EQ(p.value, i < total ? rows[i].value : -1) << i;
+        }
+    }
+}
+
+} // namespace
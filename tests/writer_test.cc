@@ -0,0 +1,72 @@
+#include "tsdb.hh"
+
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+struct Point {
+    i64 timestamp_ns;
+    f64 value;
+};
+
+TEST(Writer, MergedViewIsInTimestampOrder) {
+    TSDB db;
+    const auto type = db.register_struct("Point", { { "value", TSDB::F64 } });
+
+    constexpr size_t Writers = 4;
+    constexpr size_t Rows    = 20000;
+    {
+        std::vector<std::jthread> threads;
+        for (size_t w = 0; w < Writers; ++w) {
+            threads.emplace_back([&, w] {
+                TSDB::Writer writer = db.writer();
+                // Writer w owns timestamps w, w + Writers, ...: the first
+                // half as single rows, the rest in batches.
+                std::vector<Point> batch;
+                for (size_t i = 0; i < Rows; ++i) {
+                    const Point p { static_cast<i64>(i * Writers + w), static_cast<f64>(w) };
+                    if (i < Rows / 2) {
+                        writer.insert(p, type);
+                        continue;
+                    }
+                    batch.push_back(p);
+                    if (batch.size() == 64) {
+                        writer.insert_batch(std::span<const Point>(batch), type);
+                        batch.clear();
+                    }
+                }
+                writer.insert_batch(std::span<const Point>(batch), type);
+            });
+        }
+    }
+
+    // Every shard holds every Writers-th timestamp, so the merge has to
+    // interleave all of them row by row.
+    std::vector<i64> seen;
+    for (const Point& p : db.query_range_merged<Point>(type, 0, std::numeric_limits<i64>::max())) {
+        seen.push_back(p.timestamp_ns);
+    }
+    ASSERT_EQ(seen.size(), Writers * Rows);
+    EXPECT_TRUE(std::ranges::is_sorted(seen));
+}
+
+TEST(Writer, MergedRangeAndLatestCoverSharedTable) {
+    TSDB db;
+    const auto type = db.register_struct("Point", { { "value", TSDB::F64 } });
+
+    db.insert(Point { 0, 0 }, type);
+    db.insert(Point { 10, 1 }, type);
+    TSDB::Writer writer = db.writer();
+    writer.insert(Point { 5, 2 }, type);
+    writer.insert(Point { 20, 3 }, type);
+
+    std::vector<f64> values;
+    for (const Point& p : db.query_range_merged<Point>(type, 5, 20)) values.push_back(p.value);
+    EXPECT_EQ(values, (std::vector<f64> { 2, 1 }));
+    EXPECT_EQ(db.query_last<Point>(type).timestamp_ns, 20);
+}
+
+} // namespace
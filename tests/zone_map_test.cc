@@ -0,0 +1,76 @@
+#include "tsdb.hh"
+
+#include <limits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+struct Row { i64 timestamp_ns; f64 value; };
+
+constexpr i64 End = std::numeric_limits<i64>::max();
+
+// Each row's value is the index of its zone.
+auto make_rows(TSDB& db, size_t n) -> TypeHandle {
+    const auto type = db.register_struct("Row", { { "value", TSDB::F64 } });
+    std::vector<Row> rows(n);
+    for (size_t i = 0; i < n; ++i) rows[i] = { static_cast<i64>(i), static_cast<f64>(i / ZoneRows) };
+    db.insert_batch(std::span<const Row>(rows), type);
+    return type;
+}
+
+TEST(ZoneMap, TracksBoundsPerBlock) {
+    TSDB db;
+    const auto type = make_rows(db, 3 * ZoneRows + 10);
+    const ZoneMap& zones = db.table(type)->column(1).zones();
+
+    ASSERT_EQ(zones.size(), 4u);
+    EXPECT_EQ(zones.bounds<f64>(2), std::pair(2.0, 2.0));
+    EXPECT_EQ(zones.bounds<f64>(3), std::pair(3.0, 3.0));
+}
+
+TEST(ZoneMap, QueryWhereReadsOnlyOverlappingBlocks) {
+    TSDB db;
+    const auto type  = make_rows(db, 2 * ChunkRows);
+    const auto value = db.field<f64>(type, "value").unwrap();
+
+    size_t pieces = 0;
+    db.table(type)->for_each_candidate(value.column(), 5.0, 6.0, 0, 2 * ChunkRows, [&](size_t first, size_t last) {
+        EXPECT_EQ(first % ZoneRows, 0u);
+        EXPECT_EQ(last - first, ZoneRows);
+        ++pieces;
+    });
+    EXPECT_EQ(pieces, 2u);
+
+    const auto rows = db.query_where<Row>(value, 5.0, 6.0, 0, End);
+    ASSERT_EQ(rows.size(), 2 * ZoneRows);
+    EXPECT_EQ(rows.front().timestamp_ns, static_cast<i64>(5 * ZoneRows));
+    EXPECT_EQ(rows.back().timestamp_ns, static_cast<i64>(7 * ZoneRows - 1));
+}
+
+TEST(ZoneMap, QueryWhereRespectsTimeBounds) {
+    TSDB db;
+    const auto type  = make_rows(db, ChunkRows);
+    const auto value = db.field<f64>(type, "value").unwrap();
+
+    const auto rows = db.query_where<Row>(value, 0.0, 100.0, 100, 200);
+    ASSERT_EQ(rows.size(), 100u);
+    EXPECT_EQ(rows.front().timestamp_ns, 100);
+}
+
+TEST(ZoneMap, QueryWhereScansFieldsWithoutZoneMap) {
+    struct Flagged { i64 timestamp_ns; bool on; };
+
+    TSDB db;
+    const auto type = db.register_struct("Flagged", { { "on", TSDB::BOOL } });
+    std::vector<Flagged> rows(ChunkRows + ZoneRows + 3);
+    for (size_t i = 0; i < rows.size(); ++i) rows[i] = { static_cast<i64>(i), i % 4 == 0 };
+    db.insert_batch(std::span<const Flagged>(rows), type);
+
+    const auto on = db.field<bool>(type, "on").unwrap();
+    ASSERT_FALSE(db.table(type)->column(on.column()).zones().enabled());
+    EXPECT_EQ(db.query_where<Flagged>(on, true, true, 0, End).size(), (rows.size() + 3) / 4);
+}
+
+} // namespace